@@ -0,0 +1,559 @@
+#ifndef _LOGS_H_
+#define _LOGS_H_
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "macros.h"
+
+/// @brief Used for expressing the
+/// sizing of the transaction logs.
+typedef enum _LogStatus
+{
+  /// @brief Number of entries a log can
+  /// hold when it is first allocated.
+  INITIAL_LOG_CAPACITY = 16,
+  /// @brief Size of a cache line (bytes), the
+  /// readers being that far apart.
+  READER_LINE_SIZE = 64,
+  /// @brief Number of retired segments from which
+  /// the region first tries releasing them.
+  RECLAIM_BATCH = 64,
+} LogStatus;
+
+/// @brief Header of a memory segment allocated
+/// in a transaction, followed by its words.
+typedef struct _Segment
+{
+  /// @brief Previous live segment of the region.
+  struct _Segment *prev;
+  /// @brief Next live segment of the region,
+  /// or next retired one once freed.
+  struct _Segment *next;
+  /// @brief Stamp of the commit that freed the segment.
+  unsigned long int retired;
+  /// @brief Size of the segment's words (bytes).
+  size_t size;
+} Segment;
+
+/// @brief Stamp from which a thread reads the region,
+/// which the segments freed later on must outlive.
+typedef struct _Reader
+{
+  /// @brief Stamp no later than the snapshot of the running
+  /// transaction of the thread, ULONG_MAX between transactions.
+  atomic_ulong since;
+  /// @brief Thread the reader belongs to.
+  void const *owner;
+  /// @brief Next reader of the region.
+  struct _Reader *next;
+  /// @brief Keeps the readers on different cache lines.
+  char padding[READER_LINE_SIZE - sizeof(atomic_ulong) - 2 * sizeof(void *)];
+} Reader;
+
+/// @brief Segments allocated in a region, with the readers
+/// whose transactions keep the freed ones alive.
+typedef struct _Segments
+{
+  /// @brief Identifier of the region, unique in the process.
+  unsigned long int id;
+  /// @brief Size of the header before the words
+  /// of an allocated segment (bytes).
+  size_t header;
+  /// @brief Guards the lists of segments.
+  pthread_mutex_t lock;
+  /// @brief Segments allocated by running or committed
+  /// transactions and not freed since.
+  Segment *list;
+  /// @brief Segments freed by committed transactions, released
+  /// once no running transaction may still read them.
+  Segment *retired;
+  /// @brief Number of the retired segments.
+  size_t n_retired;
+  /// @brief Number of retired segments from which the next
+  /// commit tries releasing them, doubling what a pass kept.
+  size_t reclaim_at;
+  /// @brief Threads that ran transactions on the region.
+  _Atomic(Reader *) readers;
+  /// @brief Bytes of the words of the allocated
+  /// segments that were not freed.
+  atomic_ulong live;
+  /// @brief Bytes held by the allocated segments,
+  /// headers and retired segments included.
+  atomic_ulong held;
+} Segments;
+
+/// @brief Redo log of the words written by a transaction,
+/// indexed by address for reading them back.
+typedef struct _WriteLog
+{
+  /// @brief Addresses of the words written.
+  void **targets;
+  /// @brief Number of logged writes.
+  size_t n_writes;
+  /// @brief Number of writes the log can hold.
+  size_t capacity;
+  /// @brief Values of the words written, one
+  /// word of the region per write.
+  char *values;
+  /// @brief Size of the values buffer (bytes).
+  size_t values_capacity;
+  /// @brief Open addressing index of the writes by
+  /// address, holding write positions plus one.
+  size_t *index;
+  /// @brief Number of slots of the index,
+  /// always a power of two.
+  size_t index_capacity;
+} WriteLog;
+
+/// @brief Segments allocated and freed by a transaction.
+typedef struct _SegmentLog
+{
+  /// @brief Segments allocated, already listed
+  /// in the region and released on abort.
+  Segment **allocs;
+  /// @brief Number of logged allocations.
+  size_t n_allocs;
+  /// @brief Number of allocations the log can hold.
+  size_t allocs_capacity;
+  /// @brief Segments freed, retired on commit.
+  Segment **frees;
+  /// @brief Number of logged frees.
+  size_t n_frees;
+  /// @brief Number of frees the log can hold.
+  size_t frees_capacity;
+} SegmentLog;
+
+/// @brief Identifier of the last region created.
+static atomic_ulong last_region_id;
+
+/**
+ * @brief Grows a log so that it holds at least the given number of items.
+ * @param log      Log to grow
+ * @param capacity Number of items the log can hold
+ * @param count    Number of items needed
+ * @param item     Size of an item (bytes)
+ * @return Whether the log holds enough items
+ */
+static inline bool Reserve(void **log, size_t *capacity, size_t count, size_t item)
+{
+  if (likely(count <= *capacity))
+  {
+    return true;
+  }
+
+  size_t grown = *capacity == 0 ? INITIAL_LOG_CAPACITY : *capacity;
+  while (grown < count)
+  {
+    grown <<= 1;
+  }
+
+  void *resized = realloc(*log, grown * item);
+  if (resized == NULL)
+  {
+    return false;
+  }
+  *log = resized;
+  *capacity = grown;
+  return true;
+}
+
+/**
+ * @brief Finds the slot of the write index for a word.
+ * @param log    Write log to look in
+ * @param shift  Log2 of the alignment of the words
+ * @param target Address of the word
+ * @return Slot holding the word's position, or the empty slot where it goes
+ */
+static inline size_t *WriteSlot(WriteLog *log, unsigned int shift, void const *target)
+{
+  size_t mask = log->index_capacity - 1;
+  size_t slot = (((uintptr_t)target >> shift) * 0x9E3779B97F4A7C15ul) & mask;
+  while (log->index[slot] != 0 && log->targets[log->index[slot] - 1] != target)
+  {
+    slot = (slot + 1) & mask;
+  }
+  return log->index + slot;
+}
+
+/**
+ * @brief Finds the logged value of a written word.
+ * @param log    Write log to look in
+ * @param align  Size of a word (bytes)
+ * @param shift  Log2 of the alignment of the words
+ * @param target Address of the word
+ * @return Logged value of the word, NULL if it was not written
+ */
+static inline char *FindWrite(WriteLog *log, size_t align, unsigned int shift, void const *target)
+{
+  if (log->n_writes == 0)
+  {
+    return NULL;
+  }
+  size_t position = *WriteSlot(log, shift, target);
+  return position == 0 ? NULL : log->values + (position - 1) * align;
+}
+
+/**
+ * @brief Doubles the write index, re-inserting every word.
+ * @param log   Write log to grow
+ * @param shift Log2 of the alignment of the words
+ * @return Whether the index could be grown
+ */
+static inline bool GrowWriteIndex(WriteLog *log, unsigned int shift)
+{
+  size_t capacity = log->index_capacity == 0 ? INITIAL_LOG_CAPACITY : log->index_capacity << 1;
+  size_t *index = calloc(capacity, sizeof(size_t));
+  if (index == NULL)
+  {
+    return false;
+  }
+
+  free(log->index);
+  log->index = index;
+  log->index_capacity = capacity;
+  for (size_t i = 0; i < log->n_writes; ++i)
+  {
+    *WriteSlot(log, shift, log->targets[i]) = i + 1;
+  }
+  return true;
+}
+
+/**
+ * @brief Logs the new value of a word, replacing
+ * the one logged by a previous write.
+ * @param log    Write log to append to
+ * @param align  Size of a word (bytes)
+ * @param shift  Log2 of the alignment of the words
+ * @param target Address of the word
+ * @param source Value of the word
+ * @return Whether the value could be logged
+ */
+static inline bool LogWrite(WriteLog *log, size_t align, unsigned int shift, void *target, void const *source)
+{
+  char *value = FindWrite(log, align, shift, target);
+  if (value != NULL)
+  {
+    memcpy(value, source, align);
+    return true;
+  }
+
+  // Keeping the index at most half full
+  size_t count = log->n_writes + 1;
+  if (count << 1 > log->index_capacity && !GrowWriteIndex(log, shift))
+  {
+    return false;
+  }
+  if (!Reserve((void **)&(log->targets), &(log->capacity), count, sizeof(void *)) ||
+      !Reserve((void **)&(log->values), &(log->values_capacity), count * align, 1))
+  {
+    return false;
+  }
+
+  log->targets[log->n_writes] = target;
+  memcpy(log->values + log->n_writes * align, source, align);
+  *WriteSlot(log, shift, target) = count;
+  log->n_writes = count;
+  return true;
+}
+
+/**
+ * @brief Empties a write log.
+ * @param log   Write log to empty
+ * @param shift Log2 of the alignment of the words
+ */
+static inline void ClearWrites(WriteLog *log, unsigned int shift)
+{
+  // Emptying the index in reverse insertion order keeps the probe
+  // sequence of each remaining word intact
+  for (size_t i = log->n_writes; i-- > 0;)
+  {
+    *WriteSlot(log, shift, log->targets[i]) = 0;
+  }
+  log->n_writes = 0;
+}
+
+/**
+ * @brief Initializes the segments of a region, none allocated yet.
+ * @param segments Segments to initialize
+ * @param align    Alignment of the words of the segments (bytes)
+ * @return Whether the segments could be initialized
+ */
+static inline bool InitSegments(Segments *segments, size_t align)
+{
+  // Aligning the words of a segment after its header
+  segments->id = atomic_fetch_add(&last_region_id, 1) + 1;
+  segments->header = (sizeof(Segment) + align - 1) & ~(align - 1);
+  segments->list = NULL;
+  segments->retired = NULL;
+  segments->n_retired = 0;
+  segments->reclaim_at = RECLAIM_BATCH;
+  atomic_store(&(segments->readers), NULL);
+  atomic_store(&(segments->live), 0);
+  atomic_store(&(segments->held), 0);
+  return pthread_mutex_init(&(segments->lock), NULL) == 0;
+}
+
+/**
+ * @brief Releases the segments of a region, freed or not, and its readers.
+ * @param segments Segments to release, with no running transaction
+ */
+static inline void DestroySegments(Segments *segments)
+{
+  Segment *lists[] = {segments->list, segments->retired};
+  for (size_t i = 0; i < 2; ++i)
+  {
+    Segment *segment = lists[i];
+    while (segment != NULL)
+    {
+      Segment *next = segment->next;
+      free(segment);
+      segment = next;
+    }
+  }
+
+  Reader *reader = atomic_load(&(segments->readers));
+  while (reader != NULL)
+  {
+    Reader *next = reader->next;
+    free(reader);
+    reader = next;
+  }
+  pthread_mutex_destroy(&(segments->lock));
+}
+
+/**
+ * @brief Returns the reader of a thread on a region,
+ * registering it on the first transaction of the thread there.
+ * @param segments Segments of the region the thread runs on
+ * @param owner    Context of the thread
+ * @param cached   Reader the thread last used
+ * @param id       Identifier of the region of the cached reader
+ * @return Reader of the thread, NULL if out of memory
+ */
+static inline Reader *ReaderOf(Segments *segments, void const *owner, Reader **cached, unsigned long int *id)
+{
+  if (likely(*id == segments->id))
+  {
+    return *cached;
+  }
+
+  // Looking for the reader the thread registered before
+  Reader *reader = atomic_load(&(segments->readers));
+  while (reader != NULL && reader->owner != owner)
+  {
+    reader = reader->next;
+  }
+
+  if (reader == NULL)
+  {
+    if (posix_memalign((void **)&reader, READER_LINE_SIZE, sizeof(Reader)) != 0)
+    {
+      return NULL;
+    }
+    atomic_init(&(reader->since), ULONG_MAX);
+    reader->owner = owner;
+    reader->next = atomic_load(&(segments->readers));
+    while (!atomic_compare_exchange_weak(&(segments->readers), &(reader->next), reader))
+      ;
+  }
+
+  *cached = reader;
+  *id = segments->id;
+  return reader;
+}
+
+/**
+ * @brief Adds a segment to the live ones of the region, under its lock.
+ * @param segments Segments of the region
+ * @param segment  Segment to add
+ */
+static inline void Link(Segments *segments, Segment *segment)
+{
+  segment->prev = NULL;
+  segment->next = segments->list;
+  if (segment->next != NULL)
+  {
+    segment->next->prev = segment;
+  }
+  segments->list = segment;
+}
+
+/**
+ * @brief Removes a segment from the live ones of the region, under its lock.
+ * @param segments Segments of the region
+ * @param segment  Segment to remove
+ */
+static inline void Unlink(Segments *segments, Segment *segment)
+{
+  if (segment->prev != NULL)
+  {
+    segment->prev->next = segment->next;
+  }
+  else
+  {
+    segments->list = segment->next;
+  }
+  if (segment->next != NULL)
+  {
+    segment->next->prev = segment->prev;
+  }
+}
+
+/**
+ * @brief Allocates a zeroed segment in a transaction, listing it in the
+ * region before anyone can reach it, so that a transaction freeing it
+ * right after the commit finds it listed.
+ * @param segments Segments of the region
+ * @param log      Segment log of the transaction
+ * @param size     Size of the segment's words (bytes)
+ * @param align    Alignment of the words (bytes)
+ * @return Address of the words of the segment, NULL if out of memory
+ */
+static inline void *AllocSegment(Segments *segments, SegmentLog *log, size_t size, size_t align)
+{
+  // Logging the segment first, so that it is released on abort
+  if (!Reserve((void **)&(log->allocs), &(log->allocs_capacity), log->n_allocs + 1, sizeof(Segment *)))
+  {
+    return NULL;
+  }
+
+  // Allocating the segment, its words aligned after the header
+  size_t true_align = align < sizeof(void *) ? sizeof(void *) : align;
+  Segment *segment;
+  if (posix_memalign((void **)&segment, true_align, segments->header + size) != 0)
+  {
+    return NULL;
+  }
+  segment->size = size;
+  memset((char *)segment + segments->header, 0, size);
+  log->allocs[log->n_allocs++] = segment;
+
+  pthread_mutex_lock(&(segments->lock));
+  Link(segments, segment);
+  pthread_mutex_unlock(&(segments->lock));
+  atomic_fetch_add(&(segments->held), segments->header + size);
+  return (char *)segment + segments->header;
+}
+
+/**
+ * @brief Logs the freeing of a segment in a transaction.
+ * @param segments Segments of the region
+ * @param log      Segment log of the transaction
+ * @param target   Address of the words of the segment
+ * @return Whether the free could be logged
+ */
+static inline bool FreeSegment(Segments *segments, SegmentLog *log, void *target)
+{
+  if (!Reserve((void **)&(log->frees), &(log->frees_capacity), log->n_frees + 1, sizeof(Segment *)))
+  {
+    return false;
+  }
+  log->frees[log->n_frees++] = (Segment *)((char *)target - segments->header);
+  return true;
+}
+
+/**
+ * @brief Releases the segments allocated by an aborted transaction.
+ * @param segments Segments of the region
+ * @param log      Segment log of the transaction
+ */
+static inline void DiscardSegments(Segments *segments, SegmentLog *log)
+{
+  if (log->n_allocs != 0)
+  {
+    pthread_mutex_lock(&(segments->lock));
+    for (size_t i = 0; i < log->n_allocs; ++i)
+    {
+      Unlink(segments, log->allocs[i]);
+      atomic_fetch_sub(&(segments->held), segments->header + log->allocs[i]->size);
+      free(log->allocs[i]);
+    }
+    pthread_mutex_unlock(&(segments->lock));
+  }
+  log->n_allocs = 0;
+  log->n_frees = 0;
+}
+
+/**
+ * @brief Counts the segments allocated by a committed transaction
+ * as live and retires the ones it freed.
+ * @param segments Segments of the region
+ * @param log      Segment log of the transaction
+ * @param stamp    Stamp of the commit, from which the freed
+ * segments can no longer be reached
+ * @return Whether enough segments are retired to release them
+ */
+static inline bool PublishSegments(Segments *segments, SegmentLog *log, unsigned long int stamp)
+{
+  for (size_t i = 0; i < log->n_allocs; ++i)
+  {
+    atomic_fetch_add(&(segments->live), log->allocs[i]->size);
+  }
+  log->n_allocs = 0;
+  if (likely(log->n_frees == 0))
+  {
+    return false;
+  }
+
+  pthread_mutex_lock(&(segments->lock));
+  for (size_t i = 0; i < log->n_frees; ++i)
+  {
+    Segment *segment = log->frees[i];
+    Unlink(segments, segment);
+    segment->retired = stamp;
+    segment->next = segments->retired;
+    segments->retired = segment;
+    atomic_fetch_sub(&(segments->live), segment->size);
+  }
+  segments->n_retired += log->n_frees;
+  bool reclaim = segments->n_retired >= segments->reclaim_at;
+  pthread_mutex_unlock(&(segments->lock));
+  log->n_frees = 0;
+  return reclaim;
+}
+
+/**
+ * @brief Releases the retired segments no running transaction can read
+ * anymore, those freed at a stamp every running transaction reached.
+ * @param segments Segments of the region
+ */
+static inline void Reclaim(Segments *segments)
+{
+  pthread_mutex_lock(&(segments->lock));
+  unsigned long int oldest = ULONG_MAX;
+  for (Reader *reader = atomic_load(&(segments->readers)); reader != NULL; reader = reader->next)
+  {
+    unsigned long int since = atomic_load(&(reader->since));
+    oldest = since < oldest ? since : oldest;
+  }
+
+  Segment **link = &(segments->retired);
+  while (*link != NULL)
+  {
+    Segment *segment = *link;
+    if (segment->retired <= oldest)
+    {
+      *link = segment->next;
+      --segments->n_retired;
+      atomic_fetch_sub(&(segments->held), segments->header + segment->size);
+      free(segment);
+    }
+    else
+    {
+      link = &(segment->next);
+    }
+  }
+
+  // Waiting for the kept ones to double, so that a transaction
+  // running for long does not make every commit walk them again
+  segments->reclaim_at = 2 * segments->n_retired < RECLAIM_BATCH ? RECLAIM_BATCH : 2 * segments->n_retired;
+  pthread_mutex_unlock(&(segments->lock));
+}
+
+#endif
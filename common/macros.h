@@ -0,0 +1,37 @@
+#ifndef _MACROS_H_
+#define _MACROS_H_
+
+/**
+ * @brief Define a proposition as likely true.
+ * @param prop Proposition
+ */
+#undef likely
+#ifdef __GNUC__
+#define likely(prop) __builtin_expect((prop) ? 1 : 0, 1)
+#else
+#define likely(prop) (prop)
+#endif
+
+/**
+ * @brief Define a proposition as likely false. 
+ * @param prop Proposition
+ */
+#undef unlikely
+#ifdef __GNUC__
+#define unlikely(prop) __builtin_expect((prop) ? 1 : 0, 0)
+#else
+#define unlikely(prop) (prop)
+#endif
+
+/**
+ * @brief Define a variable as unused.
+ * @param variable Variable
+ */
+#undef unused
+#ifdef __GNUC__
+#define unused(variable) variable __attribute__((unused))
+#else
+#define unused(variable) variable
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,332 @@
+/**
+ * @file   coroutine.hpp
+ *
+ * @section DESCRIPTION
+ *
+ * Coroutine-based transactions, run by a small work-stealing scheduler.
+ * Beginning a transaction, waiting for the turn to end it and waiting
+ * for its writes to be visible suspend the coroutine instead of blocking
+ * its executor thread, which runs the other coroutines meanwhile. The
+ * library keeps the state of a transaction in the thread that runs it:
+ * a coroutine only suspends within a transaction to wait for the turn,
+ * resuming on the same executor, which begins no other transaction
+ * meanwhile. The coroutine, not the thread, keeps the ticket of its
+ * writes, and waits for them to be visible before going on.
+**/
+
+#pragma once
+
+// External headers
+#include <atomic>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Internal headers
+#include "common.hpp"
+#include "transactional.hpp"
+
+// -------------------------------------------------------------------------- //
+
+/** Suspended coroutine waiting for a condition, polled by the executors.
+**/
+class CoWaiter {
+    friend class Scheduler;
+protected:
+    ::std::coroutine_handle<> handle; // Coroutine to resume once the condition holds
+public:
+    /** Poll the condition, on the executor thread that resumes the coroutine if it holds.
+     * @return Whether the coroutine can be resumed
+    **/
+    virtual bool poll() noexcept = 0;
+};
+
+/** Work-stealing scheduler class, each executor thread owning a queue of ready coroutines and polled waiters.
+**/
+class Scheduler final: private NonCopyable {
+private:
+    /** Queue entry, a coroutine to resume or a waiter to poll.
+    **/
+    struct Entry {
+        ::std::coroutine_handle<> handle; // Coroutine to resume, unless waiting
+        CoWaiter* waiter; // Waiter to poll, 'nullptr' if none
+        bool pinned; // Whether the entry must stay on the queue of its executor thread
+    };
+    /** Queue of an executor thread.
+    **/
+    struct Queue {
+        ::std::mutex lock; // Guards the entries
+        ::std::deque<Entry> entries; // Owner pops at the front, thieves at the back
+    };
+private:
+    ::std::vector<Queue> queues;        // Queue of each executor thread
+    ::std::vector<::std::thread> threads; // Executor threads
+    ::std::atomic<size_t> live;   // Number of coroutines spawned and not finished
+    ::std::atomic<size_t> next;   // Next queue to spawn on, from outside the executors
+    ::std::atomic<bool>   stop;   // Whether the executors must terminate
+    ::std::exception_ptr  error;  // First exception a coroutine let escape
+    ::std::mutex          errlock; // Guards the exception
+    static thread_local size_t current; // Queue of the calling executor thread, or 'SIZE_MAX' outside them
+private:
+    /** Push an entry, on the queue of the calling executor thread if any.
+     * @param entry Entry to push
+    **/
+    void push(Entry entry) {
+        auto index = current != SIZE_MAX ? current : next.fetch_add(1, ::std::memory_order_relaxed) % queues.size();
+        ::std::unique_lock<::std::mutex> guard{queues[index].lock};
+        queues[index].entries.push_back(entry);
+    }
+    /** Pop an entry, from the own queue first, then stealing from the others.
+     * @param index Queue of the calling executor thread
+     * @param entry Entry popped
+     * @return Whether an entry was popped
+    **/
+    bool pop(size_t index, Entry& entry) {
+        for (size_t i = 0; i < queues.size(); ++i) {
+            auto& queue = queues[(index + i) % queues.size()];
+            ::std::unique_lock<::std::mutex> guard{queue.lock};
+            if (queue.entries.empty())
+                continue;
+            if (i == 0) {
+                entry = queue.entries.front();
+                queue.entries.pop_front();
+                return true;
+            }
+            for (auto it = queue.entries.rbegin(); it != queue.entries.rend(); ++it) { // Thieves leave the pinned entries
+                if (it->pinned)
+                    continue;
+                entry = *it;
+                queue.entries.erase(::std::next(it).base());
+                return true;
+            }
+        }
+        return false;
+    }
+    /** Executor thread loop, resuming ready coroutines and polling waiters until stopped.
+     * @param index Queue owned by the thread
+    **/
+    void execute(size_t index) {
+        current = index;
+        Entry entry;
+        while (!stop.load(::std::memory_order_relaxed)) {
+            if (!pop(index, entry)) {
+                short_pause();
+                continue;
+            }
+            if (entry.waiter && !entry.waiter->poll()) { // Still waiting, polled again after the other entries
+                push(entry);
+                continue;
+            }
+            entry.handle.resume();
+        }
+    }
+public:
+    /** Executor count constructor.
+     * @param nbthreads Number of executor threads to start
+    **/
+    Scheduler(size_t nbthreads): queues(nbthreads), live{0}, next{0}, stop{false} {
+        for (size_t i = 0; i < nbthreads; ++i)
+            threads.emplace_back([this](size_t i) { execute(i); }, i);
+    }
+    /** Stop destructor, once every coroutine finished.
+    **/
+    ~Scheduler() noexcept {
+        stop.store(true, ::std::memory_order_relaxed);
+        for (auto&& thread: threads)
+            thread.join();
+    }
+public:
+    /** Coroutine run by the scheduler, destroyed when it finishes.
+    **/
+    class Task final {
+    public:
+        /** Promise class.
+        **/
+        struct promise_type {
+            Scheduler* scheduler = nullptr; // Scheduler running the coroutine
+            Task get_return_object() noexcept {
+                return Task{::std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+            ::std::suspend_always initial_suspend() noexcept {
+                return {};
+            }
+            ::std::suspend_never final_suspend() noexcept {
+                scheduler->live.fetch_sub(1, ::std::memory_order_release);
+                return {};
+            }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept {
+                ::std::unique_lock<::std::mutex> guard{scheduler->errlock};
+                if (!scheduler->error)
+                    scheduler->error = ::std::current_exception();
+            }
+        };
+    private:
+        ::std::coroutine_handle<promise_type> handle; // Coroutine, until spawned
+    public:
+        /** Handle constructor.
+         * @param handle Coroutine, suspended at its start
+        **/
+        explicit Task(::std::coroutine_handle<promise_type> handle) noexcept: handle{handle} {}
+        Task(Task&& other) noexcept: handle{::std::exchange(other.handle, nullptr)} {}
+        /** Destructor, destroying the coroutine if never spawned.
+        **/
+        ~Task() noexcept {
+            if (handle)
+                handle.destroy();
+        }
+        friend class Scheduler;
+    };
+public:
+    /** [thread-safe] Spawn a coroutine, run as soon as an executor is free.
+     * @param task Coroutine to run
+    **/
+    void spawn(Task&& task) {
+        auto handle = ::std::exchange(task.handle, nullptr);
+        handle.promise().scheduler = this;
+        live.fetch_add(1, ::std::memory_order_relaxed);
+        push(Entry{handle, nullptr, false});
+    }
+    /** [thread-safe] Queue a waiter, its coroutine being resumed once its condition holds.
+     * @param waiter Waiter to poll, living until its coroutine resumes
+     * @param pinned Whether the waiter must be polled and its coroutine resumed by the calling executor thread
+    **/
+    void wait(CoWaiter& waiter, bool pinned = false) {
+        push(Entry{waiter.handle, &waiter, pinned});
+    }
+    /** Wait for every spawned coroutine to finish, from outside the executors.
+    **/
+    void join() {
+        while (live.load(::std::memory_order_acquire) != 0)
+            ::std::this_thread::yield();
+        if (error)
+            ::std::rethrow_exception(::std::exchange(error, nullptr));
+    }
+};
+inline thread_local size_t Scheduler::current = SIZE_MAX;
+
+// -------------------------------------------------------------------------- //
+
+/** One transaction run by a coroutine over a shared memory region.
+**/
+class CoTransaction final {
+private:
+    /** Awaitable of an access, which the library runs without waiting.
+    **/
+    struct Access {
+        bool result; // Whether the whole transaction can continue
+        bool await_ready() const noexcept {
+            return true;
+        }
+        void await_suspend(::std::coroutine_handle<>) const noexcept {}
+        bool await_resume() const noexcept {
+            return result;
+        }
+    };
+    /** Awaitable of the begin, polling for a turn in the current epoch.
+    **/
+    class Begin final: public CoWaiter {
+    private:
+        Scheduler& scheduler;
+        TransactionalMemory const& tm;
+        bool ro;
+        STM::tx_t tx;
+    public:
+        Begin(Scheduler& scheduler, TransactionalMemory const& tm, bool ro) noexcept: scheduler{scheduler}, tm{tm}, ro{ro}, tx{STM::invalid_tx} {}
+        bool poll() noexcept override {
+            if (ending) // The executor thread still holds the state of a transaction waiting for the turn to end
+                return false;
+            tx = tm.try_begin(ro);
+            return tx != STM::invalid_tx;
+        }
+        bool await_ready() noexcept {
+            return poll();
+        }
+        void await_suspend(::std::coroutine_handle<> handle) {
+            this->handle = handle;
+            scheduler.wait(*this);
+        }
+        CoTransaction await_resume() const noexcept {
+            return CoTransaction{tm, tx};
+        }
+    };
+    /** Awaitable of the end, polling for the turn to end the transaction, then for its epoch to commit.
+    **/
+    class End final: public CoWaiter {
+    private:
+        Scheduler& scheduler;
+        TransactionalMemory const& tm;
+        STM::tx_t tx;
+        STM::Ticket ticket; // Kept by the coroutine, as it may resume on another executor thread
+        STM::End status;
+    public:
+        End(Scheduler& scheduler, TransactionalMemory const& tm, STM::tx_t tx) noexcept: scheduler{scheduler}, tm{tm}, tx{tx}, status{STM::End::busy} {}
+        bool poll() noexcept override {
+            if (status == STM::End::busy) {
+                status = tm.try_end(tx, ticket);
+                ending = status == STM::End::busy;
+                if (ending)
+                    return false;
+            }
+            return status == STM::End::abort || tm.is_visible(ticket);
+        }
+        bool await_ready() noexcept {
+            return poll();
+        }
+        void await_suspend(::std::coroutine_handle<> handle) {
+            this->handle = handle;
+            scheduler.wait(*this, status == STM::End::busy); // Ended from the thread holding the state of the transaction
+        }
+        bool await_resume() const noexcept {
+            return status != STM::End::abort;
+        }
+    };
+private:
+    static thread_local bool ending; // Whether a transaction of the calling executor thread waits for the turn to end
+    TransactionalMemory const& tm; // Bound transactional memory
+    STM::tx_t tx; // Opaque transaction handle
+    /** Begun transaction constructor.
+     * @param tm Transactional memory to bind
+     * @param tx Transaction begun
+    **/
+    CoTransaction(TransactionalMemory const& tm, STM::tx_t tx) noexcept: tm{tm}, tx{tx} {}
+public:
+    /** Begin a transaction, suspending the coroutine while it cannot enter the current epoch.
+     * @param scheduler Scheduler running the coroutine
+     * @param tm        Transactional memory to bind
+     * @param ro        Whether the transaction is read-only
+     * @return Awaitable of the begun transaction
+    **/
+    static Begin begin(Scheduler& scheduler, TransactionalMemory const& tm, bool ro) noexcept {
+        return Begin{scheduler, tm, ro};
+    }
+    /** End the transaction, suspending the coroutine while it waits for the turn, then until its writes are visible.
+     * @param scheduler Scheduler running the coroutine
+     * @return Awaitable of whether the whole transaction is a success
+    **/
+    End end(Scheduler& scheduler) const noexcept {
+        return End{scheduler, tm, tx};
+    }
+    /** Read operation in the bound transaction, source in the shared region and target in a private region.
+     * @param source Source start address
+     * @param size   Source/target range
+     * @param target Target start address
+     * @return Awaitable of whether the whole transaction can continue
+    **/
+    Access read(void const* source, size_t size, void* target) const noexcept {
+        return Access{tm.read(tx, source, size, target)};
+    }
+    /** Write operation in the bound transaction, source in a private region and target in the shared region.
+     * @param source Source start address
+     * @param size   Source/target range
+     * @param target Target start address
+     * @return Awaitable of whether the whole transaction can continue
+    **/
+    Access write(void const* source, size_t size, void* target) const noexcept {
+        return Access{tm.write(tx, source, size, target)};
+    }
+};
+inline thread_local bool CoTransaction::ending = false;
@@ -24,13 +24,17 @@
 // External headers
 #include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <random>
 #include <variant>
+#include <vector>
 
 // Internal headers
 #include "common.hpp"
+#include "coroutine.hpp"
 #include "transactional.hpp"
 #include "workload.hpp"
 
@@ -247,6 +251,548 @@ static auto measure(Workload& workload, unsigned int const nbthreads, unsigned i
     }
 }
 
+/** Print the contention policy and counters of the given workload's transactional memory, if supported by the library.
+ * @param workload Workload instance that was measured
+**/
+static void print_stats(Workload const& workload) {
+    auto const& tm = workload.get_tm();
+    STM::Stats stats;
+    if (!tm.get_stats(stats))
+        return;
+    auto policy = tm.get_cm_policy();
+    ::std::cout << "⎧ Contention policy: " << (policy ? policy : "<unknown>") << ::std::endl;
+    ::std::cout << "⎪ #commits: " << stats.commits << ", #aborts: " << stats.aborts << ::std::endl;
+    ::std::cout << "⎩ #retries: " << stats.retries << ", #waits: " << stats.waits << ", #serials: " << stats.serials << ", #dooms: " << stats.dooms << ::std::endl;
+}
+
+/** Print the memory held by the given workload's transactional memory, if supported by the library.
+ * @param workload Workload instance that was measured
+**/
+static void print_footprint(Workload const& workload) {
+    STM::Footprint footprint;
+    if (!workload.get_tm().get_footprint(footprint))
+        return;
+    ::std::cout << "⎧ Shared data:      " << footprint.data << " bytes" << ::std::endl;
+    ::std::cout << "⎩ Library metadata: " << footprint.metadata << " bytes";
+    if (footprint.data > 0)
+        ::std::cout << " (" << (static_cast<double>(footprint.metadata) / static_cast<double>(footprint.data)) << "x the data)";
+    ::std::cout << ::std::endl;
+}
+
+/** Transfer one unit between random accounts, in the transaction bound to the accounts.
+ * @param accounts   Shared array of balances
+ * @param nbaccounts Number of accounts
+ * @param engine     Random engine to draw the accounts with
+**/
+static void transfer(Shared<uint64_t[]> const& accounts, size_t nbaccounts, ::std::minstd_rand& engine) {
+    ::std::uniform_int_distribution<size_t> account{0, nbaccounts - 1};
+    auto from = account(engine), to = account(engine);
+    auto balance = accounts.read(from);
+    if (balance == 0)
+        return;
+    accounts[from] = balance - 1;
+    accounts[to] = accounts.read(to) + 1;
+}
+
+/** Coroutine transferring units between random accounts.
+ * @param scheduler  Scheduler running the coroutine
+ * @param tm         Transactional memory holding the accounts
+ * @param nbtx       Number of transfers to commit
+ * @param nbaccounts Number of accounts
+ * @param seed       Seed of the random engine
+**/
+static Scheduler::Task transfer_coroutine(Scheduler& scheduler, TransactionalMemory const& tm, size_t nbtx, size_t nbaccounts, Seed seed) {
+    ::std::minstd_rand engine{seed};
+    ::std::uniform_int_distribution<size_t> account{0, nbaccounts - 1};
+    auto accounts = reinterpret_cast<uint64_t*>(tm.get_start());
+    for (size_t i = 0; i < nbtx; ++i) {
+        auto from = account(engine), to = account(engine);
+        while (true) {
+            auto tx = co_await CoTransaction::begin(scheduler, tm, false);
+            uint64_t balance, other;
+            if (!co_await tx.read(accounts + from, sizeof(uint64_t), &balance))
+                continue;
+            if (balance > 0) {
+                --balance;
+                if (!co_await tx.write(&balance, sizeof(uint64_t), accounts + from))
+                    continue;
+                if (!co_await tx.read(accounts + to, sizeof(uint64_t), &other))
+                    continue;
+                ++other;
+                if (!co_await tx.write(&other, sizeof(uint64_t), accounts + to))
+                    continue;
+            }
+            if (co_await tx.end(scheduler))
+                break;
+        }
+    }
+}
+
+/** Measure transfers from more workers than cores, run as one thread each then as coroutines on one executor per core.
+ * @param tl           Transactional library to use
+ * @param nbexecutors  Number of executor threads of the coroutines
+ * @param nbworkers    Number of workers
+ * @param nbtxperwrk   Number of transfers per worker
+ * @param nbaccounts   Number of accounts
+ * @param init_balance Initial balance of each account
+ * @param seed         Seed to use
+ * @return Error constant null-terminated string ('nullptr' for none), execution times (in ns) as threads and as coroutines
+**/
+static auto measure_coroutines(TransactionalLibrary const& tl, size_t nbexecutors, size_t nbworkers, size_t nbtxperwrk, size_t nbaccounts, uint64_t init_balance, Seed seed) {
+    Chrono::Tick times[2];
+    char const* error = nullptr;
+    for (size_t run = 0; run < 2; ++run) {
+        TransactionalMemory tm{tl, sizeof(uint64_t), nbaccounts * sizeof(uint64_t)};
+        transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+            Shared<uint64_t[]> accounts{tx, tm.get_start()};
+            for (size_t i = 0; i < nbaccounts; ++i)
+                accounts[i] = init_balance;
+        });
+        Chrono chrono;
+        chrono.start();
+        if (run == 0) {
+            ::std::vector<::std::thread> threads;
+            for (size_t i = 0; i < nbworkers; ++i) {
+                threads.emplace_back([&](size_t i) {
+                    ::std::minstd_rand engine{static_cast<Seed>(seed + i)};
+                    for (size_t j = 0; j < nbtxperwrk; ++j) {
+                        transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+                            transfer(Shared<uint64_t[]>{tx, tm.get_start()}, nbaccounts, engine);
+                        });
+                    }
+                }, i);
+            }
+            for (auto&& thread: threads)
+                thread.join();
+        } else {
+            Scheduler scheduler{nbexecutors};
+            for (size_t i = 0; i < nbworkers; ++i)
+                scheduler.spawn(transfer_coroutine(scheduler, tm, nbtxperwrk, nbaccounts, static_cast<Seed>(seed + i)));
+            scheduler.join();
+        }
+        chrono.stop();
+        times[run] = chrono.get_tick();
+        auto total = transactional(tm, Transaction::Mode::read_only, [&](Transaction& tx) {
+            Shared<uint64_t[]> accounts{tx, tm.get_start()};
+            uint64_t total = 0;
+            for (size_t i = 0; i < nbaccounts; ++i)
+                total += accounts.read(i);
+            return total;
+        });
+        if (unlikely(total != nbaccounts * init_balance))
+            error = "Violated consistency (total balance changed)";
+    }
+    return ::std::make_tuple(error, times[0], times[1]);
+}
+
+/** Return a percentile of the given latencies.
+ * @param latencies Latencies, sorted in place
+ * @param rank      Percentile to return (in [0, 1])
+ * @return Latency at that percentile (in ns)
+**/
+static auto percentile(::std::vector<Chrono::Tick>& latencies, double rank) {
+    if (latencies.empty())
+        return Chrono::Tick{0};
+    auto index = static_cast<size_t>(rank * static_cast<double>(latencies.size() - 1));
+    ::std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+    return latencies[index];
+}
+
+/** Measure the latency of short read-only transactions while batch writers transfer between accounts.
+ * @param tl           Transactional library to use
+ * @param nbbatch      Number of batch writer threads
+ * @param nbwrites     Number of transfers per writer, the reader running until the writers are done
+ * @param nbaccounts   Number of accounts
+ * @param init_balance Initial balance of each account
+ * @param seed         Seed to use
+ * @param classes      Whether the readers are latency critical and the writers batch transactions, else all have the same priority
+ * @return Error constant null-terminated string ('nullptr' for none), latencies (in ns) of the readers and of the writers
+**/
+static auto measure_priorities(TransactionalLibrary const& tl, size_t nbbatch, size_t nbwrites, size_t nbaccounts, uint64_t init_balance, Seed seed, bool classes) {
+    ::std::vector<Chrono::Tick> reads;
+    ::std::vector<::std::vector<Chrono::Tick>> writes(nbbatch, ::std::vector<Chrono::Tick>(nbwrites));
+    char const* error = nullptr;
+    TransactionalMemory tm{tl, sizeof(uint64_t), nbaccounts * sizeof(uint64_t)};
+    transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+        Shared<uint64_t[]> accounts{tx, tm.get_start()};
+        for (size_t i = 0; i < nbaccounts; ++i)
+            accounts[i] = init_balance;
+    });
+    ::std::atomic<size_t> running{nbbatch};
+    ::std::vector<::std::thread> threads;
+    for (size_t i = 0; i < nbbatch; ++i) {
+        threads.emplace_back([&](size_t i) {
+            ::std::minstd_rand engine{static_cast<Seed>(seed + i)};
+            for (auto&& latency: writes[i]) { // A fixed count, so that writers starved by the reader still report enough samples
+                Chrono chrono;
+                chrono.start();
+                transactional(tm, classes ? Transaction::Mode::batch : Transaction::Mode::read_write, [&](Transaction& tx) {
+                    transfer(Shared<uint64_t[]>{tx, tm.get_start()}, nbaccounts, engine);
+                });
+                latency = chrono.delta();
+            }
+            running.fetch_sub(1, ::std::memory_order_relaxed);
+        }, i);
+    }
+    ::std::minstd_rand engine{seed};
+    ::std::uniform_int_distribution<size_t> account{0, nbaccounts - 1};
+    while (running.load(::std::memory_order_relaxed) != 0) {
+        auto first = account(engine);
+        Chrono chrono;
+        chrono.start();
+        transactional(tm, classes ? Transaction::Mode::latency_critical : Transaction::Mode::read_only, [&](Transaction& tx) {
+            Shared<uint64_t[]> accounts{tx, tm.get_start()};
+            uint64_t total = 0;
+            for (size_t j = 0; j < 4; ++j)
+                total += accounts.read((first + j) % nbaccounts);
+            return total;
+        });
+        reads.push_back(chrono.delta());
+    }
+    for (auto&& thread: threads)
+        thread.join();
+    auto total = transactional(tm, Transaction::Mode::read_only, [&](Transaction& tx) {
+        Shared<uint64_t[]> accounts{tx, tm.get_start()};
+        uint64_t total = 0;
+        for (size_t i = 0; i < nbaccounts; ++i)
+            total += accounts.read(i);
+        return total;
+    });
+    if (unlikely(total != nbaccounts * init_balance))
+        error = "Violated consistency (total balance changed)";
+    ::std::vector<Chrono::Tick> batch;
+    for (auto&& latencies: writes)
+        batch.insert(batch.end(), latencies.begin(), latencies.end());
+    return ::std::make_tuple(error, ::std::move(reads), ::std::move(batch));
+}
+
+/** Print the tail latencies of a priority class, if it ran enough transactions for them to mean anything.
+ * @param name      Name of the class, padded
+ * @param latencies Latencies of its transactions, sorted in place
+**/
+static void print_latencies(char const* name, ::std::vector<Chrono::Tick>& latencies) {
+    constexpr size_t min_samples = 1000; // Below, the p99.9 is the slowest transaction
+    if (latencies.size() < min_samples) {
+        ::std::cout << name << "too few samples for percentiles (" << latencies.size() << " TX)" << ::std::endl;
+        return;
+    }
+    ::std::cout << name << "p50 " << (static_cast<double>(percentile(latencies, 0.5)) / 1000.) << " us, p99 " << (static_cast<double>(percentile(latencies, 0.99)) / 1000.) << " us, p99.9 " << (static_cast<double>(percentile(latencies, 0.999)) / 1000.) << " us (" << latencies.size() << " TX)" << ::std::endl;
+}
+
+/** Measure transfers between accounts split over shards, most of them within one shard and the others across two.
+ * @param tl           Transactional library to use
+ * @param nbshards     Number of shards
+ * @param nbworkers    Number of worker threads
+ * @param nbtxperwrk   Number of transfers per worker
+ * @param nbaccounts   Number of accounts, split evenly over the shards
+ * @param init_balance Initial balance of each account
+ * @param prob_cross   Probability for a transfer to span two shards
+ * @param seed         Seed to use
+ * @return Error constant null-terminated string ('nullptr' for none), execution time (in ns)
+**/
+static auto measure_shards(TransactionalLibrary const& tl, size_t nbshards, size_t nbworkers, size_t nbtxperwrk, size_t nbaccounts, uint64_t init_balance, float prob_cross, Seed seed) {
+    auto const pershard = nbaccounts / nbshards;
+    auto const all = (uint64_t{1} << nbshards) - 1;
+    char const* error = nullptr;
+    TransactionalMemory tm{tl, sizeof(uint64_t), pershard * sizeof(uint64_t), nbshards};
+    ::std::vector<::std::unique_ptr<TransactionalMemory>> shards;
+    for (size_t i = 0; i < nbshards; ++i)
+        shards.emplace_back(::std::make_unique<TransactionalMemory>(tm, i));
+    transactional(tm, all, false, [&](Transaction& tx) {
+        for (auto&& shard: shards) {
+            Shared<uint64_t[]> accounts{tx, shard->get_start()};
+            for (size_t i = 0; i < pershard; ++i)
+                accounts[i] = init_balance;
+        }
+    });
+    Chrono chrono;
+    chrono.start();
+    ::std::vector<::std::thread> threads;
+    for (size_t i = 0; i < nbworkers; ++i) {
+        threads.emplace_back([&](size_t i) {
+            ::std::minstd_rand engine{static_cast<Seed>(seed + i)};
+            ::std::bernoulli_distribution cross{prob_cross};
+            ::std::uniform_int_distribution<size_t> shard{0, nbshards - 1};
+            ::std::uniform_int_distribution<size_t> account{0, pershard - 1};
+            for (size_t j = 0; j < nbtxperwrk; ++j) {
+                auto first = shard(engine);
+                if (nbshards == 1 || !cross(engine)) { // Within one shard, run on it as on any region
+                    auto& tm = *shards[first];
+                    transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+                        transfer(Shared<uint64_t[]>{tx, tm.get_start()}, pershard, engine);
+                    });
+                    continue;
+                }
+                auto second = (first + 1 + shard(engine) % (nbshards - 1)) % nbshards;
+                auto from = account(engine), to = account(engine);
+                transactional(tm, (uint64_t{1} << first) | (uint64_t{1} << second), false, [&](Transaction& tx) {
+                    Shared<uint64_t[]> source{tx, shards[first]->get_start()};
+                    Shared<uint64_t[]> target{tx, shards[second]->get_start()};
+                    auto balance = source.read(from);
+                    if (balance == 0)
+                        return;
+                    source[from] = balance - 1;
+                    target[to] = target.read(to) + 1;
+                });
+            }
+        }, i);
+    }
+    for (auto&& thread: threads)
+        thread.join();
+    chrono.stop();
+    auto total = transactional(tm, all, true, [&](Transaction& tx) {
+        uint64_t total = 0;
+        for (auto&& shard: shards) {
+            Shared<uint64_t[]> accounts{tx, shard->get_start()};
+            for (size_t i = 0; i < pershard; ++i)
+                total += accounts.read(i);
+        }
+        return total;
+    });
+    if (unlikely(total != nbshards * pershard * init_balance))
+        error = "Violated consistency (total balance changed)";
+    return ::std::make_tuple(error, chrono.get_tick());
+}
+
+/** One transfer of a coalesced batch, between accounts drawn beforehand.
+**/
+struct CoalescedTransfer {
+    TransactionalMemory const* tm; // Transactional memory holding the accounts
+    uint64_t* from; // Account to transfer from
+    uint64_t* to;   // Account to transfer to
+};
+
+/** Transfer one unit between the accounts of a coalesced transfer, as the body of a small transaction.
+ * @param tx  Transaction to run in
+ * @param arg Coalesced transfer to run
+ * @return Whether all the accesses succeeded
+**/
+static bool coalesced_transfer(STM::shared_t, STM::tx_t tx, void* arg) noexcept {
+    auto& transfer = *static_cast<CoalescedTransfer*>(arg);
+    uint64_t balance, other;
+    if (!transfer.tm->read(tx, transfer.from, sizeof(uint64_t), &balance))
+        return false;
+    if (balance == 0)
+        return true;
+    --balance;
+    if (!transfer.tm->write(tx, &balance, sizeof(uint64_t), transfer.from))
+        return false;
+    if (!transfer.tm->read(tx, transfer.to, sizeof(uint64_t), &other))
+        return false;
+    ++other;
+    return transfer.tm->write(tx, &other, sizeof(uint64_t), transfer.to);
+}
+
+/** Measure transfers between accounts, run as one transaction each or coalesced in batches.
+ * @param tl           Transactional library to use
+ * @param nbworkers    Number of worker threads
+ * @param nbtxperwrk   Number of transfers per worker
+ * @param nbaccounts   Number of accounts
+ * @param init_balance Initial balance of each account
+ * @param batch        Number of transfers per batch, 1 to run them without coalescing
+ * @param seed         Seed to use
+ * @return Error constant null-terminated string ('nullptr' for none), execution time (in ns)
+**/
+static auto measure_coalesce(TransactionalLibrary const& tl, size_t nbworkers, size_t nbtxperwrk, size_t nbaccounts, uint64_t init_balance, size_t batch, Seed seed) {
+    char const* error = nullptr;
+    TransactionalMemory tm{tl, sizeof(uint64_t), nbaccounts * sizeof(uint64_t)};
+    transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+        Shared<uint64_t[]> accounts{tx, tm.get_start()};
+        for (size_t i = 0; i < nbaccounts; ++i)
+            accounts[i] = init_balance;
+    });
+    Chrono chrono;
+    chrono.start();
+    ::std::vector<::std::thread> threads;
+    for (size_t i = 0; i < nbworkers; ++i) {
+        threads.emplace_back([&](size_t i) {
+            ::std::minstd_rand engine{static_cast<Seed>(seed + i)};
+            if (batch == 1) {
+                for (size_t j = 0; j < nbtxperwrk; ++j) {
+                    transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+                        transfer(Shared<uint64_t[]>{tx, tm.get_start()}, nbaccounts, engine);
+                    });
+                }
+                return;
+            }
+            ::std::uniform_int_distribution<size_t> account{0, nbaccounts - 1};
+            auto accounts = reinterpret_cast<uint64_t*>(tm.get_start());
+            ::std::vector<CoalescedTransfer> transfers(batch);
+            ::std::vector<STM::TxClosure> closures(batch, coalesced_transfer);
+            ::std::vector<void*> args(batch);
+            for (size_t j = 0; j < nbtxperwrk; j += batch) {
+                auto n = ::std::min(batch, nbtxperwrk - j);
+                for (size_t k = 0; k < n; ++k) {
+                    transfers[k] = CoalescedTransfer{&tm, accounts + account(engine), accounts + account(engine)};
+                    args[k] = &transfers[k];
+                }
+                while (unlikely(!tm.coalesce(closures.data(), args.data(), n))); // Only fails when out of memory
+            }
+        }, i);
+    }
+    for (auto&& thread: threads)
+        thread.join();
+    chrono.stop();
+    auto total = transactional(tm, Transaction::Mode::read_only, [&](Transaction& tx) {
+        Shared<uint64_t[]> accounts{tx, tm.get_start()};
+        uint64_t total = 0;
+        for (size_t i = 0; i < nbaccounts; ++i)
+            total += accounts.read(i);
+        return total;
+    });
+    if (unlikely(total != nbaccounts * init_balance))
+        error = "Violated consistency (total balance changed)";
+    return ::std::make_tuple(error, chrono.get_tick());
+}
+
+/** Measure skewed transfers, most of them between a few hot accounts, begun plainly or with the accounts as hints.
+ * @param tl           Transactional library to use
+ * @param nbworkers    Number of worker threads
+ * @param nbtxperwrk   Number of transfers per worker
+ * @param nbaccounts   Number of accounts, each on its own cache line
+ * @param init_balance Initial balance of each account
+ * @param prob_hot     Probability for a transfer to be between the four hot accounts
+ * @param hinted       Whether the transfers pass their accounts as hints
+ * @param seed         Seed to use
+ * @return Error constant null-terminated string ('nullptr' for none), execution time (in ns), number of aborts
+**/
+static auto measure_hinted(TransactionalLibrary const& tl, size_t nbworkers, size_t nbtxperwrk, size_t nbaccounts, uint64_t init_balance, float prob_hot, bool hinted, Seed seed) {
+    constexpr size_t stride = 64 / sizeof(uint64_t); // Accounts one cache line apart, so that only the hot ones share hint slots
+    constexpr size_t nbhot = 4;
+    char const* error = nullptr;
+    TransactionalMemory tm{tl, sizeof(uint64_t), nbaccounts * stride * sizeof(uint64_t)};
+    tm.set_engine(STM::Engine::fine); // Queued transactions only help where conflicts abort them
+    transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+        Shared<uint64_t[]> accounts{tx, tm.get_start()};
+        for (size_t i = 0; i < nbaccounts; ++i)
+            accounts[i * stride] = init_balance;
+    });
+    Chrono chrono;
+    chrono.start();
+    ::std::vector<::std::thread> threads;
+    for (size_t i = 0; i < nbworkers; ++i) {
+        threads.emplace_back([&](size_t i) {
+            ::std::minstd_rand engine{static_cast<Seed>(seed + i)};
+            ::std::bernoulli_distribution hot{prob_hot};
+            ::std::uniform_int_distribution<size_t> hot_account{0, nbhot - 1};
+            ::std::uniform_int_distribution<size_t> account{0, nbaccounts - 1};
+            auto accounts = reinterpret_cast<uint64_t*>(tm.get_start());
+            for (size_t j = 0; j < nbtxperwrk; ++j) {
+                auto is_hot = hot(engine);
+                auto from = (is_hot ? hot_account(engine) : account(engine)) * stride;
+                auto to = (is_hot ? hot_account(engine) : account(engine)) * stride;
+                auto body = [&](Transaction& tx) {
+                    Shared<uint64_t[]> shared{tx, accounts};
+                    auto balance = shared.read(from);
+                    ::std::this_thread::sleep_for(::std::chrono::microseconds(50)); // Think time, widening the conflict window
+                    if (balance == 0)
+                        return;
+                    shared[from] = balance - 1;
+                    shared[to] = shared.read(to) + 1;
+                };
+                if (hinted) {
+                    void const* hints[] = {accounts + from, accounts + to};
+                    transactional(tm, hints, 2, body);
+                } else {
+                    transactional(tm, Transaction::Mode::read_write, body);
+                }
+            }
+        }, i);
+    }
+    for (auto&& thread: threads)
+        thread.join();
+    chrono.stop();
+    auto total = transactional(tm, Transaction::Mode::read_only, [&](Transaction& tx) {
+        Shared<uint64_t[]> accounts{tx, tm.get_start()};
+        uint64_t total = 0;
+        for (size_t i = 0; i < nbaccounts; ++i)
+            total += accounts.read(i * stride);
+        return total;
+    });
+    if (unlikely(total != nbaccounts * init_balance))
+        error = "Violated consistency (total balance changed)";
+    STM::Stats stats{};
+    tm.get_stats(stats);
+    return ::std::make_tuple(error, chrono.get_tick(), stats.aborts);
+}
+
+/** Measure a maintenance thread rotating a large segment of values while workers transfer between other accounts.
+ * @param tl           Transactional library to use
+ * @param nbworkers    Number of worker threads, transferring until the maintenance is done
+ * @param nbaccounts   Number of accounts
+ * @param init_balance Initial balance of each account
+ * @param nbvalues     Number of values in the rotated segment
+ * @param nbrounds     Number of rotations by one value
+ * @param privatize    Whether each rotation runs directly on the privatized segment, else in one transaction
+ * @param seed         Seed to use
+ * @return Error constant null-terminated string ('nullptr' for none), execution time of the maintenance (in ns)
+**/
+static auto measure_privatization(TransactionalLibrary const& tl, size_t nbworkers, size_t nbaccounts, uint64_t init_balance, size_t nbvalues, size_t nbrounds, bool privatize, Seed seed) {
+    char const* error = nullptr;
+    TransactionalMemory tm{tl, sizeof(uint64_t), nbaccounts * sizeof(uint64_t)};
+    auto values = transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+        Shared<uint64_t[]> accounts{tx, tm.get_start()};
+        for (size_t i = 0; i < nbaccounts; ++i)
+            accounts[i] = init_balance;
+        Shared<uint64_t[]> values{tx, tx.alloc(nbvalues * sizeof(uint64_t))}; // The transfers never reach it
+        for (size_t i = 0; i < nbvalues; ++i)
+            values[i] = i;
+        return values.get();
+    });
+    ::std::atomic<bool> stop{false};
+    ::std::vector<::std::thread> threads;
+    for (size_t i = 0; i < nbworkers; ++i) {
+        threads.emplace_back([&](size_t i) {
+            ::std::minstd_rand engine{static_cast<Seed>(seed + i)};
+            while (!stop.load(::std::memory_order_relaxed)) {
+                transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+                    transfer(Shared<uint64_t[]>{tx, tm.get_start()}, nbaccounts, engine);
+                });
+            }
+        }, i);
+    }
+    Chrono chrono;
+    chrono.start();
+    for (size_t round = 0; round < nbrounds; ++round) {
+        if (privatize) { // Committed values accessed directly, between the quiescence and the publication
+            transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+                tx.privatize(values);
+            });
+            tm.quiesce();
+            ::std::rotate(values, values + nbvalues - 1, values + nbvalues);
+            if (unlikely(!tm.publish(values)))
+                error = "Privatized segment was not private anymore";
+        } else {
+            transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+                Shared<uint64_t[]> shared{tx, values};
+                auto last = shared.read(nbvalues - 1);
+                for (size_t i = nbvalues - 1; i > 0; --i)
+                    shared[i] = shared.read(i - 1);
+                shared[0] = last;
+            });
+        }
+    }
+    chrono.stop();
+    stop.store(true, ::std::memory_order_relaxed);
+    for (auto&& thread: threads)
+        thread.join();
+    auto correct = transactional(tm, Transaction::Mode::read_only, [&](Transaction& tx) {
+        Shared<uint64_t[]> accounts{tx, tm.get_start()};
+        uint64_t total = 0;
+        for (size_t i = 0; i < nbaccounts; ++i)
+            total += accounts.read(i);
+        Shared<uint64_t[]> shared{tx, values};
+        for (size_t i = 0; i < nbvalues; ++i) {
+            if (shared.read(i) != (i + nbvalues - nbrounds % nbvalues) % nbvalues)
+                return false;
+        }
+        return total == nbaccounts * init_balance;
+    });
+    if (unlikely(!correct))
+        error = "Violated consistency (balances changed, or rotations lost)";
+    return ::std::make_tuple(error, chrono.get_tick());
+}
+
 // -------------------------------------------------------------------------- //
 
 /** Program entry point.
@@ -338,6 +884,217 @@ int main(int argc, char** argv) {
                 }
                 ::std::cout << ::std::endl;
                 ::std::cout << "⎩ Average TX execution time: " << (perfdbl / pertxdiv) << " ns" << ::std::endl;
+                print_stats(bank);
+                print_footprint(bank);
+                // Same workload, with transfers as commutative adds
+                if (bank.get_tm().has_add()) {
+                    WorkloadBank commutative{tl, nbworkers, nbtxperwrk, nbaccounts, expnbaccounts, init_balance, prob_long, prob_alloc, true};
+                    auto res = measure(commutative, nbworkers, nbrepeats, seed, maxtick_init, maxtick_perf, maxtick_chck);
+                    auto error = ::std::get<0>(res);
+                    if (unlikely(error)) {
+                        ::std::cout << "⎧ Commutative adds variant" << ::std::endl;
+                        ::std::cout << "⎩ " << error << ::std::endl;
+                        return 1;
+                    }
+                    auto adddbl = static_cast<double>(::std::get<2>(res));
+                    ::std::cout << "⎧ Commutative adds variant" << ::std::endl;
+                    ::std::cout << "⎪ Total user execution time: " << (adddbl / 1000000.) << " ms -> " << (perfdbl / adddbl) << " speedup" << ::std::endl;
+                    ::std::cout << "⎩ Average TX execution time: " << (adddbl / pertxdiv) << " ns" << ::std::endl;
+                    print_stats(commutative);
+                }
+                // Same workload, with transfers under snapshot isolation
+                if (bank.get_tm().has_begin_mode()) {
+                    WorkloadBank isolated{tl, nbworkers, nbtxperwrk, nbaccounts, expnbaccounts, init_balance, prob_long, prob_alloc, false, true};
+                    auto res = measure(isolated, nbworkers, nbrepeats, seed, maxtick_init, maxtick_perf, maxtick_chck);
+                    auto error = ::std::get<0>(res);
+                    ::std::cout << "⎧ Snapshot-isolation variant" << ::std::endl;
+                    if (unlikely(error)) {
+                        ::std::cout << "⎩ " << error << ::std::endl;
+                        return 1;
+                    }
+                    auto sidbl = static_cast<double>(::std::get<2>(res));
+                    ::std::cout << "⎪ Total user execution time: " << (sidbl / 1000000.) << " ms -> " << (perfdbl / sidbl) << " speedup" << ::std::endl;
+                    ::std::cout << "⎩ Average TX execution time: " << (sidbl / pertxdiv) << " ns" << ::std::endl;
+                    print_stats(isolated);
+                }
+                // Same workload, with transfers ending before their writes are visible
+                if (bank.get_tm().has_end_async()) {
+                    WorkloadBank asynchronous{tl, nbworkers, nbtxperwrk, nbaccounts, expnbaccounts, init_balance, prob_long, prob_alloc, false, false, true};
+                    auto res = measure(asynchronous, nbworkers, nbrepeats, seed, maxtick_init, maxtick_perf, maxtick_chck);
+                    auto error = ::std::get<0>(res);
+                    ::std::cout << "⎧ Asynchronous commits variant" << ::std::endl;
+                    if (unlikely(error)) {
+                        ::std::cout << "⎩ " << error << ::std::endl;
+                        return 1;
+                    }
+                    auto asyncdbl = static_cast<double>(::std::get<2>(res));
+                    ::std::cout << "⎪ Total user execution time: " << (asyncdbl / 1000000.) << " ms -> " << (perfdbl / asyncdbl) << " speedup" << ::std::endl;
+                    ::std::cout << "⎩ Average TX execution time: " << (asyncdbl / pertxdiv) << " ns" << ::std::endl;
+                    print_stats(asynchronous);
+                }
+                // Same workload, with (de)allocations retrying their updates from a savepoint on conflicts
+                if (bank.get_tm().has_savepoint()) {
+                    WorkloadBank partial{tl, nbworkers, nbtxperwrk, nbaccounts, expnbaccounts, init_balance, prob_long, prob_alloc, false, false, false, true};
+                    auto res = measure(partial, nbworkers, nbrepeats, seed, maxtick_init, maxtick_perf, maxtick_chck);
+                    auto error = ::std::get<0>(res);
+                    ::std::cout << "⎧ Savepoints variant" << ::std::endl;
+                    if (unlikely(error)) {
+                        ::std::cout << "⎩ " << error << ::std::endl;
+                        return 1;
+                    }
+                    auto partialdbl = static_cast<double>(::std::get<2>(res));
+                    ::std::cout << "⎪ Total user execution time: " << (partialdbl / 1000000.) << " ms -> " << (perfdbl / partialdbl) << " speedup" << ::std::endl;
+                    ::std::cout << "⎩ Average TX execution time: " << (partialdbl / pertxdiv) << " ns" << ::std::endl;
+                    print_stats(partial);
+                }
+                // Same workload, with long read-only transactions reading multi-version snapshots
+                {
+                    WorkloadBank snapshots{tl, nbworkers, nbtxperwrk, nbaccounts, expnbaccounts, init_balance, prob_long, prob_alloc};
+                    if (snapshots.get_tm().enable_mvcc()) {
+                        auto res = measure(snapshots, nbworkers, nbrepeats, seed, maxtick_init, maxtick_perf, maxtick_chck);
+                        auto error = ::std::get<0>(res);
+                        ::std::cout << "⎧ Multi-version variant" << ::std::endl;
+                        if (unlikely(error)) {
+                            ::std::cout << "⎩ " << error << ::std::endl;
+                            return 1;
+                        }
+                        auto mvccdbl = static_cast<double>(::std::get<2>(res));
+                        ::std::cout << "⎪ Total user execution time: " << (mvccdbl / 1000000.) << " ms -> " << (perfdbl / mvccdbl) << " speedup" << ::std::endl;
+                        ::std::cout << "⎩ Average TX execution time: " << (mvccdbl / pertxdiv) << " ns" << ::std::endl;
+                        print_stats(snapshots);
+                        print_footprint(snapshots);
+                    }
+                }
+                // Same total work for growing numbers of threads, under each engine
+                if (bank.get_tm().set_engine(STM::Engine::fine)) {
+                    STM::Engine const engines[] = {STM::Engine::fine, STM::Engine::coarse, STM::Engine::adaptive};
+                    auto worst = 1.;
+                    ::std::cout << "⎧ Engine sweep (fine / coarse / adaptive)" << ::std::endl;
+                    for (size_t nbthreads = 1; nbthreads <= ::std::max<size_t>(nbworkers, 4); nbthreads <<= 1) {
+                        double times[3];
+                        for (size_t e = 0; e < 3; ++e) {
+                            WorkloadBank sweep{tl, nbthreads, nbtxperwrk * nbworkers / nbthreads, nbaccounts / nbworkers * nbthreads, expnbaccounts / nbworkers * nbthreads, init_balance, prob_long, prob_alloc};
+                            sweep.get_tm().set_engine(engines[e]);
+                            auto res = measure(sweep, nbthreads, nbrepeats, seed, Chrono::invalid_tick, Chrono::invalid_tick, Chrono::invalid_tick);
+                            auto error = ::std::get<0>(res);
+                            if (unlikely(error)) {
+                                ::std::cout << "⎩ " << error << ::std::endl;
+                                return 1;
+                            }
+                            times[e] = static_cast<double>(::std::get<2>(res));
+                        }
+                        ::std::cout << "⎪ " << nbthreads << " thread(s): " << (times[0] / 1000000.) << " / " << (times[1] / 1000000.) << " / " << (times[2] / 1000000.) << " ms" << ::std::endl;
+                        worst = ::std::min(worst, ::std::min(times[0], times[1]) / times[2]);
+                    }
+                    ::std::cout << "⎩ Adaptive engine: at worst " << worst << "x the speed of the best one" << ::std::endl;
+                }
+                // Transfers from four workers per core, as threads then as coroutines suspending on batcher waits
+                if (bank.get_tm().has_try()) {
+                    auto res = measure_coroutines(tl, nbworkers, 4 * nbworkers, nbtxperwrk / 4, nbaccounts, init_balance, seed);
+                    auto error = ::std::get<0>(res);
+                    ::std::cout << "⎧ Coroutine variant (" << 4 * nbworkers << " workers on " << nbworkers << " executor(s))" << ::std::endl;
+                    if (unlikely(error)) {
+                        ::std::cout << "⎩ " << error << ::std::endl;
+                        return 1;
+                    }
+                    auto threaddbl = static_cast<double>(::std::get<1>(res));
+                    auto corodbl = static_cast<double>(::std::get<2>(res));
+                    ::std::cout << "⎪ Thread per worker: " << (threaddbl / 1000000.) << " ms" << ::std::endl;
+                    ::std::cout << "⎩ Coroutines:        " << (corodbl / 1000000.) << " ms -> " << (threaddbl / corodbl) << " speedup" << ::std::endl;
+                }
+                // Transfers over the same accounts split into more and more shards, one in ten spanning two shards
+                if (bank.get_tm().has_shards()) {
+                    ::std::cout << "⎧ Sharded variant (" << nbaccounts << " accounts, 10% cross-shard transfers)" << ::std::endl;
+                    double single = 0.;
+                    for (size_t nbshards = 1; nbshards <= 8; nbshards <<= 1) {
+                        auto res = measure_shards(tl, nbshards, nbworkers, nbtxperwrk, nbaccounts, init_balance, 0.1f, seed);
+                        auto error = ::std::get<0>(res);
+                        if (unlikely(error)) {
+                            ::std::cout << "⎩ " << error << ::std::endl;
+                            return 1;
+                        }
+                        auto sharddbl = static_cast<double>(::std::get<1>(res));
+                        if (nbshards == 1)
+                            single = sharddbl;
+                        ::std::cout << (nbshards == 8 ? "⎩ " : "⎪ ") << nbshards << " shard(s): " << (sharddbl / 1000000.) << " ms -> " << (single / sharddbl) << " speedup" << ::std::endl;
+                    }
+                }
+                // Transfers as one transaction each, then coalesced eight at a time
+                if (bank.get_tm().has_coalesce()) {
+                    ::std::cout << "⎧ Coalesced variant (batches of 8 transfers)" << ::std::endl;
+                    double single = 0.;
+                    for (size_t batch: {1, 8}) {
+                        auto res = measure_coalesce(tl, nbworkers, nbtxperwrk, nbaccounts, init_balance, batch, seed);
+                        auto error = ::std::get<0>(res);
+                        if (unlikely(error)) {
+                            ::std::cout << "⎩ " << error << ::std::endl;
+                            return 1;
+                        }
+                        auto coaldbl = static_cast<double>(::std::get<1>(res));
+                        if (batch == 1) {
+                            single = coaldbl;
+                            ::std::cout << "⎪ One TX per transfer: " << (coaldbl / 1000000.) << " ms" << ::std::endl;
+                        } else {
+                            ::std::cout << "⎩ Coalesced:           " << (coaldbl / 1000000.) << " ms -> " << (single / coaldbl) << " speedup" << ::std::endl;
+                        }
+                    }
+                }
+                // Skewed transfers, mostly between four hot accounts, begun plainly then with their accounts as hints
+                if (bank.get_tm().has_begin_hinted()) {
+                    auto const nbhinted = ::std::max<size_t>(nbworkers, 8);
+                    ::std::cout << "⎧ Hinted variant (" << nbhinted << " threads, 80% of transfers between 4 hot accounts)" << ::std::endl;
+                    double plain = 0.;
+                    for (auto hinted: {false, true}) {
+                        auto res = measure_hinted(tl, nbhinted, 500, nbaccounts, init_balance, 0.8f, hinted, seed);
+                        auto error = ::std::get<0>(res);
+                        if (unlikely(error)) {
+                            ::std::cout << "⎩ " << error << ::std::endl;
+                            return 1;
+                        }
+                        auto hintdbl = static_cast<double>(::std::get<1>(res));
+                        if (!hinted) {
+                            plain = hintdbl;
+                            ::std::cout << "⎪ Plain begin:  " << (hintdbl / 1000000.) << " ms, " << ::std::get<2>(res) << " abort(s)" << ::std::endl;
+                        } else {
+                            ::std::cout << "⎩ Hinted begin: " << (hintdbl / 1000000.) << " ms, " << ::std::get<2>(res) << " abort(s) -> " << (plain / hintdbl) << " speedup" << ::std::endl;
+                        }
+                    }
+                }
+                // A large segment rotated among transfers, in one transaction per rotation then privatized
+                if (bank.get_tm().has_privatize()) {
+                    ::std::cout << "⎧ Privatization variant (4096 values rotated 64 times among transfers)" << ::std::endl;
+                    double shared = 0.;
+                    for (auto privatize: {false, true}) {
+                        auto res = measure_privatization(tl, nbworkers, nbaccounts, init_balance, 4096, 64, privatize, seed);
+                        auto error = ::std::get<0>(res);
+                        if (unlikely(error)) {
+                            ::std::cout << "⎩ " << error << ::std::endl;
+                            return 1;
+                        }
+                        auto privdbl = static_cast<double>(::std::get<1>(res));
+                        if (!privatize) {
+                            shared = privdbl;
+                            ::std::cout << "⎪ Transactional rotations: " << (privdbl / 1000000.) << " ms" << ::std::endl;
+                        } else {
+                            ::std::cout << "⎩ Privatized rotations:    " << (privdbl / 1000000.) << " ms -> " << (shared / privdbl) << " speedup" << ::std::endl;
+                        }
+                    }
+                }
+                // Latency-critical readers among batch writers, without then with priority classes
+                if (bank.get_tm().has_begin_mode()) {
+                    ::std::cout << "⎧ Priority classes (" << nbworkers << " batch writer(s), 1 latency-critical reader)" << ::std::endl;
+                    for (auto classes: {false, true}) {
+                        auto res = measure_priorities(tl, nbworkers, nbtxperwrk / 10, nbaccounts, init_balance, seed, classes);
+                        auto error = ::std::get<0>(res);
+                        if (unlikely(error)) {
+                            ::std::cout << "⎩ " << error << ::std::endl;
+                            return 1;
+                        }
+                        ::std::cout << "⎪ " << (classes ? "With classes" : "Same priority") << ::std::endl;
+                        print_latencies("⎪   Reader:  ", ::std::get<1>(res));
+                        print_latencies(classes ? "⎩   Writers: " : "⎪   Writers: ", ::std::get<2>(res));
+                    }
+                }
             } catch (::std::exception const& err) { // Special case: cannot unload library with running threads, so print error and quick-exit
                 ::std::cerr << "⎪ *** EXCEPTION ***" << ::std::endl;
                 ::std::cerr << "⎩ " << err.what() << ::std::endl;
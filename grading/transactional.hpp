@@ -32,6 +32,7 @@ extern "C" {
 // Internal headers
 namespace STM {
 #include <tm.hpp>
+#include <tm_ext.hpp>
 }
 #include "common.hpp"
 
@@ -80,6 +81,31 @@ private:
     using FnWrite   = decltype(&STM::tm_write);
     using FnAlloc   = decltype(&STM::tm_alloc);
     using FnFree    = decltype(&STM::tm_free);
+    using FnSetCmPolicy = decltype(&STM::tm_set_cm_policy);
+    using FnGetCmPolicy = decltype(&STM::tm_get_cm_policy);
+    using FnGetStats    = decltype(&STM::tm_get_stats);
+    using FnLastAbort   = decltype(&STM::tm_last_abort);
+    using FnWaitEpoch   = decltype(&STM::tm_wait_epoch);
+    using FnAdd         = decltype(&STM::tm_add);
+    using FnAddGuarded  = decltype(&STM::tm_add_guarded);
+    using FnBeginMode   = decltype(&STM::tm_begin_mode);
+    using FnGetFootprint = decltype(&STM::tm_get_footprint);
+    using FnSetMvcc     = decltype(&STM::tm_set_mvcc);
+    using FnSetEngine   = decltype(&STM::tm_set_engine);
+    using FnEndAsync    = decltype(&STM::tm_end_async);
+    using FnIsVisible   = decltype(&STM::tm_is_visible);
+    using FnBeginDeadline = decltype(&STM::tm_begin_deadline);
+    using FnTryEnd      = decltype(&STM::tm_try_end);
+    using FnCreateSharded = decltype(&STM::tm_create_sharded);
+    using FnShard       = decltype(&STM::tm_shard);
+    using FnBeginShards = decltype(&STM::tm_begin_shards);
+    using FnSavepoint   = decltype(&STM::tm_savepoint);
+    using FnRollbackTo  = decltype(&STM::tm_rollback_to);
+    using FnCoalesce    = decltype(&STM::tm_coalesce);
+    using FnBeginHinted = decltype(&STM::tm_begin_hinted);
+    using FnPrivatize   = decltype(&STM::tm_privatize);
+    using FnQuiesce     = decltype(&STM::tm_quiesce);
+    using FnPublish     = decltype(&STM::tm_publish);
 private:
     void*     module;     // Module opaque handler
     FnCreate  tm_create;  // Module's initialization function
@@ -93,6 +119,31 @@ private:
     FnWrite   tm_write;   // Module's shared memory write function
     FnAlloc   tm_alloc;   // Module's shared memory allocation function
     FnFree    tm_free;    // Module's shared memory freeing function
+    FnSetCmPolicy tm_set_cm_policy; // Module's contention policy setter (optional extension)
+    FnGetCmPolicy tm_get_cm_policy; // Module's contention policy getter (optional extension)
+    FnGetStats    tm_get_stats;     // Module's counters query function (optional extension)
+    FnLastAbort   tm_last_abort;    // Module's last abort reason and retry hint query function (optional extension)
+    FnWaitEpoch   tm_wait_epoch;    // Module's epoch commit waiting function (optional extension)
+    FnAdd         tm_add;           // Module's commutative add function (optional extension)
+    FnAddGuarded  tm_add_guarded;   // Module's guarded commutative add function (optional extension)
+    FnBeginMode   tm_begin_mode;    // Module's transaction begin function with mode flags (optional extension)
+    FnGetFootprint tm_get_footprint; // Module's memory footprint query function (optional extension)
+    FnSetMvcc     tm_set_mvcc;      // Module's multi-version snapshots toggle (optional extension)
+    FnSetEngine   tm_set_engine;    // Module's engine selection function (optional extension)
+    FnEndAsync    tm_end_async;     // Module's transaction end function returning before visibility (optional extension)
+    FnIsVisible   tm_is_visible;    // Module's ticket visibility query function (optional extension)
+    FnBeginDeadline tm_begin_deadline; // Module's transaction begin function giving up past a deadline (optional extension)
+    FnTryEnd      tm_try_end;       // Module's transaction end function never waiting (optional extension)
+    FnCreateSharded tm_create_sharded; // Module's sharded region initialization function (optional extension)
+    FnShard       tm_shard;         // Module's shard query function (optional extension)
+    FnBeginShards tm_begin_shards;  // Module's transaction begin function spanning several shards (optional extension)
+    FnSavepoint   tm_savepoint;     // Module's savepoint placing function (optional extension)
+    FnRollbackTo  tm_rollback_to;   // Module's partial rollback function (optional extension)
+    FnCoalesce    tm_coalesce;      // Module's batch of small transactions running function (optional extension)
+    FnBeginHinted tm_begin_hinted;  // Module's transaction begin function queued behind predicted conflicts (optional extension)
+    FnPrivatize   tm_privatize;     // Module's segment privatization function (optional extension)
+    FnQuiesce     tm_quiesce;       // Module's running transactions draining function (optional extension)
+    FnPublish     tm_publish;       // Module's private segment hand-back function (optional extension)
 private:
     /** Solve a symbol from its name, and bind it to the given function.
      * @param name Name of the symbol to resolve
@@ -107,6 +158,14 @@ private:
     template<class Signature> void solve(char const* name, Signature& func) const {
         func = solve<Signature>(name);
     }
+    /** Solve an optional symbol from its name, binding 'nullptr' if the library does not export it.
+     * @param name Name of the symbol to resolve
+     * @param func Target function to bind
+    **/
+    template<class Signature> void solve_optional(char const* name, Signature& func) const {
+        auto res = ::dlsym(module, name);
+        func = res ? *reinterpret_cast<Signature*>(&res) : nullptr;
+    }
 public:
     /** Loader constructor.
      * @param path  Path to the library to load
@@ -133,6 +192,33 @@ public:
             solve("tm_alloc", tm_alloc);
             solve("tm_free", tm_free);
         }
+        { // Bind module's optional 'tm_*' extension symbols
+            solve_optional("tm_set_cm_policy", tm_set_cm_policy);
+            solve_optional("tm_get_cm_policy", tm_get_cm_policy);
+            solve_optional("tm_get_stats", tm_get_stats);
+            solve_optional("tm_last_abort", tm_last_abort);
+            solve_optional("tm_wait_epoch", tm_wait_epoch);
+            solve_optional("tm_add", tm_add);
+            solve_optional("tm_add_guarded", tm_add_guarded);
+            solve_optional("tm_begin_mode", tm_begin_mode);
+            solve_optional("tm_get_footprint", tm_get_footprint);
+            solve_optional("tm_set_mvcc", tm_set_mvcc);
+            solve_optional("tm_set_engine", tm_set_engine);
+            solve_optional("tm_end_async", tm_end_async);
+            solve_optional("tm_is_visible", tm_is_visible);
+            solve_optional("tm_begin_deadline", tm_begin_deadline);
+            solve_optional("tm_try_end", tm_try_end);
+            solve_optional("tm_create_sharded", tm_create_sharded);
+            solve_optional("tm_shard", tm_shard);
+            solve_optional("tm_begin_shards", tm_begin_shards);
+            solve_optional("tm_savepoint", tm_savepoint);
+            solve_optional("tm_rollback_to", tm_rollback_to);
+            solve_optional("tm_coalesce", tm_coalesce);
+            solve_optional("tm_begin_hinted", tm_begin_hinted);
+            solve_optional("tm_privatize", tm_privatize);
+            solve_optional("tm_quiesce", tm_quiesce);
+            solve_optional("tm_publish", tm_publish);
+        }
     }
     /** Unloader destructor.
     **/
@@ -163,13 +249,14 @@ private:
     void*  start_addr; // Shared memory region first segment's start address
     size_t start_size; // Shared memory region first segment's size (in bytes)
     size_t alignment;  // Shared memory region alignment (in bytes)
+    bool   owner;      // Whether the shared memory region is destroyed with this instance, not for a shard view
 public:
     /** Bind constructor.
      * @param library Transactional library to use
      * @param align   Shared memory region required alignment
      * @param size    Size of the shared memory region to allocate
     **/
-    TransactionalMemory(TransactionalLibrary const& library, size_t align, size_t size): tl{library}, start_size{size}, alignment{align} {
+    TransactionalMemory(TransactionalLibrary const& library, size_t align, size_t size): tl{library}, start_size{size}, alignment{align}, owner{true} {
         if (unlikely(assert_mode && (!is_power_of_two(align) || size % align != 0)))
             throw Exception::TransactionAlign{};
         bounded_run(max_side_time, [&]() {
@@ -179,9 +266,39 @@ public:
             start_addr = tl.tm_start(shared);
         }, "The transactional library takes too long creating the shared memory");
     }
+    /** Sharded bind constructor.
+     * @param library Transactional library to use
+     * @param align   Shared memory region required alignment
+     * @param size    Size of the first segment of each shard
+     * @param shards  Number of shards
+    **/
+    TransactionalMemory(TransactionalLibrary const& library, size_t align, size_t size, size_t shards): tl{library}, start_size{size}, alignment{align}, owner{true} {
+        if (unlikely(assert_mode && (!is_power_of_two(align) || size % align != 0)))
+            throw Exception::TransactionAlign{};
+        if (unlikely(!tl.tm_create_sharded))
+            throw Exception::TransactionCreate{};
+        bounded_run(max_side_time, [&]() {
+            shared = tl.tm_create_sharded(size, align, shards);
+            if (unlikely(shared == STM::invalid_shared))
+                throw Exception::TransactionCreate{};
+            start_addr = tl.tm_start(shared);
+        }, "The transactional library takes too long creating the shared memory");
+    }
+    /** Shard view constructor, the shard being destroyed with the sharded region.
+     * @param sharded Sharded memory region
+     * @param shard   Index of the shard
+    **/
+    TransactionalMemory(TransactionalMemory const& sharded, size_t shard): tl{sharded.tl}, start_size{sharded.start_size}, alignment{sharded.alignment}, owner{false} {
+        shared = tl.tm_shard(sharded.shared, shard);
+        if (unlikely(shared == STM::invalid_shared))
+            throw Exception::TransactionCreate{};
+        start_addr = tl.tm_start(shared);
+    }
     /** Unbind destructor.
     **/
     ~TransactionalMemory() noexcept {
+        if (!owner)
+            return;
         bounded_run(max_side_time, [&]() {
             tl.tm_destroy(shared);
         }, "The transactional library takes too long destroying the shared memory");
@@ -213,6 +330,84 @@ public:
     auto begin(bool ro) const noexcept {
         return tl.tm_begin(shared, ro);
     }
+    /** [thread-safe] Begin a new read-only transaction that upgrades to read-write on its first write, alloc or free.
+     * @return Opaque transaction ID, 'STM::invalid_tx' on failure
+    **/
+    auto begin_upgradable() const noexcept {
+        if (!tl.tm_begin_mode) // Without support, the transaction is read-write from the start
+            return tl.tm_begin(shared, false);
+        return tl.tm_begin_mode(shared, STM::BeginFlags::upgradable);
+    }
+    /** [thread-safe] Begin a new read-write transaction under snapshot isolation, only aborting on write-write conflicts.
+     * @return Opaque transaction ID, 'STM::invalid_tx' on failure
+    **/
+    auto begin_snapshot_isolation() const noexcept {
+        if (!tl.tm_begin_mode) // Without support, the transaction is serializable
+            return tl.tm_begin(shared, false);
+        return tl.tm_begin_mode(shared, STM::BeginFlags::snapshot_isolation);
+    }
+    /** [thread-safe] Begin a new transaction in a priority class, high-priority ones entering the epochs first.
+     * @param ro   Whether the transaction is read-only
+     * @param high Whether the transaction is latency critical, else it only gets the leftover capacity
+     * @return Opaque transaction ID, 'STM::invalid_tx' on failure
+    **/
+    auto begin_priority(bool ro, bool high) const noexcept {
+        if (!tl.tm_begin_mode) // Without support, every transaction has the same priority
+            return tl.tm_begin(shared, ro);
+        auto priority = high ? STM::BeginFlags::high_priority : STM::BeginFlags::low_priority;
+        return tl.tm_begin_mode(shared, static_cast<STM::BeginFlags>(static_cast<int>(priority) | static_cast<int>(ro ? STM::BeginFlags::read_only : STM::BeginFlags::none)));
+    }
+    /** [thread-safe] Begin a new transaction spanning several shards of the sharded memory region.
+     * @param mask Shards the transaction accesses, bit i standing for shard i
+     * @param ro   Whether the transaction is read-only
+     * @return Opaque transaction ID, 'STM::invalid_tx' on failure
+    **/
+    auto begin_shards(uint64_t mask, bool ro) const noexcept {
+        return tl.tm_begin_shards(shared, mask, ro);
+    }
+    /** [thread-safe] Begin a new read-write transaction, queued behind the running ones predicted to conflict with it.
+     * @param hints   Addresses the transaction will access
+     * @param nbhints Number of hints
+     * @return Opaque transaction ID, 'STM::invalid_tx' on failure
+    **/
+    auto begin_hinted(void const* const* hints, size_t nbhints) const noexcept {
+        if (!tl.tm_begin_hinted) // Without support, the transaction begins right away
+            return tl.tm_begin(shared, false);
+        return tl.tm_begin_hinted(shared, STM::BeginFlags::none, hints, nbhints);
+    }
+    /** [thread-safe] Return whether the library supports hinted transactions.
+     * @return Whether 'begin_hinted' uses the hints
+    **/
+    bool has_begin_hinted() const noexcept {
+        return tl.tm_begin_hinted;
+    }
+    /** [thread-safe] Return whether the library supports sharded regions.
+     * @return Whether the sharded constructors and 'begin_shards' can be used
+    **/
+    bool has_shards() const noexcept {
+        return tl.tm_create_sharded && tl.tm_shard && tl.tm_begin_shards;
+    }
+    /** [thread-safe] Run a batch of small independent transactions under as few transactions as possible, committing each closure once.
+     * @param closures Body of each small transaction, returning 'false' once one of its accesses failed, and only then
+     * @param args     Argument passed to each closure
+     * @param n        Number of closures in the batch
+     * @return Whether the batch ran, 'false' if out of memory
+    **/
+    auto coalesce(STM::TxClosure const* closures, void* const* args, size_t n) const noexcept {
+        return tl.tm_coalesce(shared, closures, args, n);
+    }
+    /** [thread-safe] Return whether the library supports coalescing small transactions.
+     * @return Whether 'coalesce' can be used
+    **/
+    bool has_coalesce() const noexcept {
+        return tl.tm_coalesce;
+    }
+    /** [thread-safe] Return whether the library supports transaction mode flags.
+     * @return Whether 'begin_upgradable' and 'begin_snapshot_isolation' use them
+    **/
+    bool has_begin_mode() const noexcept {
+        return tl.tm_begin_mode;
+    }
     /** [thread-safe] End the given transaction.
      * @param tx Opaque transaction ID
      * @return Whether the whole transaction is a success
@@ -220,6 +415,61 @@ public:
     auto end(TX tx) const noexcept {
         return tl.tm_end(shared, tx);
     }
+    /** [thread-safe] End the given transaction, possibly before its writes are visible to the other threads.
+     * @param tx Opaque transaction ID
+     * @return Whether the whole transaction is a success
+    **/
+    auto end_async(TX tx) const noexcept {
+        if (!tl.tm_end_async) // Without support, the writes are visible on return
+            return tl.tm_end(shared, tx);
+        STM::Ticket ticket; // The library makes the next transaction of the thread wait for it
+        return tl.tm_end_async(shared, tx, &ticket);
+    }
+    /** [thread-safe] Return whether the library supports ending transactions before their writes are visible.
+     * @return Whether 'end_async' uses it
+    **/
+    bool has_end_async() const noexcept {
+        return tl.tm_end_async;
+    }
+    /** [thread-safe] Begin a new transaction on the shared memory region, unless it would have to wait for its turn or epoch.
+     * The caller keeps the ticket of the previous transaction it ended with 'try_end', the thread not waiting for it.
+     * @param ro Whether the transaction is read-only
+     * @return Opaque transaction ID, 'STM::invalid_tx' if it would have waited or on failure
+    **/
+    auto try_begin(bool ro) const noexcept {
+        if (!tl.tm_begin_deadline) // Without support, the transaction waits as long as needed
+            return tl.tm_begin(shared, ro);
+        auto flags = static_cast<int>(STM::BeginFlags::caller_tickets) | static_cast<int>(ro ? STM::BeginFlags::read_only : STM::BeginFlags::none);
+        return tl.tm_begin_deadline(shared, static_cast<STM::BeginFlags>(flags), 1); // Deadline already passed
+    }
+    /** [thread-safe] End the given transaction, unless it would have to wait for its turn, possibly before its writes are visible.
+     * @param tx     Opaque transaction ID
+     * @param ticket Ticket receiving when the writes become visible, to pass to 'is_visible'
+     * @return End status, 'STM::End::busy' if the transaction still runs, to be ended again from the same thread
+    **/
+    auto try_end(TX tx, STM::Ticket& ticket) const noexcept {
+        ticket = STM::visible_ticket;
+        if (tl.tm_try_end)
+            return tl.tm_try_end(shared, tx, &ticket);
+        if (!tl.tm_end_async || !tl.tm_is_visible) // Without support, the writes are visible on return
+            return tl.tm_end(shared, tx) ? STM::End::visible : STM::End::abort;
+        if (!tl.tm_end_async(shared, tx, &ticket)) // Without support, the transaction waits for its turn
+            return STM::End::abort;
+        return ticket == STM::visible_ticket ? STM::End::visible : STM::End::pending;
+    }
+    /** [thread-safe] Return whether the writes of a transaction ended with 'try_end' are visible to the other threads.
+     * @param ticket Ticket returned by 'try_end'
+     * @return Whether the writes are visible
+    **/
+    bool is_visible(STM::Ticket ticket) const noexcept {
+        return ticket == STM::visible_ticket || tl.tm_is_visible(shared, ticket);
+    }
+    /** [thread-safe] Return whether the library supports beginning and ending transactions without waiting.
+     * @return Whether 'try_begin' and 'try_end' never wait
+    **/
+    bool has_try() const noexcept {
+        return tl.tm_begin_deadline && tl.tm_try_end && tl.tm_is_visible;
+    }
     /** [thread-safe] Read operation in the given transaction, source in the shared region and target in a private region.
      * @param tx     Transaction to use
      * @param source Source start address
@@ -257,6 +507,148 @@ public:
     auto free(TX tx, void* target) const noexcept {
         return tl.tm_free(shared, tx, target);
     }
+    /** [thread-safe] Segment privatization operation in the given transaction, the segment becoming private once it committed.
+     * @param tx     Transaction to use
+     * @param target Segment start address
+     * @return Whether the whole transaction can continue
+    **/
+    auto privatize(TX tx, void* target) const noexcept {
+        return tl.tm_privatize(shared, tx, target);
+    }
+    /** [thread-safe] Wait until every running transaction has ended, none of them accessing the segments privatized before anymore.
+    **/
+    void quiesce() const noexcept {
+        tl.tm_quiesce(shared);
+    }
+    /** [thread-safe] Hand a private segment back to the transactions, outside of any transaction.
+     * @param target Segment start address
+     * @return Whether the segment was private
+    **/
+    auto publish(void* target) const noexcept {
+        return tl.tm_publish(shared, target);
+    }
+    /** [thread-safe] Return whether the library supports privatizing segments.
+     * @return Whether 'privatize', 'quiesce' and 'publish' can be used
+    **/
+    bool has_privatize() const noexcept {
+        return tl.tm_privatize && tl.tm_quiesce && tl.tm_publish;
+    }
+    /** [thread-safe] Place a savepoint in the given transaction, after which a conflict fails the access but leaves the transaction running.
+     * @param tx Transaction to use
+     * @return Savepoint placed, 'STM::no_savepoint' if none could be placed
+    **/
+    auto savepoint(TX tx) const noexcept {
+        if (!tl.tm_savepoint || !tl.tm_rollback_to) // Without support, a conflict aborts the whole transaction
+            return STM::no_savepoint;
+        return tl.tm_savepoint(shared, tx);
+    }
+    /** [thread-safe] Roll the given transaction back to one of its savepoints.
+     * @param tx        Transaction to use
+     * @param savepoint Savepoint to roll back to
+     * @return Whether the transaction can continue, 'false' if it aborted as a whole
+    **/
+    auto rollback_to(TX tx, STM::Savepoint savepoint) const noexcept {
+        return savepoint != STM::no_savepoint && tl.tm_rollback_to(shared, tx, savepoint);
+    }
+    /** [thread-safe] Return whether the library supports savepoints.
+     * @return Whether 'savepoint' can place one
+    **/
+    bool has_savepoint() const noexcept {
+        return tl.tm_savepoint && tl.tm_rollback_to;
+    }
+    /** [thread-safe] Return whether the library supports commutative adds.
+     * @return Whether 'add' and 'add_guarded' can be used
+    **/
+    bool has_add() const noexcept {
+        return tl.tm_add && tl.tm_add_guarded;
+    }
+    /** [thread-safe] Commutative add operation in the given transaction.
+     * @param tx     Transaction to use
+     * @param target Target word address
+     * @param delta  Delta to add
+     * @return Whether the whole transaction can continue
+    **/
+    auto add(TX tx, void* target, int64_t delta) const noexcept {
+        return tl.tm_add(shared, tx, target, delta);
+    }
+    /** [thread-safe] Guarded commutative add operation in the given transaction.
+     * @param tx     Transaction to use
+     * @param target Target word address
+     * @param delta  Delta to add
+     * @param floor  Lowest value the word may reach
+     * @return Add status code
+    **/
+    auto add_guarded(TX tx, void* target, int64_t delta, int64_t floor) const noexcept {
+        return tl.tm_add_guarded(shared, tx, target, delta, floor);
+    }
+public:
+    /** [thread-safe] Return the name of the contention management policy in use.
+     * @return Null-terminated policy name, 'nullptr' if the library does not support it
+    **/
+    char const* get_cm_policy() const noexcept {
+        if (!tl.tm_get_cm_policy)
+            return nullptr;
+        switch (tl.tm_get_cm_policy(shared)) {
+        case STM::CmPolicy::wait_epoch:
+            return "wait-epoch";
+        case STM::CmPolicy::aggressive:
+            return "aggressive";
+        case STM::CmPolicy::backoff:
+            return "backoff";
+        case STM::CmPolicy::karma:
+            return "karma";
+        default:
+            return "unknown";
+        }
+    }
+    /** [thread-safe] Query the counters of the shared memory region.
+     * @param stats Structure receiving the counters
+     * @return Whether the library supports counters
+    **/
+    bool get_stats(STM::Stats& stats) const noexcept {
+        if (!tl.tm_get_stats)
+            return false;
+        tl.tm_get_stats(shared, &stats);
+        return true;
+    }
+    /** Make read-only transactions read multi-version snapshots, with no running transaction.
+     * @return Whether the library supports multi-version snapshots
+    **/
+    bool enable_mvcc() const noexcept {
+        return tl.tm_set_mvcc && tl.tm_set_mvcc(shared, true);
+    }
+    /** Select the engine transactions run with, with no running transaction.
+     * @param engine Engine to run with
+     * @return Whether the library supports the engine
+    **/
+    bool set_engine(STM::Engine engine) const noexcept {
+        return tl.tm_set_engine && tl.tm_set_engine(shared, engine);
+    }
+    /** Query the memory held by the shared memory region, with no running transaction.
+     * @param footprint Structure receiving the byte counts
+     * @return Whether the library supports footprint queries
+    **/
+    bool get_footprint(STM::Footprint& footprint) const noexcept {
+        if (!tl.tm_get_footprint)
+            return false;
+        tl.tm_get_footprint(shared, &footprint);
+        return true;
+    }
+    /** [thread-safe] Wait as hinted by the library before retrying the last aborted transaction of the calling thread.
+    **/
+    void wait_retry() const noexcept {
+        if (!tl.tm_last_abort || !tl.tm_wait_epoch)
+            return;
+        STM::AbortInfo info;
+        tl.tm_last_abort(shared, &info);
+        switch (info.hint) {
+        case STM::RetryHint::next_epoch:
+            tl.tm_wait_epoch(shared);
+            return;
+        default: // STM::RetryHint::now, or STM::RetryHint::serial as the library runs the next attempt alone
+            return;
+        }
+    }
 };
 
 /** One transaction over a shared memory region management class.
@@ -265,15 +657,40 @@ class Transaction final: private NonCopyable {
 public:
     /** Transaction mode class.
     **/
-    enum class Mode: bool {
-        read_write = false,
-        read_only  = true
+    enum class Mode {
+        read_write,
+        read_only,
+        upgradable, // Read-only until the first write, alloc or free
+        snapshot_isolation, // Read-write, only aborting on write-write conflicts
+        asynchronous, // Read-write, ending before its writes are visible to the other threads
+        latency_critical, // Read-only, entering the epochs ahead of the batch transactions
+        batch // Read-write, only getting the capacity the latency-critical transactions leave
     };
 private:
     TransactionalMemory const& tm; // Bound transactional memory
     STM::tx_t tx; // Opaque transaction handle
     bool aborted; // Transaction was aborted
     bool is_ro;   // Whether the transaction is read-only (solely for assertion)
+    bool async;   // Whether the transaction ends before its writes are visible
+    /** Begin a transaction in the given mode.
+     * @param tm   Transactional memory to begin on
+     * @param mode Transaction mode
+     * @return Opaque transaction ID, 'STM::invalid_tx' on failure
+    **/
+    static STM::tx_t begin(TransactionalMemory const& tm, Mode mode) noexcept {
+        switch (mode) {
+        case Mode::upgradable:
+            return tm.begin_upgradable();
+        case Mode::snapshot_isolation:
+            return tm.begin_snapshot_isolation();
+        case Mode::latency_critical:
+            return tm.begin_priority(true, true);
+        case Mode::batch:
+            return tm.begin_priority(false, false);
+        default:
+            return tm.begin(mode == Mode::read_only);
+        }
+    }
 public:
     /** Deleted copy constructor/assignment.
     **/
@@ -281,9 +698,27 @@ public:
     Transaction& operator=(Transaction const&) = delete;
     /** Begin constructor.
      * @param tm Transactional memory to bind
-     * @param ro Whether the transaction is read-only
+     * @param ro Transaction mode
+    **/
+    Transaction(TransactionalMemory const& tm, Mode ro): tm{tm}, tx{begin(tm, ro)}, aborted{false}, is_ro{ro == Mode::read_only || ro == Mode::latency_critical}, async{ro == Mode::asynchronous} {
+        if (unlikely(tx == STM::invalid_tx))
+            throw Exception::TransactionBegin{};
+    }
+    /** Shards begin constructor.
+     * @param tm   Sharded transactional memory to bind
+     * @param mask Shards the transaction accesses, bit i standing for shard i
+     * @param ro   Whether the transaction is read-only
     **/
-    Transaction(TransactionalMemory const& tm, Mode ro): tm{tm}, tx{tm.begin(static_cast<bool>(ro))}, aborted{false}, is_ro{static_cast<bool>(ro)} {
+    Transaction(TransactionalMemory const& tm, uint64_t mask, bool ro): tm{tm}, tx{tm.begin_shards(mask, ro)}, aborted{false}, is_ro{ro}, async{false} {
+        if (unlikely(tx == STM::invalid_tx))
+            throw Exception::TransactionBegin{};
+    }
+    /** Hinted begin constructor.
+     * @param tm      Transactional memory to bind
+     * @param hints   Addresses the read-write transaction will access
+     * @param nbhints Number of hints
+    **/
+    Transaction(TransactionalMemory const& tm, void const* const* hints, size_t nbhints): tm{tm}, tx{tm.begin_hinted(hints, nbhints)}, aborted{false}, is_ro{false}, async{false} {
         if (unlikely(tx == STM::invalid_tx))
             throw Exception::TransactionBegin{};
     }
@@ -291,7 +726,7 @@ public:
     **/
     ~Transaction() noexcept(false) {
         if (likely(!aborted)) {
-            if (unlikely(!tm.end(tx)))
+            if (unlikely(!(async ? tm.end_async(tx) : tm.end(tx))))
                 throw Exception::TransactionRetry{};
         }
     }
@@ -356,6 +791,66 @@ public:
             throw Exception::TransactionRetry{};
         }
     }
+    /** [thread-safe] Segment privatization operation in the bound transaction.
+     * @param target Segment start address
+    **/
+    void privatize(void* target) {
+        if (unlikely(assert_mode && is_ro))
+            throw Exception::TransactionReadOnly{};
+        if (unlikely(!tm.privatize(tx, target))) {
+            aborted = true;
+            throw Exception::TransactionRetry{};
+        }
+    }
+    /** [thread-safe] Commutative add operation in the bound transaction.
+     * @param target Target word address
+     * @param delta  Delta to add
+    **/
+    void add(void* target, int64_t delta) {
+        if (unlikely(assert_mode && is_ro))
+            throw Exception::TransactionReadOnly{};
+        if (unlikely(!tm.add(tx, target, delta))) {
+            aborted = true;
+            throw Exception::TransactionRetry{};
+        }
+    }
+    /** [thread-safe] Guarded commutative add operation in the bound transaction.
+     * @param target Target word address
+     * @param delta  Delta to add
+     * @param floor  Lowest value the word may reach
+     * @return Whether the delta was added, 'false' if refused by the guard
+    **/
+    bool add_guarded(void* target, int64_t delta, int64_t floor) {
+        if (unlikely(assert_mode && is_ro))
+            throw Exception::TransactionReadOnly{};
+        switch (tm.add_guarded(tx, target, delta, floor)) {
+        case STM::Add::success:
+            return true;
+        case STM::Add::refused:
+            return false;
+        default: // STM::Add::abort
+            aborted = true;
+            throw Exception::TransactionRetry{};
+        }
+    }
+    /** [thread-safe] Run the rest of the bound transaction from a savepoint, rolling back to it and running it again on conflicts.
+     * The savepoint stays placed until the transaction ends, so the closure must run the accesses left in the transaction.
+     * @param func Rest of the transaction (-> ...)
+     * @return Returned value (or void) when the closure completed
+    **/
+    template<class Func> auto from_savepoint(Func&& func) {
+        auto savepoint = tm.savepoint(tx);
+        do {
+            try {
+                return func();
+            } catch (Exception::TransactionRetry const&) {
+                if (!tm.rollback_to(tx, savepoint)) // The whole transaction aborted, or no savepoint could be placed
+                    throw;
+                aborted = false;
+                continue;
+            }
+        } while (true);
+    }
 };
 
 // -------------------------------------------------------------------------- //
@@ -614,6 +1109,45 @@ template<class Func> static auto transactional(TransactionalMemory const& tm, Tr
             Transaction tx{tm, mode};
             return func(tx);
         } catch (Exception::TransactionRetry const&) {
+            tm.wait_retry();
+            continue;
+        }
+    } while (true);
+}
+
+/** Repeat a given read-write transaction, queued behind the ones predicted to conflict with it, until it commits.
+ * @param tm      Transactional memory
+ * @param hints   Addresses the transaction will access
+ * @param nbhints Number of hints
+ * @param func    Transaction closure (Transaction& -> ...)
+ * @return Returned value (or void) when the transaction committed
+**/
+template<class Func> static auto transactional(TransactionalMemory const& tm, void const* const* hints, size_t nbhints, Func&& func) {
+    do {
+        try {
+            Transaction tx{tm, hints, nbhints};
+            return func(tx);
+        } catch (Exception::TransactionRetry const&) {
+            tm.wait_retry();
+            continue;
+        }
+    } while (true);
+}
+
+/** Repeat a given transaction spanning several shards until it commits.
+ * @param tm   Sharded transactional memory
+ * @param mask Shards the transaction accesses, bit i standing for shard i
+ * @param ro   Whether the transaction is read-only
+ * @param func Transaction closure (Transaction& -> ...)
+ * @return Returned value (or void) when the transaction committed
+**/
+template<class Func> static auto transactional(TransactionalMemory const& tm, uint64_t mask, bool ro, Func&& func) {
+    do {
+        try {
+            Transaction tx{tm, mask, ro};
+            return func(tx);
+        } catch (Exception::TransactionRetry const&) {
+            tm.wait_retry();
             continue;
         }
     } while (true);
@@ -77,6 +77,13 @@ public:
      * @return Constant null-terminated error message, 'nullptr' for none
     **/
     virtual char const* check(Uid, Seed) const = 0;
+public:
+    /** Return the bound transactional memory.
+     * @return Bound transactional memory
+    **/
+    auto const& get_tm() const noexcept {
+        return tm;
+    }
 };
 
 // -------------------------------------------------------------------------- //
@@ -140,6 +147,10 @@ private:
     Balance init_balance;  // Initial account balance
     float   prob_long;     // Probability of running a long, read-only control transaction
     float   prob_alloc;    // Probability of running an allocation/deallocation transaction, knowing a long transaction won't run
+    bool    commutative;   // Whether transfers use commutative adds instead of read-modify-writes
+    bool    isolated;      // Whether transfers run under snapshot isolation instead of serializability
+    bool    asynchronous;  // Whether transfers end before their writes are visible to the other threads
+    bool    partial;       // Whether (de)allocations only retry their updates from a savepoint on conflicts
     Barrier barrier;       // Barrier for thread synchronization during 'check'
 public:
     /** Bank workload constructor.
@@ -151,8 +162,12 @@ public:
      * @param init_balance  Initial account balance
      * @param prob_long     Probability of running a long, read-only control transaction
      * @param prob_alloc    Probability of running an allocation/deallocation transaction, knowing a long transaction won't run
+     * @param commutative   Whether transfers use commutative adds instead of read-modify-writes (requires library support)
+     * @param isolated      Whether transfers run under snapshot isolation instead of serializability (requires library support)
+     * @param asynchronous  Whether transfers end before their writes are visible to the other threads (requires library support)
+     * @param partial       Whether (de)allocations only retry their updates from a savepoint on conflicts (requires library support)
     **/
-    WorkloadBank(TransactionalLibrary const& library, size_t nbworkers, size_t nbtxperwrk, size_t nbaccounts, size_t expnbaccounts, Balance init_balance, float prob_long, float prob_alloc): Workload{library, AccountSegment::align(), AccountSegment::size(nbaccounts)}, nbworkers{nbworkers}, nbtxperwrk{nbtxperwrk}, nbaccounts{nbaccounts}, expnbaccounts{expnbaccounts}, init_balance{init_balance}, prob_long{prob_long}, prob_alloc{prob_alloc}, barrier{nbworkers} {}
+    WorkloadBank(TransactionalLibrary const& library, size_t nbworkers, size_t nbtxperwrk, size_t nbaccounts, size_t expnbaccounts, Balance init_balance, float prob_long, float prob_alloc, bool commutative = false, bool isolated = false, bool asynchronous = false, bool partial = false): Workload{library, AccountSegment::align(), AccountSegment::size(nbaccounts)}, nbworkers{nbworkers}, nbtxperwrk{nbtxperwrk}, nbaccounts{nbaccounts}, expnbaccounts{expnbaccounts}, init_balance{init_balance}, prob_long{prob_long}, prob_alloc{prob_alloc}, commutative{commutative}, isolated{isolated}, asynchronous{asynchronous}, partial{partial}, barrier{nbworkers} {}
 private:
     /** Long read-only transaction, summing the balance of each account.
      * @param count Loosely-updated number of accounts
@@ -184,7 +199,7 @@ private:
      * @param trigger Trigger level that will decide whether to allocate or deallocate
     **/
     void alloc_tx(size_t trigger) const {
-        return transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+        return transactional(tm, Transaction::Mode::upgradable, [&](Transaction& tx) {
             auto count = 0ul; // Total number of accounts seen.
             void* prev = nullptr;
             auto start = tm.get_start();
@@ -194,29 +209,35 @@ private:
                 count += segment_count;
                 decltype(start) segment_next = segment.next;
                 if (!segment_next) { // Currently at the last segment
-                    if (count > trigger && likely(count > 2)) { // If we have seen "too many" accounts, we will destroy one.
-                        --segment_count; // Let's remove the last account from the last segment.
-                        auto new_parity = segment.parity.read() + segment.accounts[segment_count] - init_balance; // We remove 1x the initial balance but don't break parity.
-                        if (segment_count > 0) { // Just remove one account from the (last) segment without deallocating memory.
-                            segment.count = segment_count;
-                            segment.parity = new_parity;
-                        } else { // If there's no one in the last segment anymore, we deallocate it.
-                            if (unlikely(assert_mode && prev == nullptr))
-                                throw Exception::TransactionNotLastSegment{};
-                            AccountSegment prev_segment{tx, prev};
-                            prev_segment.next.free();
-                            prev_segment.parity = prev_segment.parity.read() + new_parity;
-                        }
-                    } else { // If we don't destroy any account, then let's create a new one.
-                        if (segment_count < nbaccounts) { // If there's room in the last segment, then let's create the account in it without allocating memory.
-                            segment.accounts[segment_count] = init_balance;
-                            segment.count = segment_count + 1;
-                        } else { // Otherwise, we really need to allocate memory for the new account.
-                            AccountSegment next_segment{tx, segment.next.alloc(AccountSegment::size(nbaccounts))};
-                            next_segment.count = 1;
-                            next_segment.accounts[0] = init_balance;
+                    auto update = [&]() { // Leaves the walk's state untouched, to run again after a rollback to a savepoint
+                        if (count > trigger && likely(count > 2)) { // If we have seen "too many" accounts, we will destroy one.
+                            auto remaining = segment_count - 1; // Let's remove the last account from the last segment.
+                            auto new_parity = segment.parity.read() + segment.accounts[remaining] - init_balance; // We remove 1x the initial balance but don't break parity.
+                            if (remaining > 0) { // Just remove one account from the (last) segment without deallocating memory.
+                                segment.count = remaining;
+                                segment.parity = new_parity;
+                            } else { // If there's no one in the last segment anymore, we deallocate it.
+                                if (unlikely(assert_mode && prev == nullptr))
+                                    throw Exception::TransactionNotLastSegment{};
+                                AccountSegment prev_segment{tx, prev};
+                                prev_segment.next.free();
+                                prev_segment.parity = prev_segment.parity.read() + new_parity;
+                            }
+                        } else { // If we don't destroy any account, then let's create a new one.
+                            if (segment_count < nbaccounts) { // If there's room in the last segment, then let's create the account in it without allocating memory.
+                                segment.accounts[segment_count] = init_balance;
+                                segment.count = segment_count + 1;
+                            } else { // Otherwise, we really need to allocate memory for the new account.
+                                AccountSegment next_segment{tx, segment.next.alloc(AccountSegment::size(nbaccounts))};
+                                next_segment.count = 1;
+                                next_segment.accounts[0] = init_balance;
+                            }
                         }
-                    }
+                    };
+                    if (partial) // A conflict then only retries the update, not the whole walk over the segments
+                        tx.from_savepoint(update);
+                    else
+                        update();
                     return;
                 }
                 prev  = start;
@@ -230,7 +251,9 @@ private:
      * @return Whether the parameters were satisfying and the transaction committed on useful work
     **/
     bool short_tx(size_t send_id, size_t recv_id) const {
-        return transactional(tm, Transaction::Mode::read_write, [&](Transaction& tx) {
+        // Transfers write every account they depend on, and removing an account reads it serializably, so write-write conflicts suffice
+        auto mode = isolated ? Transaction::Mode::snapshot_isolation : asynchronous ? Transaction::Mode::asynchronous : Transaction::Mode::read_write;
+        return transactional(tm, mode, [&](Transaction& tx) {
             void* send_ptr = nullptr;
             void* recv_ptr = nullptr;
 
@@ -262,6 +285,13 @@ private:
                     return false; // At least one account does not exist => do nothing
             }
 
+            // Transfer the money if enough fund, as deltas that do not conflict with other transfers
+            if (commutative) {
+                if (tx.add_guarded(send_ptr, -1, 0))
+                    tx.add(recv_ptr, 1);
+                return true;
+            }
+
             // Transfer the money if enough fund
             Shared<Balance> sender{tx, send_ptr}; // Shared is a template that overloads copy to use tm_read/tm_write.
             Shared<Balance> recver{tx, recv_ptr};
@@ -0,0 +1,127 @@
+/**
+ * @file   tm_ext.h
+ *
+ * @section DESCRIPTION
+ *
+ * Interface declaration of the transaction manager extensions (C version).
+ * Libraries implementing only 'tm.h' remain valid: callers loading a library
+ * dynamically must treat every symbol declared here as optional.
+ **/
+
+#pragma once
+
+#include <tm.h>
+
+// -------------------------------------------------------------------------- //
+
+typedef int cm_policy_t;
+static cm_policy_t const cm_wait_epoch = 0; // Aborted TX wait for the next epoch before retrying
+static cm_policy_t const cm_aggressive = 1; // Aborted TX retry immediately
+static cm_policy_t const cm_backoff    = 2; // Aborted TX retry after a randomized exponential backoff
+static cm_policy_t const cm_karma      = 3; // On conflict, the TX that did the least work gives up
+
+typedef struct {
+    uint64_t commits; // Number of committed transactions
+    uint64_t aborts;  // Number of aborted transactions
+    uint64_t retries; // Number of transactions started right after an abort
+    uint64_t waits;   // Number of backoffs after an abort or waits on a conflicting TX
+    uint64_t serials; // Number of transactions that ran irrevocably
+    uint64_t dooms;   // Number of transactions evicted by the epoch watchdog
+} stats_t;
+
+typedef int abort_reason_t;
+static abort_reason_t const abort_none        = 0; // No TX of the calling thread aborted yet
+static abort_reason_t const abort_lookup      = 1; // The address is not inside any live segment
+static abort_reason_t const abort_write_write = 2; // A word or segment to write was held by another TX
+static abort_reason_t const abort_read_write  = 3; // A word to read was written, or a word to write was read, by another TX
+static abort_reason_t const abort_epoch_full  = 4; // A read-only TX could not upgrade, no write slot was left in the epoch
+static abort_reason_t const abort_snapshot_too_old = 5; // A snapshot TX read a word whose version at the snapshot was no longer kept
+static abort_reason_t const abort_doomed      = 6; // The TX held its epoch open for too long and was evicted by the watchdog
+static abort_reason_t const abort_retry       = 7; // The TX called 'tm_retry' to wait for a word it read to change
+
+typedef int retry_hint_t;
+static retry_hint_t const retry_now        = 0; // Retrying right away can succeed
+static retry_hint_t const retry_next_epoch = 1; // The conflicting TX hold the words until the current epoch commits
+static retry_hint_t const retry_serial     = 2; // The TX keeps aborting, its next attempt runs alone
+
+typedef int begin_flags_t;
+static begin_flags_t const begin_read_only   = 1; // The TX only reads, as with 'tm_begin(shared, true)'
+static begin_flags_t const begin_irrevocable = 2; // The TX runs alone in its epoch and cannot abort on conflicts
+static begin_flags_t const begin_upgradable  = 4; // The TX starts read-only and upgrades to read-write on its first write, alloc or free
+static begin_flags_t const begin_snapshot_isolation = 8; // The TX reads the last committed epoch and only aborts on write-write conflicts
+static begin_flags_t const begin_retry = 16; // The TX logs the words it reads, for 'tm_retry' to sleep until one of them changes
+static begin_flags_t const begin_caller_tickets = 32; // The caller keeps the tickets of the TX ended without waiting, the next TX of the thread not waiting for them
+static begin_flags_t const begin_high_priority = 64; // The TX is latency critical, entering epochs ahead of low-priority TX and taking the write slots reserved for it
+static begin_flags_t const begin_low_priority  = 128; // The TX only gets the leftover capacity, entering no epoch while a high-priority TX waits
+
+typedef int add_t;
+static add_t const success_add = 0; // Delta added and the TX can continue
+static add_t const abort_add   = 1; // TX was aborted and could be retried
+static add_t const refused_add = 2; // Delta refused by the guard but TX was not aborted
+
+typedef int engine_t;
+static engine_t const engine_fine     = 0; // TX go through the batcher and lock the words they access
+static engine_t const engine_coarse   = 1; // TX hold a region-wide reader-writer lock, writers running alone
+static engine_t const engine_adaptive = 2; // The region switches between both from the number of active threads and the abort rate
+
+typedef uint64_t ticket_t;
+static ticket_t const visible_ticket = 0; // The writes of the TX are already visible to the other threads
+
+typedef uint64_t deadline_t; // Absolute CLOCK_MONOTONIC time (in ns)
+static deadline_t const no_deadline = 0; // Wait as long as needed
+
+typedef uint64_t savepoint_t;
+static savepoint_t const no_savepoint = 0; // No savepoint could be placed
+
+typedef bool (*tx_closure_t)(shared_t, tx_t, void *); // Body of a small transaction, returning false once one of its accesses failed
+
+typedef int end_t;
+static end_t const visible_end = 0; // TX committed and its writes are visible to the other threads
+static end_t const pending_end = 1; // TX committed, but the deadline passed before its writes were visible
+static end_t const abort_end   = 2; // TX was aborted and could be retried
+static end_t const busy_end    = 3; // TX could not leave without waiting and still runs, to be ended again
+
+typedef struct {
+    abort_reason_t reason; // Why the last TX of the calling thread aborted
+    retry_hint_t   hint;   // When that TX should be retried
+} abort_info_t;
+
+typedef struct {
+    uint64_t data;     // Bytes of the live segments, as requested by the user
+    uint64_t metadata; // Bytes held by the library on top of them (versions, locks, headers, retired segments)
+} footprint_t;
+
+// -------------------------------------------------------------------------- //
+
+bool tm_set_cm_policy(shared_t, cm_policy_t);
+cm_policy_t tm_get_cm_policy(shared_t);
+void tm_get_stats(shared_t, stats_t *);
+void tm_last_abort(shared_t, abort_info_t *);
+void tm_wait_epoch(shared_t);
+tx_t tm_begin_mode(shared_t, begin_flags_t);
+bool tm_add(shared_t, tx_t, void *, int64_t);
+add_t tm_add_guarded(shared_t, tx_t, void *, int64_t, int64_t);
+void tm_get_footprint(shared_t, footprint_t *);
+bool tm_set_mvcc(shared_t, bool);
+bool tm_set_engine(shared_t, engine_t);
+engine_t tm_get_engine(shared_t);
+bool tm_end_async(shared_t, tx_t, ticket_t *);
+bool tm_is_visible(shared_t, ticket_t);
+void tm_wait_visible(shared_t, ticket_t);
+tx_t tm_begin_deadline(shared_t, begin_flags_t, deadline_t);
+end_t tm_end_deadline(shared_t, tx_t, deadline_t);
+end_t tm_try_end(shared_t, tx_t, ticket_t *);
+bool tm_set_watchdog(shared_t, uint64_t);
+shared_t tm_create_sharded(size_t, size_t, size_t);
+shared_t tm_shard(shared_t, size_t);
+tx_t tm_begin_shards(shared_t, uint64_t, bool);
+bool tm_thread_enter(shared_t);
+void tm_thread_exit(shared_t);
+void tm_retry(shared_t, tx_t);
+savepoint_t tm_savepoint(shared_t, tx_t);
+bool tm_rollback_to(shared_t, tx_t, savepoint_t);
+bool tm_coalesce(shared_t, tx_closure_t const *, void *const *, size_t);
+tx_t tm_begin_hinted(shared_t, begin_flags_t, void const *const *, size_t);
+bool tm_privatize(shared_t, tx_t, void *);
+void tm_quiesce(shared_t);
+bool tm_publish(shared_t, void *);
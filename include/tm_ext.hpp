@@ -0,0 +1,150 @@
+/**
+ * @file   tm_ext.hpp
+ *
+ * @section DESCRIPTION
+ *
+ * Interface declaration of the transaction manager extensions (C++ version).
+ * Libraries implementing only 'tm.hpp' remain valid: callers loading a library
+ * dynamically must treat every symbol declared here as optional.
+ **/
+
+#pragma once
+
+#include <cstdint>
+
+#include <tm.hpp>
+
+// -------------------------------------------------------------------------- //
+
+enum class CmPolicy : int
+{
+    wait_epoch = 0, // Aborted TX wait for the next epoch before retrying
+    aggressive = 1, // Aborted TX retry immediately
+    backoff = 2,    // Aborted TX retry after a randomized exponential backoff
+    karma = 3       // On conflict, the TX that did the least work gives up
+};
+
+struct Stats
+{
+    uint64_t commits; // Number of committed transactions
+    uint64_t aborts;  // Number of aborted transactions
+    uint64_t retries; // Number of transactions started right after an abort
+    uint64_t waits;   // Number of backoffs after an abort or waits on a conflicting TX
+    uint64_t serials; // Number of transactions that ran irrevocably
+    uint64_t dooms;   // Number of transactions evicted by the epoch watchdog
+};
+
+enum class AbortReason : int
+{
+    none = 0,        // No TX of the calling thread aborted yet
+    lookup = 1,      // The address is not inside any live segment
+    write_write = 2, // A word or segment to write was held by another TX
+    read_write = 3,  // A word to read was written, or a word to write was read, by another TX
+    epoch_full = 4,  // A read-only TX could not upgrade, no write slot was left in the epoch
+    snapshot_too_old = 5, // A snapshot TX read a word whose version at the snapshot was no longer kept
+    doomed = 6,      // The TX held its epoch open for too long and was evicted by the watchdog
+    retry = 7        // The TX called 'tm_retry' to wait for a word it read to change
+};
+
+enum class RetryHint : int
+{
+    now = 0,        // Retrying right away can succeed
+    next_epoch = 1, // The conflicting TX hold the words until the current epoch commits
+    serial = 2      // The TX keeps aborting, its next attempt runs alone
+};
+
+enum class BeginFlags : int
+{
+    none = 0,
+    read_only = 1,   // The TX only reads, as with 'tm_begin(shared, true)'
+    irrevocable = 2, // The TX runs alone in its epoch and cannot abort on conflicts
+    upgradable = 4,  // The TX starts read-only and upgrades to read-write on its first write, alloc or free
+    snapshot_isolation = 8, // The TX reads the last committed epoch and only aborts on write-write conflicts
+    retry = 16, // The TX logs the words it reads, for 'tm_retry' to sleep until one of them changes
+    caller_tickets = 32, // The caller keeps the tickets of the TX ended without waiting, the next TX of the thread not waiting for them
+    high_priority = 64, // The TX is latency critical, entering epochs ahead of low-priority TX and taking the write slots reserved for it
+    low_priority = 128 // The TX only gets the leftover capacity, entering no epoch while a high-priority TX waits
+};
+
+enum class Add : int
+{
+    success = 0, // Delta added and the TX can continue
+    abort = 1,   // TX was aborted and could be retried
+    refused = 2  // Delta refused by the guard but TX was not aborted
+};
+
+enum class Engine : int
+{
+    fine = 0,    // TX go through the batcher and lock the words they access
+    coarse = 1,  // TX hold a region-wide reader-writer lock, writers running alone
+    adaptive = 2 // The region switches between both from the number of active threads and the abort rate
+};
+
+using Ticket = uint64_t;
+constexpr static Ticket visible_ticket = 0; // The writes of the TX are already visible to the other threads
+
+using Deadline = uint64_t; // Absolute CLOCK_MONOTONIC time (in ns)
+constexpr static Deadline no_deadline = 0; // Wait as long as needed
+
+using Savepoint = uint64_t;
+constexpr static Savepoint no_savepoint = 0; // No savepoint could be placed
+
+using TxClosure = bool (*)(shared_t, tx_t, void *) noexcept; // Body of a small transaction, returning false once one of its accesses failed
+
+enum class End : int
+{
+    visible = 0, // TX committed and its writes are visible to the other threads
+    pending = 1, // TX committed, but the deadline passed before its writes were visible
+    abort = 2,   // TX was aborted and could be retried
+    busy = 3     // TX could not leave without waiting and still runs, to be ended again
+};
+
+struct AbortInfo
+{
+    AbortReason reason; // Why the last TX of the calling thread aborted
+    RetryHint hint;     // When that TX should be retried
+};
+
+struct Footprint
+{
+    uint64_t data;     // Bytes of the live segments, as requested by the user
+    uint64_t metadata; // Bytes held by the library on top of them (versions, locks, headers, retired segments)
+};
+
+// -------------------------------------------------------------------------- //
+
+extern "C"
+{
+    bool tm_set_cm_policy(shared_t, CmPolicy) noexcept;
+    CmPolicy tm_get_cm_policy(shared_t) noexcept;
+    void tm_get_stats(shared_t, Stats *) noexcept;
+    void tm_last_abort(shared_t, AbortInfo *) noexcept;
+    void tm_wait_epoch(shared_t) noexcept;
+    tx_t tm_begin_mode(shared_t, BeginFlags) noexcept;
+    bool tm_add(shared_t, tx_t, void *, int64_t) noexcept;
+    Add tm_add_guarded(shared_t, tx_t, void *, int64_t, int64_t) noexcept;
+    void tm_get_footprint(shared_t, Footprint *) noexcept;
+    bool tm_set_mvcc(shared_t, bool) noexcept;
+    bool tm_set_engine(shared_t, Engine) noexcept;
+    Engine tm_get_engine(shared_t) noexcept;
+    bool tm_end_async(shared_t, tx_t, Ticket *) noexcept;
+    bool tm_is_visible(shared_t, Ticket) noexcept;
+    void tm_wait_visible(shared_t, Ticket) noexcept;
+    tx_t tm_begin_deadline(shared_t, BeginFlags, Deadline) noexcept;
+    End tm_end_deadline(shared_t, tx_t, Deadline) noexcept;
+    End tm_try_end(shared_t, tx_t, Ticket *) noexcept;
+    bool tm_set_watchdog(shared_t, uint64_t) noexcept;
+    shared_t tm_create_sharded(size_t, size_t, size_t) noexcept;
+    shared_t tm_shard(shared_t, size_t) noexcept;
+    tx_t tm_begin_shards(shared_t, uint64_t, bool) noexcept;
+    bool tm_thread_enter(shared_t) noexcept;
+    void tm_thread_exit(shared_t) noexcept;
+    void tm_retry(shared_t, tx_t) noexcept;
+    Savepoint tm_savepoint(shared_t, tx_t) noexcept;
+    bool tm_rollback_to(shared_t, tx_t, Savepoint) noexcept;
+    bool tm_coalesce(shared_t, TxClosure const *, void *const *, size_t) noexcept;
+    tx_t tm_begin_hinted(shared_t, BeginFlags, void const *const *, size_t) noexcept;
+    bool tm_privatize(shared_t, tx_t, void *) noexcept;
+    void tm_quiesce(shared_t) noexcept;
+    bool tm_publish(shared_t, void *) noexcept;
+}
@@ -0,0 +1,180 @@
+#ifndef _BASIC_OPERATIONS_H_
+#define _BASIC_OPERATIONS_H_
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "context.h"
+#include "logs.h"
+#include "memory.h"
+#include "relinquish_cpu.h"
+
+/**
+ * @brief Logs the value of a read word, to be
+ * validated whenever the region changes.
+ * @param source Address of the word
+ * @param value  Value read
+ * @return Whether the value could be logged
+ */
+static inline bool LogRead(void const *source, void const *value)
+{
+  size_t align = thread_context.region->align;
+  size_t count = thread_context.n_reads + 1;
+  if (!Reserve((void **)&(thread_context.reads), &(thread_context.reads_capacity), count, sizeof(void const *)) ||
+      !Reserve((void **)&(thread_context.read_values), &(thread_context.read_values_capacity), count * align, 1))
+  {
+    return false;
+  }
+
+  thread_context.reads[thread_context.n_reads] = source;
+  memcpy(thread_context.read_values + thread_context.n_reads * align, value, align);
+  thread_context.n_reads = count;
+  return true;
+}
+
+/**
+ * @brief Waits for no transaction to be writing back.
+ * @param region Region to wait on
+ * @return Even value of the sequence lock
+ */
+static inline unsigned long int Quiescent(Region *region)
+{
+  unsigned long int time = atomic_load_explicit(&(region->sequence), memory_order_acquire);
+  while (time & 1)
+  {
+    relinquish_cpu();
+    time = atomic_load_explicit(&(region->sequence), memory_order_acquire);
+  }
+  return time;
+}
+
+/**
+ * @brief Checks that every word read still holds the value read,
+ * moving the snapshot of the transaction forward if so.
+ * @param region Region the transaction runs on
+ * @return Whether the reads are consistent with the current region
+ */
+static inline bool Validate(Region *region)
+{
+  size_t align = region->align;
+  while (true)
+  {
+    unsigned long int time = Quiescent(region);
+    for (size_t i = 0; i < thread_context.n_reads; ++i)
+    {
+      if (memcmp(thread_context.reads[i], thread_context.read_values + i * align, align) != 0)
+      {
+        return false;
+      }
+    }
+
+    // No write back happened during the comparison
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&(region->sequence), memory_order_relaxed) == time)
+    {
+      // The values read are those of the new snapshot, so the segments
+      // freed up to it no longer hold anything the transaction read
+      thread_context.snapshot = time;
+      atomic_store(&(thread_context.reader->since), time);
+      return true;
+    }
+  }
+}
+
+/**
+ * @brief Reads a word consistently with the previous reads of the transaction.
+ * @param region Region holding the word
+ * @param source Address of the word
+ * @param target Where to copy the word
+ * @return Whether the previous reads are still consistent
+ */
+static inline bool ReadWord(Region *region, void const *source, void *target)
+{
+  memcpy(target, source, region->align);
+  atomic_thread_fence(memory_order_acquire);
+  while (atomic_load_explicit(&(region->sequence), memory_order_relaxed) != thread_context.snapshot)
+  {
+    if (!Validate(region))
+    {
+      return false;
+    }
+    memcpy(target, source, region->align);
+    atomic_thread_fence(memory_order_acquire);
+  }
+  return true;
+}
+
+/**
+ * @brief Clears the logs of the transaction.
+ */
+static inline void Reset()
+{
+  ClearWrites(&(thread_context.writes), thread_context.region->shift);
+  thread_context.n_reads = 0;
+
+  // The transaction no longer holds back the freed segments
+  atomic_store_explicit(&(thread_context.reader->since), ULONG_MAX, memory_order_release);
+}
+
+/**
+ * @brief Aborts the transaction, releasing
+ * the segments it allocated.
+ */
+static inline void Rollback()
+{
+  DiscardSegments(&(thread_context.region->segments), &(thread_context.segments));
+  Reset();
+}
+
+/**
+ * @brief Commits the transaction: takes the sequence lock
+ * once the reads are consistent and writes the redo log back.
+ * @param region Region the transaction runs on
+ * @return Whether the transaction committed
+ */
+static inline bool Commit(Region *region)
+{
+  // Reads were consistent with the snapshot as they happened
+  bool reclaim;
+  if (thread_context.writes.n_writes == 0)
+  {
+    reclaim = PublishSegments(&(region->segments), &(thread_context.segments), thread_context.snapshot);
+    Reset();
+    if (unlikely(reclaim))
+    {
+      Reclaim(&(region->segments));
+    }
+    return true;
+  }
+
+  // Taking the sequence lock at our snapshot, revalidating when it moved
+  unsigned long int expected = thread_context.snapshot;
+  while (!atomic_compare_exchange_strong(&(region->sequence), &expected, thread_context.snapshot + 1))
+  {
+    if (!Validate(region))
+    {
+      Rollback();
+      return false;
+    }
+    expected = thread_context.snapshot;
+  }
+
+  // Writing back and releasing the sequence lock
+  for (size_t i = 0; i < thread_context.writes.n_writes; ++i)
+  {
+    memcpy(thread_context.writes.targets[i], thread_context.writes.values + i * region->align, region->align);
+  }
+  atomic_store_explicit(&(region->sequence), thread_context.snapshot + 2, memory_order_release);
+
+  // The freed segments are unreachable from the snapshots that follow
+  reclaim = PublishSegments(&(region->segments), &(thread_context.segments), thread_context.snapshot + 2);
+  Reset();
+  if (unlikely(reclaim))
+  {
+    Reclaim(&(region->segments));
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef _CONTEXT_H_
+#define _CONTEXT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "memory.h"
+
+/// @brief Descriptor of the transaction
+/// run by the calling thread.
+typedef struct _ThreadContext
+{
+  /// @brief Region the transaction runs on.
+  Region *region;
+  /// @brief Reader of the thread on the region with
+  /// the identifier below, 0 before the first one.
+  Reader *reader;
+  /// @brief Identifier of the region of the reader.
+  unsigned long int reader_id;
+  /// @brief Whether the transaction is read-only.
+  bool is_ro;
+  /// @brief Value of the sequence lock the
+  /// reads are known to be consistent with.
+  unsigned long int snapshot;
+  /// @brief Addresses of the words read.
+  void const **reads;
+  /// @brief Number of logged reads.
+  size_t n_reads;
+  /// @brief Number of reads the log can hold.
+  size_t reads_capacity;
+  /// @brief Values of the words read, validated
+  /// against the region when it changes.
+  char *read_values;
+  /// @brief Size of the read values buffer (bytes).
+  size_t read_values_capacity;
+  /// @brief Redo log of the words written.
+  WriteLog writes;
+  /// @brief Segments allocated and freed.
+  SegmentLog segments;
+} ThreadContext;
+
+/// @brief Context of the calling thread.
+static _Thread_local ThreadContext thread_context;
+
+#endif
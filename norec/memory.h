@@ -0,0 +1,31 @@
+#ifndef _MEMORY_H_
+#define _MEMORY_H_
+
+#include <tm.h>
+#include <stdatomic.h>
+
+#include "logs.h"
+
+/// @brief Represents a region in the
+/// software transactional memory
+typedef struct _Region
+{
+  /// @brief Global sequence lock, odd while a
+  /// committing transaction writes back.
+  atomic_ulong sequence;
+  /// @brief Start of the first, non-free-able
+  /// segment of the region.
+  void *start;
+  /// @brief Size of the first segment (bytes).
+  size_t size;
+  /// @brief User requested alignment
+  /// of the memory segments (bytes)
+  size_t align;
+  /// @brief Log2 of the alignment, used for
+  /// indexing the written words.
+  unsigned int shift;
+  /// @brief Segments allocated in transactions.
+  Segments segments;
+} Region;
+
+#endif
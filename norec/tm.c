@@ -0,0 +1,226 @@
+#define _GNU_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#ifdef __STDC_NO_ATOMICS__
+#error Current C11 compiler does not support atomic operations
+#endif
+
+#include <tm_ext.h>
+
+#include "memory.h"
+#include "basic_operations.h"
+
+/** Create (i.e. allocate + init) a new shared memory region, with one first non-free-able allocated segment of the requested size and alignment.
+ * @param size  Size of the first shared segment of memory to allocate (in bytes), must be a positive multiple of the alignment
+ * @param align Alignment (in bytes, must be a power of 2) that the shared memory region must support
+ * @return Opaque shared memory region handle, 'invalid_shared' on failure
+ **/
+shared_t tm_create(size_t size, size_t align)
+{
+  // Allocating Memory for the region
+  Region *region = malloc(sizeof(Region));
+  if (region == NULL)
+  {
+    return invalid_shared;
+  }
+
+  // Initializing Region
+  region->size = size;
+  region->align = align;
+  region->shift = __builtin_ctzl(align);
+  atomic_store(&(region->sequence), 0);
+  if (!InitSegments(&(region->segments), align))
+  {
+    free(region);
+    return invalid_shared;
+  }
+
+  // Allocating the first segment
+  size_t true_align = align < sizeof(void *) ? sizeof(void *) : align;
+  if (posix_memalign(&(region->start), true_align, size) != 0)
+  {
+    DestroySegments(&(region->segments));
+    free(region);
+    return invalid_shared;
+  }
+  memset(region->start, 0, size);
+
+  return region;
+}
+
+/** Destroy (i.e. clean-up + free) a given shared memory region.
+ * @param shared Shared memory region to destroy, with no running transaction
+ **/
+void tm_destroy(shared_t shared)
+{
+  Region *region = shared;
+
+  // Deallocating all the segments in the region, freed or not
+  DestroySegments(&(region->segments));
+  free(region->start);
+
+  // Deallocating region itself
+  free(region);
+}
+
+/** [thread-safe] Return the start address of the first allocated segment in the shared memory region.
+ * @param shared Shared memory region to query
+ * @return Start address of the first allocated segment
+ **/
+void *tm_start(shared_t shared) { return ((Region *)shared)->start; }
+
+/** [thread-safe] Return the size (in bytes) of the first allocated segment of the shared memory region.
+ * @param shared Shared memory region to query
+ * @return First allocated segment size
+ **/
+size_t tm_size(shared_t shared) { return ((Region *)shared)->size; }
+
+/** [thread-safe] Return the alignment (in bytes) of the memory accesses on the given shared memory region.
+ * @param shared Shared memory region to query
+ * @return Alignment used globally
+ **/
+size_t tm_align(shared_t shared) { return ((Region *)shared)->align; }
+
+/** [thread-safe] Begin a new transaction on the given shared memory region.
+ * @param shared Shared memory region to start a transaction on
+ * @param is_ro  Whether the transaction is read-only
+ * @return Opaque transaction ID, 'invalid_tx' on failure
+ **/
+tx_t tm_begin(shared_t shared, bool is_ro)
+{
+  Region *region = (Region *)shared;
+  Reader *reader = ReaderOf(&(region->segments), &thread_context, &(thread_context.reader), &(thread_context.reader_id));
+  if (unlikely(reader == NULL))
+  {
+    return invalid_tx;
+  }
+
+  // Starting from a region no one is writing back to, a segment freed
+  // before the snapshot is published cannot be read as every read
+  // revalidates once the sequence moved
+  thread_context.region = region;
+  thread_context.is_ro = is_ro;
+  thread_context.snapshot = Quiescent(region);
+  atomic_store(&(reader->since), thread_context.snapshot);
+  return (tx_t)&thread_context;
+}
+
+/** [thread-safe] End the given transaction.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to end
+ * @return Whether the whole transaction committed
+ **/
+bool tm_end(shared_t shared, tx_t unused(tx))
+{
+  return Commit((Region *)shared);
+}
+
+/** [thread-safe] Read operation in the given transaction, source in the shared region and target in a private region.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to use
+ * @param source Source start address (in the shared region)
+ * @param size   Length to copy (in bytes), must be a positive multiple of the alignment
+ * @param target Target start address (in a private region)
+ * @return Whether the whole transaction can continue
+ **/
+bool tm_read(shared_t shared, tx_t unused(tx), void const *source, size_t size, void *target)
+{
+  Region *region = (Region *)shared;
+
+  for (size_t offset = 0; offset < size; offset += region->align)
+  {
+    void const *word = (char const *)source + offset;
+
+    // Reading our own write from the redo log
+    char const *value = FindWrite(&(thread_context.writes), region->align, region->shift, word);
+    if (value != NULL)
+    {
+      memcpy((char *)target + offset, value, region->align);
+      continue;
+    }
+
+    // Reading the word, logging its value so that later
+    // reads can check it did not change
+    if (!ReadWord(region, word, (char *)target + offset) || !LogRead(word, (char *)target + offset))
+    {
+      Rollback();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/** [thread-safe] Write operation in the given transaction, source in a private region and target in the shared region.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to use
+ * @param source Source start address (in a private region)
+ * @param size   Length to copy (in bytes), must be a positive multiple of the alignment
+ * @param target Target start address (in the shared region)
+ * @return Whether the whole transaction can continue
+ **/
+bool tm_write(shared_t shared, tx_t unused(tx), void const *source, size_t size, void *target)
+{
+  Region *region = (Region *)shared;
+
+  // Deferring the writes to the commit
+  for (size_t offset = 0; offset < size; offset += region->align)
+  {
+    if (!LogWrite(&(thread_context.writes), region->align, region->shift, (char *)target + offset, (char const *)source + offset))
+    {
+      Rollback();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/** [thread-safe] Memory allocation in the given transaction.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to use
+ * @param size   Allocation requested size (in bytes), must be a positive multiple of the alignment
+ * @param target Pointer in private memory receiving the address of the first byte of the newly allocated, aligned segment
+ * @return Whether the whole transaction can continue (success/nomem), or not (abort_alloc)
+ **/
+alloc_t tm_alloc(shared_t shared, tx_t unused(tx), size_t size, void **target)
+{
+  Region *region = (Region *)shared;
+  void *words = AllocSegment(&(region->segments), &(thread_context.segments), size, region->align);
+  if (words == NULL)
+  {
+    return nomem_alloc;
+  }
+  *target = words;
+  return success_alloc;
+}
+
+/** [thread-safe] Memory freeing in the given transaction.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to use
+ * @param target Address of the first byte of the previously allocated segment to deallocate
+ * @return Whether the whole transaction can continue
+ **/
+bool tm_free(shared_t shared, tx_t unused(tx), void *target)
+{
+  // Transactions that read the segment before it was unlinked may still
+  // read it until they fail validation, so its memory is only retired
+  // on commit and released once every such transaction moved past it
+  if (!FreeSegment(&(((Region *)shared)->segments), &(thread_context.segments), target))
+  {
+    Rollback();
+    return false;
+  }
+  return true;
+}
+
+/** [thread-safe] Return the memory held by the given shared memory region, with no running transaction.
+ * @param shared    Shared memory region to query
+ * @param footprint Private structure receiving the byte counts
+ **/
+void tm_get_footprint(shared_t shared, footprint_t *footprint)
+{
+  Region *region = (Region *)shared;
+  unsigned long int live = atomic_load(&(region->segments.live));
+  footprint->data = region->size + live;
+  footprint->metadata = sizeof(Region) + atomic_load(&(region->segments.held)) - live;
+}
@@ -5,54 +5,367 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "coarse.h"
+#include "commutative.h"
+#include "contention.h"
+#include "deadline.h"
+#include "descriptor.h"
+#include "engine.h"
 #include "macros.h"
 #include "memory.h"
+#include "numa.h"
+#include "range_lock.h"
 #include "relinquish_cpu.h"
+#include "retry.h"
+#include "versions.h"
+#include "watchdog.h"
+
+/**
+ * @brief Checks, while holding the turn, whether an irrevocable
+ * transaction is running or waiting for the batcher to drain.
+ * @param region Region to inspect
+ * @return Whether new transactions must wait for the next epoch
+ */
+static inline bool SerialPending(Region *region)
+{
+  return atomic_load(&(region->batcher.serial)) || atomic_load(&(region->batcher.n_serial_waiting)) != 0;
+}
+
+/**
+ * @brief Gives away the turn of the batcher, skipping the
+ * tickets whose holders gave up waiting for it.
+ * @param region Region to update
+ */
+static inline void GiveGlobalTurn(Region *region)
+{
+  unsigned long int turn = atomic_fetch_add(&(region->batcher.turn), 1) + 1;
+
+  // Either the holder of the next ticket sees the turn reached
+  // it, or we see its mark, and only one of us clears the mark
+  unsigned long int mark = turn + 1;
+  while (atomic_load(&(region->batcher.abandoned[turn % ABANDONED_TICKETS])) == mark &&
+         atomic_compare_exchange_strong(&(region->batcher.abandoned[turn % ABANDONED_TICKETS]), &mark, 0))
+  {
+    turn = atomic_fetch_add(&(region->batcher.turn), 1) + 1;
+    mark = turn + 1;
+  }
+}
+
+/**
+ * @brief Waits for the turn of the batcher. A ticket given
+ * up at the deadline is marked, so that the turn skips it.
+ * @param region Region to update
+ * @param deadline When to give up, no_deadline to wait as long as needed
+ * @return Whether we got the turn, false if the deadline passed
+ */
+static inline bool TakeGlobalTurn(Region *region, deadline_t deadline)
+{
+  // Past the deadline already, only taking the turn while free: callers
+  // polling for it would give up tickets faster than the turn skips them
+  if (unlikely(DeadlineExpired(deadline)))
+  {
+    unsigned long int turn = atomic_load(&(region->batcher.turn));
+    return atomic_compare_exchange_strong(&(region->batcher.last_turn), &turn, turn + 1);
+  }
+
+  // Waiting for our turn
+  unsigned long int turn = atomic_fetch_add(&(region->batcher.last_turn), 1);
+  while (turn != atomic_load(&(region->batcher.turn)))
+  {
+    if (unlikely(DeadlineExpired(deadline)))
+    {
+      // Marking the ticket, unless the turn reached it meanwhile
+      // and the mark is ours to clear, the turn then being ours
+      atomic_ulong *abandoned = region->batcher.abandoned + turn % ABANDONED_TICKETS;
+      unsigned long int mark = turn + 1;
+      atomic_store(abandoned, mark);
+      if (turn == atomic_load(&(region->batcher.turn)) && atomic_compare_exchange_strong(abandoned, &mark, 0))
+      {
+        GiveGlobalTurn(region);
+      }
+      return false;
+    }
+    relinquish_cpu();
+  }
+  return true;
+}
+
+/**
+ * @brief Gives away our turn, to the next transaction of our
+ * node while it waits and the node did not keep it too long.
+ * @param region Region to update
+ */
+static inline void GiveTurn(Region *region)
+{
+  if (!thread_context.node_turn)
+  {
+    GiveGlobalTurn(region);
+    return;
+  }
+
+  BatcherNode *node = region->batcher.nodes + NumaNode(region);
+  if (atomic_load(&(node->last_turn)) != atomic_load(&(node->turn)) + 1 && node->passes < COHORT_PASSES)
+  {
+    ++node->passes;
+    atomic_store(&(node->passed), true);
+  }
+  else
+  {
+    node->passes = 0;
+    atomic_store(&(node->passed), false);
+    GiveGlobalTurn(region);
+  }
+  atomic_fetch_add(&(node->turn), 1);
+}
+
+/**
+ * @brief Waits for our turn to update the batcher, behind the
+ * transactions of our node, which may pass it to us. Transactions
+ * with a deadline queue for the turn of the batcher directly, so
+ * that no ticket of a node is ever given up.
+ * @param region Region to update
+ * @param deadline When to give up, no_deadline to wait as long as needed
+ * @return Whether we got the turn, false if the deadline passed
+ */
+static inline bool TakeTurn(Region *region, deadline_t deadline)
+{
+  thread_context.node_turn = deadline == no_deadline;
+  if (!thread_context.node_turn)
+  {
+    return TakeGlobalTurn(region, deadline);
+  }
+
+  // Waiting for the turn of our node
+  BatcherNode *node = region->batcher.nodes + NumaNode(region);
+  unsigned long int turn = atomic_fetch_add(&(node->last_turn), 1);
+  while (turn != atomic_load(&(node->turn)))
+  {
+    relinquish_cpu();
+  }
+
+  // Unless passed along, waiting for the turn of the batcher
+  if (!atomic_load(&(node->passed)))
+  {
+    TakeGlobalTurn(region, no_deadline);
+  }
+  return true;
+}
+
+/**
+ * @brief Checks, while holding the turn, whether
+ * other transactions wait for the turn.
+ * @param region Region to inspect
+ * @return Whether the turn is awaited
+ */
+static inline bool TurnAwaited(Region *region)
+{
+  if (atomic_load(&(region->batcher.last_turn)) != atomic_load(&(region->batcher.turn)) + 1)
+  {
+    return true;
+  }
+  BatcherNode *node = region->batcher.nodes + NumaNode(region);
+  return thread_context.node_turn && atomic_load(&(node->last_turn)) != atomic_load(&(node->turn)) + 1;
+}
+
+/**
+ * @brief Counts, while holding the turn, a transaction entering
+ * the batcher from the node of the calling thread.
+ * @param region Region entered
+ */
+static inline void CountEnter(Region *region)
+{
+  if (atomic_fetch_add(&(region->batcher.nodes[NumaNode(region)].n_entered), 1) == 0)
+  {
+    atomic_fetch_add(&(region->batcher.n_entered), 1);
+  }
+}
+
+/**
+ * @brief Counts, while holding the turn, a transaction leaving
+ * the batcher. A coroutine resumed on another node leaves from
+ * a node it did not enter from, any node with transactions
+ * entered then counting it instead.
+ * @param region Region left
+ * @return Whether the batcher is empty
+ */
+static inline bool CountLeave(Region *region)
+{
+  size_t node = NumaNode(region);
+  while (atomic_load(&(region->batcher.nodes[node].n_entered)) == 0)
+  {
+    node = (node + 1) % region->numa.n_nodes;
+  }
+  return atomic_fetch_add(&(region->batcher.nodes[node].n_entered), -1) == 1 && atomic_fetch_add(&(region->batcher.n_entered), -1) == 1;
+}
+
+/**
+ * @brief Gives away our turn and waits for the next epoch.
+ * @param region Region to wait on
+ * @param deadline When to give up, no_deadline to wait as long as needed
+ * @return Whether the epoch ended
+ */
+static inline bool AwaitEpoch(Region *region, deadline_t deadline)
+{
+  // Announcing ourselves while we hold the turn, so that the next
+  // holder sees us although we no longer hold a ticket
+  unsigned long int last = atomic_load(&(region->batcher.counter));
+  atomic_fetch_add(&(region->batcher.n_epoch_waiting), 1);
+  GiveTurn(region);
+
+  // Polling the copy of the counter on our node
+  unsigned long int since = 0;
+  atomic_ulong *epoch = NumaEpoch(region);
+  while (atomic_load(epoch) <= last)
+  {
+    if (DeadlineExpired(deadline))
+    {
+      atomic_fetch_add(&(region->batcher.n_epoch_waiting), -1);
+      return false;
+    }
+    WatchdogCheck(region, last, &since);
+    relinquish_cpu();
+  }
+  atomic_fetch_add(&(region->batcher.n_epoch_waiting), -1);
+  return true;
+}
+
+/**
+ * @brief Checks, while holding the turn, whether a transaction of
+ * the priority class must let the high-priority ones enter first.
+ * @param region Region to inspect
+ * @param priority Priority class of the transaction
+ * @return Whether the transaction must give away its turn
+ */
+static inline bool PriorityYields(Region *region, int priority)
+{
+  return priority == PRIORITY_LOW && atomic_load(&(region->batcher.n_high_waiting)) != 0;
+}
+
+/**
+ * @brief Waits, without holding a ticket that would make the turn
+ * go through us, until no high-priority transaction waits to enter.
+ * @param region Region to enter
+ * @param priority Priority class of the transaction
+ * @param deadline When to give up, no_deadline to wait as long as needed
+ * @return Whether the transaction may take its turn
+ */
+static inline bool PriorityAwait(Region *region, int priority, deadline_t deadline)
+{
+  while (PriorityYields(region, priority))
+  {
+    if (DeadlineExpired(deadline))
+    {
+      return false;
+    }
+    relinquish_cpu();
+  }
+  return true;
+}
 
-static inline tx_t Enter(Region *region, bool is_ro)
+/**
+ * @brief Returns the number of write slots of the epoch a transaction
+ * of the priority class must leave to the high-priority ones.
+ * @param region Region to inspect
+ * @param priority Priority class of the transaction
+ * @return Number of slots the transaction cannot take
+ */
+static inline unsigned long int PriorityReserved(Region *region, int priority)
+{
+  unsigned long int last = atomic_load(&(region->batcher.last_high));
+  if (priority == PRIORITY_HIGH || last == 0 || atomic_load(&(region->batcher.counter)) + 1 - last > PRIORITY_RESERVE_EPOCHS)
+  {
+    return 0;
+  }
+  return PRIORITY_RESERVED_SLOTS;
+}
+
+/**
+ * @brief Enters the batcher, waiting for the next epoch when
+ * no write slot is left or an irrevocable transaction runs.
+ * @param region Region to run on
+ * @param is_ro Whether the transaction is read only
+ * @param priority Priority class of the transaction
+ * @param deadline When to give up, no_deadline to wait as long as needed
+ * @return Identifier of the transaction, invalid_tx if the deadline passed
+ */
+static inline tx_t EnterBatcher(Region *region, bool is_ro, int priority, deadline_t deadline)
 {
   if (is_ro)
   {
-    // Waiting for our turn
-    unsigned long int turn = atomic_fetch_add(&(region->batcher.last_turn), 1);
-    while (turn != atomic_load(&(region->batcher.turn)))
+    while (true)
     {
-      relinquish_cpu();
+      if (!PriorityAwait(region, priority, deadline) || !TakeTurn(region, deadline))
+      {
+        return invalid_tx;
+      }
+
+      if (!SerialPending(region))
+      {
+        if (!PriorityYields(region, priority))
+        {
+          // We can proceed
+          break;
+        }
+
+        // Giving away turn to the high-priority transactions, which
+        // may not be enough to commit the epoch we would wait for
+        GiveTurn(region);
+        continue;
+      }
+
+      // Giving away turn and waiting for next epoch
+      if (!AwaitEpoch(region, deadline))
+      {
+        return invalid_tx;
+      }
     }
 
     // Incrementing number of transactions that entered in batcher
-    atomic_fetch_add(&(region->batcher.n_entered), 1);
+    CountEnter(region);
 
     // Giving away our turn
-    atomic_fetch_add(&(region->batcher.turn), 1);
+    GiveTurn(region);
 
     return RO_OWNER;
   }
 
   while (true)
   {
-    // Waiting for our turn
-    unsigned long int turn = atomic_fetch_add(&(region->batcher.last_turn), 1);
-    while (turn != atomic_load(&(region->batcher.turn)))
+    if (!PriorityAwait(region, priority, deadline) || !TakeTurn(region, deadline))
     {
-      relinquish_cpu();
+      return invalid_tx;
     }
 
-    if (atomic_load(&(region->batcher.n_write_slots)) != 0)
+    if (PriorityYields(region, priority) && !SerialPending(region))
     {
+      // Giving away turn to the high-priority transactions
+      GiveTurn(region);
+      continue;
+    }
+
+    if (atomic_load(&(region->batcher.n_write_slots)) > PriorityReserved(region, priority) && !SerialPending(region))
+    {
+      // Alone in the batcher with no one queued, waiting for the next
+      // epoch nor any other high-priority transaction waiting, after an
+      // epoch with a single writer, taking the write slots of the whole
+      // epoch, which the same writer would otherwise keep taking
+      unsigned long int others_high = atomic_load(&(region->batcher.n_high_waiting)) - (priority == PRIORITY_HIGH);
+      if (atomic_load(&(region->batcher.solo)) && atomic_load(&(region->batcher.n_entered)) == 0 && !TurnAwaited(region) && others_high == 0 && atomic_load(&(region->batcher.n_epoch_waiting)) == 0)
+      {
+        atomic_store(&(region->batcher.exclusive), true);
+        atomic_store(&(region->batcher.n_write_slots), 0);
+        break;
+      }
+
       // We can proceed
       atomic_fetch_add(&(region->batcher.n_write_slots), -1);
       break;
     }
 
-    // Giving away turn
-    atomic_fetch_add(&(region->batcher.turn), 1);
-
-    // Waiting for next epoch
-    unsigned long int last = atomic_load(&(region->batcher.counter));
-    while (last == atomic_load(&(region->batcher.counter)))
+    // Giving away turn and waiting for next epoch
+    if (!AwaitEpoch(region, deadline))
     {
-      relinquish_cpu();
+      return invalid_tx;
     }
   }
 
@@ -60,26 +373,128 @@ static inline tx_t Enter(Region *region, bool is_ro)
   tx_t tx = atomic_fetch_add(&(region->batcher.n_write_entered), 1) + 1;
 
   // Incrementing number of transactions entered,
-  atomic_fetch_add(&(region->batcher.n_entered), 1);
+  CountEnter(region);
 
   // Giving away our turn
-  atomic_fetch_add(&(region->batcher.turn), 1);
+  GiveTurn(region);
+
+  // Accounting for retries and publishing our karma
+  ContentionBegin(region, tx);
 
   return tx;
 }
 
-static inline bool Leave(Region *region, tx_t tx)
+/**
+ * @brief Enters the batcher in a priority class. High-priority
+ * transactions announce themselves while they wait, so that the
+ * low-priority ones let them in first and the others leave them
+ * the reserved write slots.
+ * @param region Region to run on
+ * @param is_ro Whether the transaction is read only
+ * @param priority Priority class of the transaction
+ * @param deadline When to give up, no_deadline to wait as long as needed
+ * @return Identifier of the transaction, invalid_tx if the deadline passed
+ */
+static inline tx_t Enter(Region *region, bool is_ro, int priority, deadline_t deadline)
 {
-  // Waiting for our turn
-  unsigned long int turn = atomic_fetch_add(&(region->batcher.last_turn), 1);
-  while (turn != atomic_load(&(region->batcher.turn)))
+  if (likely(priority != PRIORITY_HIGH))
   {
+    return EnterBatcher(region, is_ro, priority, deadline);
+  }
+
+  atomic_fetch_add(&(region->batcher.n_high_waiting), 1);
+  atomic_store(&(region->batcher.last_high), atomic_load(&(region->batcher.counter)) + 1);
+  tx_t tx = EnterBatcher(region, is_ro, priority, deadline);
+  atomic_fetch_add(&(region->batcher.n_high_waiting), -1);
+  return tx;
+}
+
+/**
+ * @brief Begins an irrevocable write transaction. New transactions are
+ * kept out until every running one has left, then the transaction runs
+ * alone in its own epoch, without locking, and never conflicts.
+ * @param region Region to run on
+ * @param deadline When to give up, no_deadline to wait as long as needed
+ * @return Identifier of the transaction, invalid_tx if the deadline passed
+ */
+static inline tx_t EnterSerial(Region *region, deadline_t deadline)
+{
+  // Keeping new transactions out of the batcher
+  atomic_fetch_add(&(region->batcher.n_serial_waiting), 1);
+
+  unsigned long int since = 0;
+  while (true)
+  {
+    if (!TakeTurn(region, deadline))
+    {
+      // Letting new transactions in again
+      atomic_fetch_add(&(region->batcher.n_serial_waiting), -1);
+      return invalid_tx;
+    }
+
+    if (!atomic_load(&(region->batcher.serial)) && atomic_load(&(region->batcher.n_entered)) == 0)
+    {
+      // The batcher is empty, taking the whole epoch
+      atomic_store(&(region->batcher.serial), true);
+      atomic_store(&(region->batcher.exclusive), true);
+      atomic_store(&(region->batcher.n_write_slots), 0);
+      break;
+    }
+
+    // Giving away turn
+    GiveTurn(region);
+    WatchdogCheck(region, atomic_load(&(region->batcher.counter)), &since);
     relinquish_cpu();
   }
+  atomic_fetch_add(&(region->batcher.n_serial_waiting), -1);
+
+  // Entering as the only transaction of the epoch
+  tx_t tx = atomic_fetch_add(&(region->batcher.n_write_entered), 1) + 1;
+  CountEnter(region);
+
+  // Giving away our turn
+  GiveTurn(region);
+
+  ContentionBegin(region, tx);
+  DescriptorCount(region, offsetof(Stats, serials));
+
+  return tx;
+}
+
+/**
+ * @brief Leaves the batcher, committing the epoch if last. A committed
+ * writer returns without waiting for the epoch to commit.
+ * @param region Region the transaction ran on
+ * @param tx Transaction leaving
+ * @param committed Whether the transaction committed
+ * @return Epoch from which the writes of the transaction are
+ * visible, 0 if there is nothing to wait for
+ */
+static inline unsigned long int Leave(Region *region, tx_t tx, bool committed)
+{
+  unsigned long int ticket = 0;
+
+  // Waiting for our turn, unless taken without waiting already
+  if (!thread_context.turn_held)
+  {
+    TakeTurn(region, no_deadline);
+  }
+  thread_context.turn_held = false;
 
   // Check if this is the last write transaction
-  if (atomic_fetch_add(&region->batcher.n_entered, -1) == 1 && atomic_load(&(region->batcher.n_write_entered)))
+  if (CountLeave(region) && atomic_load(&(region->batcher.n_write_entered)))
   {
+    // Stamp of the values committed by this epoch
+    unsigned long int epoch = atomic_load(&(region->batcher.counter)) + 1;
+
+    // The exclusive writer of the epoch left the control words
+    // untouched, only the words it wrote need to be copied
+    bool exclusive = atomic_load(&(region->batcher.exclusive));
+
+    // Looking for the words changed by the epoch, only while some thread waits for a change
+    uint64_t written[RETRY_SIGNATURE_WORDS] = {0};
+    bool watched = atomic_load(&(region->retry.sleepers)) != 0;
+
     // Write transaction
     for (size_t i = region->index - 1; i < region->index; --i)
     {
@@ -97,51 +512,148 @@ static inline bool Leave(Region *region, tx_t tx)
         else
         {
           // Freeing allocated space
-          free(segment->data);
-          segment->data = NULL;
+          MvccRelease(region, segment);
+          free(atomic_load(&(segment->debits)));
+          atomic_store(&(segment->debits), NULL);
+          RangeFree(segment);
         }
       }
-      else
+      else if (atomic_load(&(segment->owner)) != PRIVATE_OWNER)
       {
-        // Commiting writes
-        memcpy(segment->data, (char *)(segment->data) + segment->size, segment->size);
+        size_t first = 0;
+        size_t last = segment->size / region->align;
+        if (exclusive)
+        {
+          first = segment->dirty_first;
+          last = segment->dirty_last;
+        }
+
+        if (unlikely(watched))
+        {
+          RetryScan(region, segment, first, last, written);
+        }
 
-        // Reseting all the locks
-        bzero((char *)(segment->data) + (segment->size << 1), (segment->size / region->align) * sizeof(tx_t));
+        // Commiting writes, keeping the replaced values for snapshot readers
+        atomic_ulong *versions = atomic_load(&(segment->versions));
+        if (versions != NULL)
+        {
+          MvccCommit(region, segment, versions, epoch, first, last);
+        }
+        else
+        {
+          memcpy((char *)(segment->data) + first * region->align, (char *)(segment->data) + segment->size + first * region->align, (last - first) * region->align);
+        }
+        segment->dirty_first = 0;
+        segment->dirty_last = 0;
+
+        if (!exclusive)
+        {
+          // Reseting all the locks
+          bzero((char *)(segment->data) + (segment->size << 1), (segment->size / region->align) * sizeof(tx_t));
+
+          // Reseting the pending debits
+          AddReset(segment, region->align);
+
+          // Releasing all the range locks
+          RangeReset(segment);
+        }
       }
 
-      // Resetting owner and status flags
-      atomic_store(&(segment->owner), NO_OWNER);
-      atomic_store(&(segment->status), DEFAULT);
+      // Resetting owner and status flags, a privatized segment
+      // becoming private once its last writes are committed
+      if (atomic_load(&(segment->owner)) != PRIVATE_OWNER)
+      {
+        atomic_store(&(segment->owner), atomic_load(&(segment->status)) == PRIVATIZED ? PRIVATE_OWNER : NO_OWNER);
+        atomic_store(&(segment->status), DEFAULT);
+      }
     }
 
     // Resetting n_write_slots
     atomic_store(&(region->batcher.n_write_slots), MAX_WRITE_TX_PER_EPOCH);
 
+    // Granting the next epoch exclusively after a single writer
+    atomic_store(&(region->batcher.solo), atomic_load(&(region->batcher.n_write_entered)) == 1);
+
     // Resetting n_write_entered
     atomic_store(&(region->batcher.n_write_entered), 0);
 
-    // Moving to next epoch
+    // Ending the irrevocable or exclusive epoch, if any
+    atomic_store(&(region->batcher.serial), false);
+    atomic_store(&(region->batcher.exclusive), false);
+
+    // Moving to next epoch, the nodes first, so that a thread seeing
+    // the new counter never waits on its node for the epoch after it
+    NumaPublish(region, epoch);
     atomic_fetch_add(&(region->batcher.counter), 1);
-  }
-  else if (tx != RO_OWNER)
-  {
-    // Giving away turn
-    atomic_fetch_add(&(region->batcher.turn), 1);
 
-    // Waiting for the next epoch for atomic consistency
-    unsigned long int epoch = atomic_load(&(region->batcher.counter));
-    while (epoch == atomic_load(&(region->batcher.counter)))
+    // Waking the threads waiting for a word the epoch changed
+    if (unlikely(watched))
     {
-      relinquish_cpu();
+      RetryWake(region, written);
     }
 
-    return true;
+    // Freeing the segments no snapshot reader can access anymore
+    MvccReclaim(region);
+    ticket = epoch;
+  }
+  else if (tx != RO_OWNER && committed)
+  {
+    // The epoch cannot commit while we hold the turn
+    ticket = atomic_load(&(region->batcher.counter)) + 1;
+  }
+  else if (tx != RO_OWNER && atomic_load(&(region->cm_policy)) == cm_wait_epoch)
+  {
+    // Giving away turn and waiting for the next epoch for atomic consistency
+    AwaitEpoch(region, no_deadline);
+
+    return 0;
   }
 
   // Giving away turn
-  atomic_fetch_add(&(region->batcher.turn), 1);
+  GiveTurn(region);
+
+  return ticket;
+}
+
+/**
+ * @brief Waits until the epoch of a ticket committed.
+ * @param region Region the ticket was taken on
+ * @param ticket Ticket to wait for
+ * @param deadline When to give up, no_deadline to wait as long as needed
+ * @return Whether the epoch committed
+ */
+static inline bool AwaitTicket(Region *region, unsigned long int ticket, deadline_t deadline)
+{
+  unsigned long int since = 0;
+  while (atomic_load(NumaEpoch(region)) < ticket)
+  {
+    if (DeadlineExpired(deadline))
+    {
+      return false;
+    }
+    WatchdogCheck(region, ticket - 1, &since);
+    relinquish_cpu();
+  }
+  return true;
+}
 
+/**
+ * @brief Waits until the writes the calling thread committed without
+ * waiting are visible, before it begins another transaction.
+ * @param region Region the next transaction runs on
+ * @param deadline When to give up, no_deadline to wait as long as needed
+ * @return Whether the writes are visible
+ */
+static inline bool AwaitOwnWrites(Region *region, deadline_t deadline)
+{
+  if (unlikely(thread_context.pending_region == region && thread_context.pending != 0))
+  {
+    if (!AwaitTicket(region, thread_context.pending, deadline))
+    {
+      return false;
+    }
+    thread_context.pending = 0;
+  }
   return true;
 }
 
@@ -151,21 +663,57 @@ static inline Segment *LookupSegment(const Region *region, const void *source)
   for (size_t i = region->index - 1; i < region->index; --i)
   {
     // Segment has been deleted
-    if (atomic_load(&(region->segments[i].owner)) == RM_OWNER)
+    tx_t owner = atomic_load(&(region->segments[i].owner));
+    if (owner == RM_OWNER)
     {
       return NULL;
     }
 
-    // Check if source is contained within segment's range
+    // Check if source is contained within segment's range, which
+    // transactions cannot access while the segment is private
     if ((char *)source >= (char *)region->segments[i].data && (char *)source < (char *)region->segments[i].data + region->segments[i].size)
     {
-      return region->segments + i;
+      return owner == PRIVATE_OWNER ? NULL : region->segments + i;
     }
   }
   return NULL;
 }
 
-bool Lock(Region *region, Segment *segment, tx_t tx, void *target, size_t size)
+/**
+ * @brief Marks a word as read by tx, either with -tx
+ * or, when others read it too, with RO_OWNER.
+ * @param control Control word of the word
+ * @param tx Transaction reading the word
+ * @param found Receives the value found on failure
+ * @return Whether the word can be read
+ */
+static inline bool MarkRead(atomic_tx *control, tx_t tx, tx_t *found)
+{
+  tx_t expected = NO_OWNER;
+  bool marked = atomic_compare_exchange_strong(control, &expected, -tx) || expected == -tx || expected == RO_OWNER || (expected > RO_OWNER && atomic_compare_exchange_strong(control, &expected, RO_OWNER));
+  *found = expected;
+  return marked;
+}
+
+/**
+ * @brief Releases the words of a chunk that were acquired by a failing
+ * Lock. They were never written by us, and might lie inside the range
+ * of someone else who already wrote them, so they are not restored.
+ * @param controls Control words of the chunk
+ * @param acquired Mask of the words acquired in the chunk
+ */
+static inline void LockHandBack(atomic_tx *controls, uint64_t acquired)
+{
+  for (size_t i = 0; acquired != 0; ++i, acquired >>= 1)
+  {
+    if (acquired & 1)
+    {
+      atomic_store(controls + i, NO_OWNER);
+    }
+  }
+}
+
+abort_reason_t Lock(Region *region, Segment *segment, tx_t tx, void *target, size_t size)
 {
   // Beggining of the control words
   size_t base_index = ((char *)target - (char *)segment->data) / region->align;
@@ -173,29 +721,79 @@ bool Lock(Region *region, Segment *segment, tx_t tx, void *target, size_t size)
   // Getting the beggining of the controls words
   atomic_tx *controls = (atomic_tx *)((char *)segment->data + (segment->size << 1)) + base_index;
 
-  // For each requested word
+  // Large writes are locked as a single range when a slot is free
   size_t max = size / region->align;
-  for (size_t i = 0; i < max; ++i)
+  if (size >= RANGE_LOCK_THRESHOLD)
+  {
+    switch (RangeLockAcquire(segment, tx, base_index, base_index + max))
+    {
+    case RANGE_LOCKED:
+      return abort_none;
+    case RANGE_CONFLICT:
+      return abort_write_write;
+    case RANGE_READ_CONFLICT:
+      return abort_read_write;
+    case RANGE_FULL:
+      break;
+    }
+  }
+
+  // For each chunk of requested words
+  for (size_t first = 0; first < max; first += LOCK_CHUNK_WORDS)
   {
-    tx_t expected1 = 0, expected2 = -tx;
-    if (!(atomic_compare_exchange_strong(controls + i, &expected1, tx) || expected1 == tx || atomic_compare_exchange_strong(controls + i, &expected2, tx)))
+    size_t last = first + LOCK_CHUNK_WORDS < max ? first + LOCK_CHUNK_WORDS : max;
+
+    // Words of the chunk we did not own before this call
+    uint64_t acquired = 0;
+    for (size_t i = first; i < last; ++i)
     {
-      if (i > 1)
+      for (unsigned int attempt = 0;; ++attempt)
       {
-        bzero(controls, (i - 1) * sizeof(tx_t));
+        tx_t expected1 = 0, expected2 = -tx;
+        if (atomic_compare_exchange_strong(controls + i, &expected1, tx) || expected1 == tx || atomic_compare_exchange_strong(controls + i, &expected2, tx))
+        {
+          acquired |= expected1 == tx ? 0 : (uint64_t)1 << (i - first);
+          break;
+        }
+
+        // A word we added to becomes ours, restored by Undo if we abort
+        if (expected2 == ADD_OWNER && AddClaim(region, segment, tx, base_index + i))
+        {
+          break;
+        }
+
+        if (!ContentionWait(region, tx, expected2, attempt))
+        {
+          // Someone else has already locked or read the word
+          LockHandBack(controls + first, acquired);
+          return ContentionReason(expected2);
+        }
       }
+    }
 
-      // Someone else has already locked the word
-      return false;
+    // Checking that no one holds the words through a range
+    if (RangeConflict(segment, tx, base_index + first, base_index + last))
+    {
+      LockHandBack(controls + first, acquired);
+      return abort_write_write;
     }
   }
 
-  // Lock was successful
-  return true;
+  return abort_none;
 }
 
-static inline void Undo(Region *region, tx_t tx)
+static inline void Undo(Region *region, tx_t tx, abort_reason_t reason)
 {
+  // The writer of the coarse engine wrote the committed copy
+  if (tx == COARSE_OWNER)
+  {
+    UndoCoarse(region, reason);
+    return;
+  }
+
+  // Withdrawing the deltas we added to shared words
+  AddUndo(region);
+
   // For each segment in region
   for (size_t i = region->index - 1; i < region->index; --i)
   {
@@ -206,7 +804,7 @@ static inline void Undo(Region *region, tx_t tx)
     {
       atomic_store(&(segment->owner), RM_OWNER);
     }
-    else if (segment->data != NULL && atomic_load(&(segment->owner)) != RM_OWNER)
+    else if (segment->data != NULL && atomic_load(&(segment->owner)) != RM_OWNER && atomic_load(&(segment->owner)) != PRIVATE_OWNER)
     {
       // Reset segment in case its ours
       if (atomic_load(&(segment->owner)) == tx)
@@ -215,6 +813,20 @@ static inline void Undo(Region *region, tx_t tx)
         atomic_store(&(segment->status), DEFAULT);
       }
 
+      // An irrevocable or exclusive transaction only aborts on a bad
+      // address, and wrote its dirty words without locking them
+      if (unlikely(atomic_load(&(region->batcher.exclusive))))
+      {
+        size_t first = segment->dirty_first * region->align;
+        memcpy((char *)segment->data + segment->size + first, (char *)segment->data + first, segment->dirty_last * region->align - first);
+        segment->dirty_first = 0;
+        segment->dirty_last = 0;
+        continue;
+      }
+
+      // Restoring the ranges we locked
+      RangeUndo(segment, tx, region->align);
+
       // Control words
       atomic_tx *controls = (atomic_tx *)((char *)segment->data + (segment->size << 1));
 
@@ -239,7 +851,11 @@ static inline void Undo(Region *region, tx_t tx)
   }
 
   // Leaving transaction
-  Leave(region, tx);
+  Leave(region, tx, false);
+  EngineLeave(region);
+
+  // Recording the reason and backing off if requested
+  ContentionAbort(region, reason);
 }
 
 #endif
\ No newline at end of file
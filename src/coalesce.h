@@ -0,0 +1,72 @@
+#ifndef _COALESCE_H_
+#define _COALESCE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <tm_ext.h>
+
+#include "macros.h"
+#include "relinquish_cpu.h"
+
+/**
+ * @brief Runs closures of a batch under as few transactions as possible.
+ * Each closure runs after a savepoint, so that one hitting a conflict is
+ * rolled back and retried in the next transaction while the others still
+ * commit. If the transaction aborts as a whole, the batch is split in two
+ * halves run one after the other, down to closures running alone.
+ * @param shared Region to run on
+ * @param closures Closures of the batch
+ * @param args Argument of each closure
+ * @param order Indices of the closures left to run
+ * @param n Number of closures left to run
+ * @param deferred Room for n indices, of the closures to retry
+ */
+static inline void CoalesceRun(shared_t shared, tx_closure_t const *closures, void *const *args, size_t *order, size_t n, size_t *deferred)
+{
+  while (n != 0)
+  {
+    tx_t tx = tm_begin(shared, false);
+    if (unlikely(tx == invalid_tx))
+    {
+      relinquish_cpu();
+      continue;
+    }
+
+    // Running each closure from a savepoint of its own
+    size_t n_deferred = 0;
+    bool aborted = false;
+    for (size_t i = 0; i < n && !aborted; ++i)
+    {
+      savepoint_t savepoint = tm_savepoint(shared, tx);
+      if (closures[order[i]](shared, tx, args[order[i]]))
+      {
+        continue;
+      }
+
+      // Only the closure is rolled back, unless the whole transaction aborted
+      aborted = savepoint == no_savepoint || !tm_rollback_to(shared, tx, savepoint);
+      deferred[n_deferred++] = order[i];
+    }
+
+    if (!aborted && tm_end(shared, tx))
+    {
+      // Retrying the closures that conflicted
+      for (size_t i = 0; i < n_deferred; ++i)
+      {
+        order[i] = deferred[i];
+      }
+      n = n_deferred;
+    }
+    else if (n > 1)
+    {
+      // Splitting the batch, the halves conflicting less
+      size_t half = n >> 1;
+      CoalesceRun(shared, closures, args, order, half, deferred);
+      CoalesceRun(shared, closures, args, order + half, n - half, deferred + half);
+      return;
+    }
+  }
+}
+
+#endif
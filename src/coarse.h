@@ -0,0 +1,230 @@
+#ifndef _COARSE_H_
+#define _COARSE_H_
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "context.h"
+#include "contention.h"
+#include "deadline.h"
+#include "descriptor.h"
+#include "engine.h"
+#include "macros.h"
+#include "memory.h"
+#include "range_lock.h"
+#include "retry.h"
+#include "versions.h"
+
+/**
+ * @brief Begins a transaction of the coarse engine. Readers share the
+ * region lock and writers hold it exclusively, both accessing the
+ * committed copy directly.
+ * @param region Region to run on
+ * @param is_ro Whether the transaction is read only
+ * @param deadline When to give up, no_deadline to wait as long as needed
+ * @return Handle of the transaction, invalid_tx if the deadline passed
+ */
+static inline tx_t EnterCoarse(Region *region, bool is_ro, deadline_t deadline)
+{
+  if (deadline != no_deadline)
+  {
+    struct timespec time = DeadlineTimespec(deadline);
+    if ((is_ro ? pthread_rwlock_clockrdlock : pthread_rwlock_clockwrlock)(&(region->engine.lock), CLOCK_MONOTONIC, &time) != 0)
+    {
+      return invalid_tx;
+    }
+  }
+  else if (is_ro)
+  {
+    pthread_rwlock_rdlock(&(region->engine.lock));
+  }
+  else
+  {
+    pthread_rwlock_wrlock(&(region->engine.lock));
+  }
+
+  if (is_ro)
+  {
+    return RO_OWNER;
+  }
+
+  DescriptorLogs *logs = LogsOf(region);
+  if (logs != NULL)
+  {
+    logs->n_undos = 0;
+    logs->undo_size = 0;
+  }
+  return COARSE_OWNER;
+}
+
+/**
+ * @brief Logs the current value of words the writer of the coarse
+ * engine, or a writer holding savepoints, is about to overwrite.
+ * @param region Region the transaction runs on
+ * @param target Address of the first word
+ * @param size Number of bytes to overwrite
+ * @return Whether the value could be logged
+ */
+static inline bool CoarseLog(Region *region, void *target, size_t size)
+{
+  DescriptorLogs *logs = LogsOf(region);
+  if (unlikely(logs == NULL))
+  {
+    return false;
+  }
+
+  if (unlikely(logs->n_undos == logs->undos_capacity))
+  {
+    size_t capacity = logs->undos_capacity == 0 ? 16 : logs->undos_capacity << 1;
+    UndoEntry *undos = realloc(logs->undos, capacity * sizeof(UndoEntry));
+    if (undos == NULL)
+    {
+      return false;
+    }
+    logs->undos = undos;
+    logs->undos_capacity = capacity;
+  }
+
+  if (unlikely(logs->undo_size + size > logs->undo_capacity))
+  {
+    size_t capacity = logs->undo_capacity == 0 ? 256 : logs->undo_capacity;
+    while (capacity < logs->undo_size + size)
+    {
+      capacity <<= 1;
+    }
+    char *values = realloc(logs->undo_values, capacity);
+    if (values == NULL)
+    {
+      return false;
+    }
+    logs->undo_values = values;
+    logs->undo_capacity = capacity;
+  }
+
+  UndoEntry *entry = logs->undos + logs->n_undos++;
+  entry->target = target;
+  entry->size = size;
+  memcpy(logs->undo_values + logs->undo_size, target, size);
+  logs->undo_size += size;
+  return true;
+}
+
+/**
+ * @brief Settles the segments the writer of the coarse engine allocated
+ * or freed, removing the freed ones when they are last as Leave does.
+ * @param region Region the transaction ran on
+ */
+static inline void CoarseSettle(Region *region)
+{
+  for (size_t i = region->index - 1; i < region->index; --i)
+  {
+    Segment *segment = region->segments + i;
+    tx_t owner = atomic_load(&(segment->owner));
+    if (owner != COARSE_OWNER && owner != RM_OWNER)
+    {
+      continue;
+    }
+
+    int status = atomic_load(&(segment->status));
+    if (owner == RM_OWNER || status == REMOVED || status == ADDED_AFTER_REMOVE)
+    {
+      unsigned long int expected = i + 1;
+      if (atomic_compare_exchange_strong(&(region->index), &expected, i))
+      {
+        // Freeing allocated space
+        MvccRelease(region, segment);
+        free(atomic_load(&(segment->debits)));
+        atomic_store(&(segment->debits), NULL);
+        RangeFree(segment);
+      }
+    }
+
+    // Resetting owner and status flags, a privatized segment becoming
+    // private with the values it had kept in its writable copy
+    if (status == PRIVATIZED)
+    {
+      memcpy((char *)segment->data + segment->size, segment->data, segment->size);
+    }
+    atomic_store(&(segment->owner), status == PRIVATIZED ? PRIVATE_OWNER : NO_OWNER);
+    atomic_store(&(segment->status), DEFAULT);
+  }
+}
+
+/**
+ * @brief Ends a transaction of the coarse engine.
+ * @param region Region the transaction ran on
+ * @param tx Transaction ending
+ */
+static inline void LeaveCoarse(Region *region, tx_t tx)
+{
+  // The words overwritten are the ones logged, only looked
+  // for while some thread waits for a change
+  uint64_t written[RETRY_SIGNATURE_WORDS] = {0};
+  bool watched = tx == COARSE_OWNER && atomic_load(&(region->retry.sleepers)) != 0;
+  DescriptorLogs *logs = unlikely(watched) ? LogsOf(region) : NULL;
+  for (size_t i = 0; logs != NULL && i < logs->n_undos; ++i)
+  {
+    RetrySign(written, logs->undos[i].target, logs->undos[i].size);
+  }
+
+  if (tx == COARSE_OWNER)
+  {
+    CoarseSettle(region);
+  }
+  pthread_rwlock_unlock(&(region->engine.lock));
+  EngineLeave(region);
+
+  if (unlikely(watched))
+  {
+    RetryWake(region, written);
+  }
+}
+
+/**
+ * @brief Aborts the writer of the coarse engine, restoring the words
+ * it overwrote and dropping the segments it allocated.
+ * @param region Region the transaction ran on
+ * @param reason Why the transaction aborts
+ */
+static inline void UndoCoarse(Region *region, abort_reason_t reason)
+{
+  // Restoring the words in reverse order, for the words written twice
+  DescriptorLogs *logs = LogsOf(region);
+  for (size_t i = logs != NULL ? logs->n_undos : 0; i-- > 0;)
+  {
+    UndoEntry *entry = logs->undos + i;
+    logs->undo_size -= entry->size;
+    memcpy(entry->target, logs->undo_values + logs->undo_size, entry->size);
+  }
+  if (logs != NULL)
+  {
+    logs->n_undos = 0;
+  }
+
+  for (size_t i = region->index - 1; i < region->index; --i)
+  {
+    Segment *segment = region->segments + i;
+    if (atomic_load(&(segment->owner)) != COARSE_OWNER)
+    {
+      continue;
+    }
+
+    // Undo malloc of new segment, or of the free of an old one
+    int status = atomic_load(&(segment->status));
+    if (status == ADDED || status == ADDED_AFTER_REMOVE)
+    {
+      atomic_store(&(segment->owner), RM_OWNER);
+    }
+    else
+    {
+      atomic_store(&(segment->owner), NO_OWNER);
+      atomic_store(&(segment->status), DEFAULT);
+    }
+  }
+
+  LeaveCoarse(region, COARSE_OWNER);
+  ContentionAbort(region, reason);
+}
+
+#endif
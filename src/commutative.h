@@ -0,0 +1,330 @@
+#ifndef _COMMUTATIVE_H_
+#define _COMMUTATIVE_H_
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "context.h"
+#include "contention.h"
+#include "descriptor.h"
+#include "macros.h"
+#include "memory.h"
+#include "range_lock.h"
+
+/**
+ * @brief Returns the debits of the segment, followed by the
+ * pending delta counts, allocating both on the first delta.
+ * @param segment Segment holding the words
+ * @param align Size of a word in the segment
+ * @return Debits of the segment, NULL if out of memory
+ */
+static inline atomic_delta *AddDebits(Segment *segment, size_t align)
+{
+  atomic_delta *debits = atomic_load(&(segment->debits));
+  if (likely(debits != NULL))
+  {
+    return debits;
+  }
+
+  atomic_delta *allocated = calloc((segment->size / align) << 1, sizeof(atomic_delta));
+  if (allocated == NULL)
+  {
+    return NULL;
+  }
+
+  // Someone else might have allocated them first
+  if (!atomic_compare_exchange_strong(&(segment->debits), &debits, allocated))
+  {
+    free(allocated);
+    return debits;
+  }
+  return allocated;
+}
+
+/**
+ * @brief Appends a delta to the log of the calling thread.
+ * @param logs Logs of the transaction adding
+ * @param segment Segment holding the word
+ * @param index Index of the word
+ * @param delta Delta added to the word
+ * @return Whether the log could hold the delta
+ */
+static inline bool AddLog(DescriptorLogs *logs, Segment *segment, size_t index, int64_t delta)
+{
+  if (unlikely(logs == NULL))
+  {
+    return false;
+  }
+
+  if (unlikely(logs->n_adds == logs->adds_capacity))
+  {
+    size_t capacity = logs->adds_capacity == 0 ? 16 : logs->adds_capacity << 1;
+    AddEntry *adds = realloc(logs->adds, capacity * sizeof(AddEntry));
+    if (adds == NULL)
+    {
+      return false;
+    }
+    logs->adds = adds;
+    logs->adds_capacity = capacity;
+  }
+
+  AddEntry *entry = logs->adds + logs->n_adds++;
+  entry->segment = segment;
+  entry->index = index;
+  entry->delta = delta;
+  return true;
+}
+
+/**
+ * @brief Adds delta to the 64-bit integer at target. Adders share the
+ * word by marking it ADD_OWNER, and apply their deltas right away to the
+ * writable copy with atomic additions, which Undo subtracts back. Negative
+ * deltas are also summed in the segment debits, so a guarded add can check
+ * the committed value minus every pending debit against its floor. The
+ * deltas pending on each word are counted, for an adder that accesses the
+ * word later on to tell whether it is the only one.
+ * @param region Region the transaction runs on
+ * @param segment Segment holding the word
+ * @param tx Transaction adding
+ * @param target Address of the word
+ * @param delta Delta to add
+ * @param guarded Whether the add is refused below floor
+ * @param floor Lowest value the word may reach
+ * @param refused Set when the guard refused the add
+ * @return Reason of the abort, abort_none if the transaction can continue
+ */
+static inline abort_reason_t Add(Region *region, Segment *segment, tx_t tx, void *target, int64_t delta, bool guarded, int64_t floor, bool *refused)
+{
+  size_t index = ((char *)target - (char *)segment->data) / region->align;
+  atomic_tx *control = (atomic_tx *)((char *)segment->data + (segment->size << 1)) + index;
+  int64_t *committed = (int64_t *)target;
+  int64_t *writable = (int64_t *)((char *)target + segment->size);
+
+  // Alone in the epoch, the writable value is exact and no word is locked
+  if (unlikely(atomic_load(&(region->batcher.exclusive))))
+  {
+    if (guarded && *writable + delta < floor)
+    {
+      *refused = true;
+      return abort_none;
+    }
+    RangeDirty(segment, index, index + 1);
+    *writable += delta;
+    return abort_none;
+  }
+
+  // Upgrading our read of the word, unless it lies in the range of someone else
+  bool owned = atomic_load(control) == tx;
+  tx_t expected = -tx;
+  if (!owned && atomic_compare_exchange_strong(control, &expected, tx))
+  {
+    if (unlikely(RangeConflict(segment, tx, index, index + 1)))
+    {
+      atomic_store(control, NO_OWNER);
+      return abort_write_write;
+    }
+    owned = true;
+  }
+
+  // Owning the word, the writable value is exact
+  if (owned)
+  {
+    if (guarded && *writable + delta < floor)
+    {
+      *refused = true;
+      return abort_none;
+    }
+    *writable += delta;
+    return abort_none;
+  }
+
+  // Sharing the word with the other adders
+  expected = NO_OWNER;
+  if (!(atomic_compare_exchange_strong(control, &expected, ADD_OWNER) || expected == ADD_OWNER))
+  {
+    return ContentionReason(expected);
+  }
+
+  // Checking that no one holds the word through a range
+  if (unlikely(RangeConflict(segment, tx, index, index + 1)))
+  {
+    return abort_write_write;
+  }
+
+  atomic_delta *debits = AddDebits(segment, region->align);
+  DescriptorLogs *logs = LogsOf(region);
+  if (debits == NULL || !AddLog(logs, segment, index, delta))
+  {
+    return abort_write_write;
+  }
+
+  if (delta < 0)
+  {
+    // Reserving the debit, unless it could overdraw the word
+    int64_t debit = atomic_load(debits + index);
+    do
+    {
+      if (guarded && *committed + debit + delta < floor)
+      {
+        --logs->n_adds;
+        *refused = true;
+        return abort_none;
+      }
+    } while (!atomic_compare_exchange_weak(debits + index, &debit, debit + delta));
+  }
+
+  // Counting the delta before applying it, unless an adder that
+  // accessed the word since took it as its own
+  atomic_delta *pending = debits + segment->size / region->align + index;
+  atomic_fetch_add(pending, 1);
+  if (unlikely(atomic_load(control) != ADD_OWNER))
+  {
+    atomic_fetch_add(pending, -1);
+    if (delta < 0)
+    {
+      atomic_fetch_add(debits + index, -delta);
+    }
+    --logs->n_adds;
+    return abort_write_write;
+  }
+
+  atomic_fetch_add((atomic_delta *)writable, delta);
+  return abort_none;
+}
+
+/**
+ * @brief Sums the deltas the calling thread added to a word it shares
+ * with the other adders, which only it sees before the epoch commits.
+ * @param region Region the transaction runs on
+ * @param segment Segment holding the word
+ * @param index Index of the word
+ * @param count Receives the number of deltas summed
+ * @return Sum of the deltas
+ */
+static inline int64_t AddPending(Region *region, Segment const *segment, size_t index, size_t *count)
+{
+  int64_t sum = 0;
+  *count = 0;
+  DescriptorLogs *logs = LogsOf(region);
+  for (size_t i = 0; logs != NULL && i < logs->n_adds; ++i)
+  {
+    AddEntry const *entry = logs->adds + i;
+    if (entry->segment == segment && entry->index == index)
+    {
+      sum += entry->delta;
+      ++*count;
+    }
+  }
+  return sum;
+}
+
+/**
+ * @brief Takes a word the calling thread added to as its own, for it to
+ * read or write the word afterwards. The writable value then holds its
+ * deltas on top of the committed one, which only works while no other
+ * running transaction has a delta pending on the word.
+ * @param region Region the transaction runs on
+ * @param segment Segment holding the word
+ * @param tx Transaction accessing the word
+ * @param index Index of the word
+ * @return Whether the word is now owned by tx
+ */
+static inline bool AddClaim(Region *region, Segment *segment, tx_t tx, size_t index)
+{
+  size_t count;
+  AddPending(region, segment, index, &count);
+  if (count == 0)
+  {
+    return false;
+  }
+
+  // Owning the word first, so that adders counting their delta from
+  // now on see it and back off, then checking that none did before
+  atomic_tx *control = (atomic_tx *)((char *)segment->data + (segment->size << 1)) + index;
+  tx_t expected = ADD_OWNER;
+  if (!atomic_compare_exchange_strong(control, &expected, tx))
+  {
+    return false;
+  }
+  atomic_delta *pending = atomic_load(&(segment->debits)) + segment->size / region->align + index;
+  if (atomic_load(pending) != (int64_t)count)
+  {
+    atomic_store(control, ADD_OWNER);
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Subtracts back the deltas logged by the calling
+ * thread after the first ones, which are kept.
+ * @param region Region the transaction runs on
+ * @param kept Number of deltas to keep
+ */
+static inline void AddUndoTo(Region *region, size_t kept)
+{
+  DescriptorLogs *logs = LogsOf(region);
+  if (unlikely(logs == NULL))
+  {
+    return;
+  }
+
+  for (size_t i = kept; i < logs->n_adds; ++i)
+  {
+    AddEntry *entry = logs->adds + i;
+    atomic_delta *writable = (atomic_delta *)((char *)entry->segment->data + entry->segment->size + entry->index * region->align);
+    atomic_delta *debits = atomic_load(&(entry->segment->debits));
+    atomic_fetch_add(writable, -entry->delta);
+    atomic_fetch_add(debits + entry->segment->size / region->align + entry->index, -1);
+    if (entry->delta < 0)
+    {
+      atomic_fetch_add(debits + entry->index, -entry->delta);
+    }
+  }
+  logs->n_adds = kept;
+}
+
+/**
+ * @brief Subtracts back the deltas logged by the calling thread.
+ * @param region Region the transaction ran on
+ */
+static inline void AddUndo(Region *region) { AddUndoTo(region, 0); }
+
+/**
+ * @brief Forgets the deltas logged by the calling thread, once its
+ * transaction committed. They no longer count as pending, an adder of
+ * the same epoch accessing the word afterwards seeing them as committed.
+ * @param region Region the transaction ran on
+ */
+static inline void AddForget(Region *region)
+{
+  DescriptorLogs *logs = LogsOf(region);
+  if (unlikely(logs == NULL))
+  {
+    return;
+  }
+
+  for (size_t i = 0; i < logs->n_adds; ++i)
+  {
+    AddEntry *entry = logs->adds + i;
+    atomic_fetch_add(atomic_load(&(entry->segment->debits)) + entry->segment->size / region->align + entry->index, -1);
+  }
+  logs->n_adds = 0;
+}
+
+/**
+ * @brief Resets the debits of the segment,
+ * once the epoch has been committed.
+ * @param segment Segment holding the debits
+ * @param align Size of a word in the segment
+ */
+static inline void AddReset(Segment *segment, size_t align)
+{
+  atomic_delta *debits = atomic_load(&(segment->debits));
+  if (debits != NULL)
+  {
+    bzero(debits, (segment->size / align << 1) * sizeof(atomic_delta));
+  }
+}
+
+#endif
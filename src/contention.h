@@ -0,0 +1,205 @@
+#ifndef _CONTENTION_H_
+#define _CONTENTION_H_
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "context.h"
+#include "descriptor.h"
+#include "macros.h"
+#include "memory.h"
+#include "relinquish_cpu.h"
+#include "schedule.h"
+
+/**
+ * @brief Parses the contention management policy
+ * from the TM_CM_POLICY environment variable.
+ * @return Requested policy, cm_wait_epoch by default
+ */
+static inline cm_policy_t ContentionPolicyFromEnv()
+{
+  const char *name = getenv("TM_CM_POLICY");
+  if (name == NULL)
+  {
+    return cm_wait_epoch;
+  }
+
+  if (strcmp(name, "aggressive") == 0)
+  {
+    return cm_aggressive;
+  }
+  if (strcmp(name, "backoff") == 0)
+  {
+    return cm_backoff;
+  }
+  if (strcmp(name, "karma") == 0)
+  {
+    return cm_karma;
+  }
+  return cm_wait_epoch;
+}
+
+/**
+ * @brief Accounts for the start of a write transaction.
+ * @param region Region the transaction runs on
+ * @param tx Transaction starting
+ */
+static inline void ContentionBegin(Region *region, tx_t tx)
+{
+  if (thread_context.aborts != 0)
+  {
+    DescriptorCount(region, offsetof(Stats, retries));
+  }
+  atomic_store(&(region->karma[tx]), thread_context.karma);
+}
+
+/**
+ * @brief Accounts for the work done by a transaction.
+ * @param region Region the transaction runs on
+ * @param tx Transaction doing the work
+ * @param words Number of words accessed
+ */
+static inline void ContentionWork(Region *region, tx_t tx, size_t words)
+{
+  thread_context.karma += words;
+  if (atomic_load(&(region->cm_policy)) == cm_karma)
+  {
+    atomic_store(&(region->karma[tx]), thread_context.karma);
+  }
+}
+
+/**
+ * @brief Decides whether a transaction should retry an access
+ * that conflicted with owner instead of aborting. Under the karma
+ * policy, the transaction that did the most work waits for the other
+ * one to give up, while the other one aborts right away.
+ * @param region Region the transaction runs on
+ * @param tx Transaction that hit the conflict
+ * @param owner Value found in the conflicting control word
+ * @param attempt Number of times the access was already retried
+ * @return Whether the access should be retried
+ */
+static inline bool ContentionWait(Region *region, tx_t tx, tx_t owner, unsigned int attempt)
+{
+  if (atomic_load(&(region->cm_policy)) != cm_karma || attempt >= CM_KARMA_MAX_WAITS)
+  {
+    return false;
+  }
+
+  // Only waiting on a single identified writer
+  if (owner == NO_OWNER || owner > MAX_WRITE_TX_PER_EPOCH)
+  {
+    return false;
+  }
+
+  unsigned long int ours = atomic_load(&(region->karma[tx]));
+  unsigned long int theirs = atomic_load(&(region->karma[owner]));
+  if (ours < theirs || (ours == theirs && tx > owner))
+  {
+    return false;
+  }
+
+  if (attempt == 0)
+  {
+    DescriptorCount(region, offsetof(Stats, waits));
+  }
+  relinquish_cpu();
+  return true;
+}
+
+/**
+ * @brief Classifies a conflict on a control word.
+ * @param control Value found in the conflicting control word
+ * @return Reason of the resulting abort
+ */
+static inline abort_reason_t ContentionReason(tx_t control)
+{
+  if ((control != NO_OWNER && control <= MAX_WRITE_TX_PER_EPOCH) || control == ADD_OWNER)
+  {
+    return abort_write_write;
+  }
+  return abort_read_write;
+}
+
+/**
+ * @brief Accounts for an abort, records its reason and retry hint
+ * for tm_last_abort, and backs off before letting the caller
+ * retry if requested.
+ * @param region Region the transaction ran on
+ * @param reason Why the transaction aborted
+ */
+static inline void ContentionAbort(Region *region, abort_reason_t reason)
+{
+  // Savepoints do not outlive the transaction, rolling back to
+  // one of them then telling the caller that it aborted
+  thread_context.n_savepoints = 0;
+  thread_context.savepoint_region = NULL;
+
+  // Learning from the conflict, and letting the next scheduled transactions in
+  ScheduleLeave(region, reason);
+
+  // Waiting for a change is no conflict, and must not lead to backoffs
+  // nor to the next attempt running irrevocably
+  if (reason == abort_retry)
+  {
+    thread_context.reason = reason;
+    thread_context.hint = retry_now;
+    return;
+  }
+
+  DescriptorCount(region, offsetof(Stats, aborts));
+  ++thread_context.aborts;
+
+  // Words, segments and write slots stay held until the epoch commits,
+  // which Leave has already waited for under the wait-epoch policy
+  // unless we left as a reader, the next attempt of a writer that
+  // keeps aborting runs alone, and a snapshot reader only needs
+  // a fresher snapshot, or to join the batcher once too many went stale
+  cm_policy_t policy = atomic_load(&(region->cm_policy));
+  thread_context.reason = reason;
+  if (reason == abort_snapshot_too_old)
+  {
+    thread_context.hint = retry_now;
+  }
+  else if (thread_context.aborts >= CM_SERIAL_AFTER_ABORTS)
+  {
+    thread_context.hint = retry_serial;
+  }
+  else
+  {
+    thread_context.hint = policy == cm_wait_epoch && reason != abort_epoch_full ? retry_now : retry_next_epoch;
+  }
+
+  if (policy != cm_backoff)
+  {
+    return;
+  }
+
+  if (thread_context.seed == 0)
+  {
+    thread_context.seed = (unsigned int)(uintptr_t)&thread_context;
+  }
+
+  // Randomized exponential backoff
+  unsigned long int shift = thread_context.aborts < CM_BACKOFF_MAX_SHIFT ? thread_context.aborts : CM_BACKOFF_MAX_SHIFT;
+  unsigned long int spins = (unsigned long int)rand_r(&(thread_context.seed)) % (1ul << shift);
+  DescriptorCount(region, offsetof(Stats, waits));
+  for (unsigned long int i = 0; i < spins; ++i)
+  {
+    relinquish_cpu();
+  }
+}
+
+/**
+ * @brief Accounts for a commit.
+ * @param region Region the transaction ran on
+ */
+static inline void ContentionCommit(Region *region)
+{
+  DescriptorCount(region, offsetof(Stats, commits));
+  ScheduleLeave(region, abort_none);
+  thread_context.aborts = 0;
+  thread_context.karma = 0;
+}
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef _CONTEXT_H_
+#define _CONTEXT_H_
+
+#include <stdint.h>
+
+#include <tm_ext.h>
+
+#include "memory.h"
+
+/// @brief Descriptor of the thread on a region.
+typedef struct _CachedDescriptor
+{
+  /// @brief Identifier of the region, 0 if none.
+  unsigned long int region;
+  /// @brief Descriptor of the thread on it.
+  Descriptor *descriptor;
+} CachedDescriptor;
+
+/// @brief Lengths of the logs of the current
+/// transaction when it placed a savepoint.
+typedef struct _SavepointMark
+{
+  /// @brief Number of logged overwrites.
+  size_t n_undos;
+  /// @brief Number of logged deltas.
+  size_t n_adds;
+  /// @brief Number of logged segment changes.
+  size_t n_segments;
+} SavepointMark;
+
+/// @brief Segment allocated or freed by the current
+/// transaction after it placed a savepoint.
+typedef struct _SavepointSegment
+{
+  /// @brief Segment changed.
+  Segment *segment;
+  /// @brief Owner to restore on a rollback.
+  tx_t owner;
+  /// @brief Status to restore on a rollback.
+  int status;
+} SavepointSegment;
+
+/// @brief Part of the current transaction
+/// spanning several shards run on one of them.
+typedef struct _ShardEntry
+{
+  /// @brief Identifier of the transaction on the shard.
+  tx_t tx;
+  /// @brief Engine the shard runs the transaction with.
+  int engine;
+} ShardEntry;
+
+/// @brief State kept by each thread across
+/// the transactions it runs.
+typedef struct _ThreadContext
+{
+  /// @brief Number of consecutive aborts
+  /// of the current transaction.
+  unsigned long int aborts;
+  /// @brief Work done by the current transaction,
+  /// accumulated across its aborted attempts.
+  unsigned long int karma;
+  /// @brief State of the backoff random generator.
+  unsigned int seed;
+  /// @brief Why the last transaction aborted.
+  abort_reason_t reason;
+  /// @brief When the last aborted transaction
+  /// should be retried.
+  retry_hint_t hint;
+  /// @brief Identifier taken by the current upgradable
+  /// transaction once it upgraded, NO_OWNER before.
+  tx_t upgraded;
+  /// @brief Whether the current transaction runs under snapshot
+  /// isolation, its reads being neither marked nor validated.
+  bool snapshot_isolation;
+  /// @brief Engine the current transaction runs with.
+  int engine;
+  /// @brief Region of the last transaction that
+  /// committed without waiting for its epoch.
+  Region *pending_region;
+  /// @brief Epoch from which the writes of that transaction
+  /// are visible, 0 once they are known to be.
+  unsigned long int pending;
+  /// @brief Whether the caller of the current transaction keeps
+  /// the tickets of its writes, instead of the thread.
+  bool caller_tickets;
+  /// @brief Epoch read by the current
+  /// snapshot transaction.
+  unsigned long int snapshot;
+  /// @brief Reclamation phase pinned by the
+  /// current snapshot transaction.
+  unsigned long int phase;
+  /// @brief Segment last read by the current snapshot
+  /// transaction, checked before looking up another.
+  Segment *last_segment;
+  /// @brief Shards the current transaction
+  /// spanning several shards runs on.
+  uint64_t shard_mask;
+  /// @brief Whether that transaction is read only.
+  bool shards_ro;
+  /// @brief Part of that transaction run on
+  /// each shard, indexed by shard.
+  ShardEntry shards[MAX_SHARDS];
+  /// @brief Node the thread runs on plus one,
+  /// 0 until it is looked up.
+  unsigned int numa_node;
+  /// @brief Whether the turn the thread holds was
+  /// taken through the turn of its node.
+  bool node_turn;
+  /// @brief Whether the thread took the turn ahead of
+  /// leaving the batcher, which then does not wait for it.
+  bool turn_held;
+  /// @brief Descriptors of the thread on the last regions
+  /// it ran transactions on, indexed by region identifier.
+  CachedDescriptor descriptors[DESCRIPTOR_CACHE];
+  /// @brief Whether the current transaction was
+  /// begun retry-capable, and logs its reads.
+  bool retry_reads;
+  /// @brief Identifier of the current transaction,
+  /// when hidden behind RETRY_OWNER.
+  tx_t retry_owner;
+  /// @brief Signature of the cache lines read
+  /// by the current transaction.
+  uint64_t signature[RETRY_SIGNATURE_WORDS];
+  /// @brief Savepoints placed by the current
+  /// transaction, from the outermost one.
+  SavepointMark *savepoints;
+  /// @brief Number of savepoints placed.
+  size_t n_savepoints;
+  /// @brief Number of savepoints the stack can hold.
+  size_t savepoints_capacity;
+  /// @brief Region the savepoints were placed on,
+  /// NULL while the transaction placed none.
+  Region *savepoint_region;
+  /// @brief Segments allocated or freed
+  /// after the outermost savepoint.
+  SavepointSegment *savepoint_segments;
+  /// @brief Number of logged segment changes.
+  size_t n_savepoint_segments;
+  /// @brief Number of changes the log can hold.
+  size_t savepoint_segments_capacity;
+  /// @brief Number of conflicts the current transaction
+  /// was rolled back to a savepoint on.
+  unsigned int savepoint_conflicts;
+  /// @brief Region the current transaction was
+  /// scheduled on, NULL if it was not.
+  Region *schedule_region;
+  /// @brief Slots hinted by that transaction, sorted.
+  size_t schedule_slots[SCHEDULE_MAX_HINTS];
+  /// @brief Number of slots hinted.
+  size_t n_schedule_slots;
+  /// @brief Slots taken by the transaction,
+  /// one bit per index in the hinted ones.
+  uint32_t schedule_held;
+  /// @brief Epoch the transaction runs in, which the
+  /// next holders of its slots wait for.
+  unsigned long int schedule_ticket;
+} ThreadContext;
+
+/// @brief Context of the calling thread.
+static _Thread_local ThreadContext thread_context;
+
+#endif
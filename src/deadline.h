@@ -0,0 +1,39 @@
+#ifndef _DEADLINE_H_
+#define _DEADLINE_H_
+
+#include <stdbool.h>
+#include <time.h>
+
+#include <tm_ext.h>
+
+/**
+ * @brief Checks whether a deadline has passed.
+ * @param deadline Absolute CLOCK_MONOTONIC time (ns), no_deadline for none
+ * @return Whether the deadline has passed
+ */
+static inline bool DeadlineExpired(deadline_t deadline)
+{
+  if (deadline == no_deadline)
+  {
+    return false;
+  }
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (deadline_t)now.tv_sec * 1000000000ull + (deadline_t)now.tv_nsec >= deadline;
+}
+
+/**
+ * @brief Converts a deadline to the time format of the pthread clocked waits.
+ * @param deadline Absolute CLOCK_MONOTONIC time (ns), other than no_deadline
+ * @return Same time as a timespec
+ */
+static inline struct timespec DeadlineTimespec(deadline_t deadline)
+{
+  struct timespec time;
+  time.tv_sec = (time_t)(deadline / 1000000000ull);
+  time.tv_nsec = (long)(deadline % 1000000000ull);
+  return time;
+}
+
+#endif
@@ -0,0 +1,244 @@
+#ifndef _DESCRIPTOR_H_
+#define _DESCRIPTOR_H_
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "context.h"
+#include "macros.h"
+#include "memory.h"
+#include "numa.h"
+
+/// @brief Identifier of the last region created, so that a thread never
+/// mistakes a new region for a destroyed one at the same address.
+static atomic_ulong descriptor_regions;
+
+/**
+ * @brief Gives a new region its identifier.
+ * @param region Region being created
+ */
+static inline void DescriptorInit(Region *region)
+{
+  region->id = atomic_fetch_add(&descriptor_regions, 1) + 1;
+  atomic_store(&(region->descriptors), NULL);
+}
+
+/**
+ * @brief Finds the descriptor of the calling thread on a region, taking
+ * over one that an exited thread left behind, or registering a new one.
+ * @param region Region to register on
+ * @return Descriptor of the thread, NULL if it could not be allocated
+ */
+static inline Descriptor *DescriptorRegister(Region *region)
+{
+  void *self = &thread_context;
+  Descriptor *head = atomic_load(&(region->descriptors));
+  for (Descriptor *descriptor = head; descriptor != NULL; descriptor = descriptor->next)
+  {
+    if (atomic_load(&(descriptor->owner)) == self)
+    {
+      return descriptor;
+    }
+  }
+  for (Descriptor *descriptor = head; descriptor != NULL; descriptor = descriptor->next)
+  {
+    void *expected = NULL;
+    if (atomic_load(&(descriptor->owner)) == NULL && atomic_compare_exchange_strong(&(descriptor->owner), &expected, self))
+    {
+      return descriptor;
+    }
+  }
+
+  // Alone on its cache lines, so that the counters never bounce
+  size_t size = (sizeof(Descriptor) + NUMA_LINE_SIZE - 1) / NUMA_LINE_SIZE * NUMA_LINE_SIZE;
+  Descriptor *descriptor;
+  if (posix_memalign((void **)&descriptor, NUMA_LINE_SIZE, size) != 0)
+  {
+    return NULL;
+  }
+  memset(descriptor, 0, size);
+  descriptor->region = region;
+  atomic_store(&(descriptor->owner), self);
+
+  // Descriptors are only unlinked when the region is destroyed
+  descriptor->next = atomic_load(&(region->descriptors));
+  while (!atomic_compare_exchange_weak(&(region->descriptors), &(descriptor->next), descriptor))
+    ;
+  return descriptor;
+}
+
+/**
+ * @brief Returns the descriptor of the calling thread on a region,
+ * registering the thread on first use if it did not register itself.
+ * @param region Region the thread runs on
+ * @return Descriptor of the thread, NULL if it could not be allocated
+ */
+static inline Descriptor *DescriptorOf(Region *region)
+{
+  CachedDescriptor *cached = thread_context.descriptors + region->id % DESCRIPTOR_CACHE;
+  if (likely(cached->region == region->id))
+  {
+    return cached->descriptor;
+  }
+
+  Descriptor *descriptor = DescriptorRegister(region);
+  if (descriptor != NULL)
+  {
+    cached->descriptor = descriptor;
+    cached->region = region->id;
+  }
+  return descriptor;
+}
+
+/**
+ * @brief Returns the logs of the current transaction of the calling
+ * thread on a region, kept in its descriptor there.
+ * @param region Region the transaction runs on
+ * @return Logs of the transaction, NULL if the descriptor could not be allocated
+ */
+static inline DescriptorLogs *LogsOf(Region *region)
+{
+  Descriptor *descriptor = DescriptorOf(region);
+  return likely(descriptor != NULL) ? &(descriptor->logs) : NULL;
+}
+
+/**
+ * @brief Forgets the descriptor of the calling thread on a region.
+ * @param region Region to forget
+ */
+static inline void DescriptorForget(Region *region)
+{
+  CachedDescriptor *cached = thread_context.descriptors + region->id % DESCRIPTOR_CACHE;
+  if (cached->region == region->id)
+  {
+    cached->descriptor = NULL;
+    cached->region = 0;
+  }
+}
+
+/**
+ * @brief Hands the descriptor of the calling thread on a region over to
+ * the next thread registering there, its counters, buffers and logs included.
+ * @param region Region the thread exits
+ */
+static inline void DescriptorRelease(Region *region)
+{
+  Descriptor *descriptor = DescriptorRegister(region);
+  if (descriptor == NULL)
+  {
+    return;
+  }
+  DescriptorForget(region);
+  atomic_store(&(descriptor->owner), NULL);
+}
+
+/**
+ * @brief Counts an event in a counter of the calling thread.
+ * @param region Region the event happened on
+ * @param counter Offset of the counter in Stats
+ */
+static inline void DescriptorCount(Region *region, size_t counter)
+{
+  Descriptor *descriptor = DescriptorOf(region);
+  if (unlikely(descriptor == NULL))
+  {
+    return;
+  }
+
+  // Only the owner updates its counters, readers only need them untorn
+  atomic_ulong *value = (atomic_ulong *)((char *)&(descriptor->stats) + counter);
+  atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+/**
+ * @brief Sums the counters of every thread registered on a region.
+ * @param region Region to query
+ * @param stats Receives the sums
+ */
+static inline void DescriptorStats(Region *region, stats_t *stats)
+{
+  memset(stats, 0, sizeof(stats_t));
+  for (Descriptor *descriptor = atomic_load(&(region->descriptors)); descriptor != NULL; descriptor = descriptor->next)
+  {
+    stats->commits += atomic_load_explicit(&(descriptor->stats.commits), memory_order_relaxed);
+    stats->aborts += atomic_load_explicit(&(descriptor->stats.aborts), memory_order_relaxed);
+    stats->retries += atomic_load_explicit(&(descriptor->stats.retries), memory_order_relaxed);
+    stats->waits += atomic_load_explicit(&(descriptor->stats.waits), memory_order_relaxed);
+    stats->serials += atomic_load_explicit(&(descriptor->stats.serials), memory_order_relaxed);
+    stats->dooms += atomic_load_explicit(&(descriptor->stats.dooms), memory_order_relaxed);
+  }
+}
+
+/**
+ * @brief Keeps the buffer of a freed segment in the magazine of the
+ * calling thread, freeing it if the magazine is full.
+ * @param region Region the segment belonged to
+ * @param data Buffer of the segment
+ * @param size Size of the buffer (bytes)
+ */
+static inline void DescriptorRecycle(Region *region, void *data, size_t size)
+{
+  Descriptor *descriptor = DescriptorOf(region);
+  if (descriptor == NULL || descriptor->n_magazine == DESCRIPTOR_MAGAZINE)
+  {
+    free(data);
+    return;
+  }
+  descriptor->magazine[descriptor->n_magazine] = data;
+  descriptor->magazine_sizes[descriptor->n_magazine] = size;
+  ++descriptor->n_magazine;
+}
+
+/**
+ * @brief Allocates the buffer of a new segment, from the magazine of the
+ * calling thread if it holds one of that size.
+ * @param region Region the segment belongs to
+ * @param data Receives the buffer
+ * @param size Size of the buffer (bytes)
+ * @return Whether the buffer could be allocated
+ */
+static inline bool DescriptorAllocate(Region *region, void **data, size_t size)
+{
+  Descriptor *descriptor = DescriptorOf(region);
+  for (size_t i = 0; descriptor != NULL && i < descriptor->n_magazine; ++i)
+  {
+    if (descriptor->magazine_sizes[i] == size)
+    {
+      *data = descriptor->magazine[i];
+      --descriptor->n_magazine;
+      descriptor->magazine[i] = descriptor->magazine[descriptor->n_magazine];
+      descriptor->magazine_sizes[i] = descriptor->magazine_sizes[descriptor->n_magazine];
+      return true;
+    }
+  }
+  return NumaAllocate(region, data, size);
+}
+
+/**
+ * @brief Frees every descriptor of a region and the buffers they kept.
+ * Called with no running transaction nor registered thread.
+ * @param region Region being destroyed
+ */
+static inline void DescriptorFree(Region *region)
+{
+  Descriptor *descriptor = atomic_load(&(region->descriptors));
+  while (descriptor != NULL)
+  {
+    Descriptor *next = descriptor->next;
+    for (size_t i = 0; i < descriptor->n_magazine; ++i)
+    {
+      free(descriptor->magazine[i]);
+    }
+    free(descriptor->logs.adds);
+    free(descriptor->logs.reads);
+    free(descriptor->logs.undos);
+    free(descriptor->logs.undo_values);
+    free(descriptor);
+    descriptor = next;
+  }
+  atomic_store(&(region->descriptors), NULL);
+  DescriptorForget(region);
+}
+
+#endif
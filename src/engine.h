@@ -0,0 +1,272 @@
+#ifndef _ENGINE_H_
+#define _ENGINE_H_
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "context.h"
+#include "deadline.h"
+#include "descriptor.h"
+#include "macros.h"
+#include "memory.h"
+#include "relinquish_cpu.h"
+
+/**
+ * @brief Parses the engine from the TM_ENGINE environment variable.
+ * @return Requested engine, engine_fine by default
+ */
+static inline engine_t EngineFromEnv()
+{
+  const char *name = getenv("TM_ENGINE");
+  if (name == NULL)
+  {
+    return engine_fine;
+  }
+
+  if (strcmp(name, "coarse") == 0)
+  {
+    return engine_coarse;
+  }
+  if (strcmp(name, "adaptive") == 0)
+  {
+    return engine_adaptive;
+  }
+  return engine_fine;
+}
+
+/**
+ * @brief Reads the monotonic clock.
+ * @return Current time (ns)
+ */
+static inline unsigned long int EngineNow()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (unsigned long int)now.tv_sec * 1000000000ul + (unsigned long int)now.tv_nsec;
+}
+
+/**
+ * @brief Sets the engine of a region with no running transaction,
+ * the adaptive engine starting fine-grained with no measurement.
+ * @param region Region to configure
+ * @param policy Engine to run with
+ */
+static inline void EngineReset(Region *region, engine_t policy)
+{
+  Engine *engine = &(region->engine);
+  atomic_store(&(engine->policy), policy);
+  atomic_store(&(engine->mode), policy == engine_coarse ? ENGINE_COARSE : ENGINE_FINE);
+  atomic_store(&(engine->active), 0);
+  atomic_store(&(engine->peak), 0);
+  atomic_store(&(engine->ended), 0);
+  atomic_store(&(engine->evaluating), false);
+  stats_t stats;
+  DescriptorStats(region, &stats);
+  engine->commits = stats.commits;
+  engine->aborts = stats.aborts;
+  engine->time = EngineNow();
+  engine->abort_percent = 0;
+  engine->rate[ENGINE_FINE] = 0;
+  engine->rate[ENGINE_COARSE] = 0;
+  engine->probing = false;
+  engine->hold = 0;
+}
+
+/**
+ * @brief Counts the transaction of the calling thread as running,
+ * waiting for the adaptive engine to settle if it is switching.
+ * @param region Region the transaction runs on
+ * @param deadline When to give up, no_deadline to wait as long as needed
+ * @return Engine the transaction runs with, ENGINE_SWITCHING if the deadline passed
+ */
+static inline int EngineEnter(Region *region, deadline_t deadline)
+{
+  Engine *engine = &(region->engine);
+
+  // Only the adaptive engine changes while transactions run
+  if (likely(atomic_load(&(engine->policy)) != engine_adaptive))
+  {
+    thread_context.engine = atomic_load(&(engine->mode));
+    return thread_context.engine;
+  }
+
+  while (true)
+  {
+    int mode = atomic_load(&(engine->mode));
+    if (mode != ENGINE_SWITCHING)
+    {
+      unsigned long int active = atomic_fetch_add(&(engine->active), 1) + 1;
+      if (mode == atomic_load(&(engine->mode)))
+      {
+        unsigned long int peak = atomic_load(&(engine->peak));
+        while (peak < active && !atomic_compare_exchange_weak(&(engine->peak), &peak, active))
+          ;
+        thread_context.engine = mode;
+        return mode;
+      }
+      atomic_fetch_sub(&(engine->active), 1);
+    }
+    if (DeadlineExpired(deadline))
+    {
+      return ENGINE_SWITCHING;
+    }
+    relinquish_cpu();
+  }
+}
+
+/**
+ * @brief Stops counting the transaction of the calling thread
+ * as running, when it could not begin after all.
+ * @param region Region the transaction was to run on
+ */
+static inline void EngineCancel(Region *region)
+{
+  if (atomic_load(&(region->engine.policy)) == engine_adaptive)
+  {
+    atomic_fetch_sub(&(region->engine.active), 1);
+  }
+}
+
+/**
+ * @brief Copies the committed copy of every segment over its writable
+ * one, which writers of the coarse engine left behind, before the
+ * fine-grained engine runs again. The writable copy of a private segment
+ * keeps the values it had when privatized, which tm_publish commits over.
+ * Called with no running transaction.
+ * @param region Region to synchronize
+ */
+static inline void EngineSync(Region *region)
+{
+  for (size_t i = 0; i < atomic_load(&(region->index)); ++i)
+  {
+    Segment *segment = region->segments + i;
+    if (segment->data != NULL && atomic_load(&(segment->owner)) != PRIVATE_OWNER)
+    {
+      memcpy((char *)(segment->data) + segment->size, segment->data, segment->size);
+    }
+  }
+}
+
+/**
+ * @brief Moves the region to another engine once
+ * every running transaction ended.
+ * @param region Region to switch
+ * @param mode Engine to run with from now on
+ */
+static inline void EngineSwitch(Region *region, int mode)
+{
+  // Keeping new transactions out until the running ones ended
+  atomic_store(&(region->engine.mode), ENGINE_SWITCHING);
+  while (atomic_load(&(region->engine.active)) != 0)
+  {
+    relinquish_cpu();
+  }
+
+  if (mode == ENGINE_FINE)
+  {
+    EngineSync(region);
+  }
+  atomic_store(&(region->engine.mode), mode);
+}
+
+/**
+ * @brief Evaluates the window of transactions that just ended and
+ * switches engine when the other one is expected to do better: the
+ * coarse engine for few active threads or many aborts, the fine one
+ * otherwise. A switch that turns out slower is reverted, and the
+ * engine then kept for ENGINE_HOLD_WINDOWS windows.
+ * @param region Region to evaluate
+ */
+static inline void EngineAdapt(Region *region)
+{
+  Engine *engine = &(region->engine);
+  if (atomic_exchange(&(engine->evaluating), true))
+  {
+    return;
+  }
+
+  // Measuring the window that just ended
+  int mode = atomic_load(&(engine->mode));
+  stats_t stats;
+  DescriptorStats(region, &stats);
+  unsigned long int commits = stats.commits;
+  unsigned long int aborts = stats.aborts;
+  unsigned long int elapsed = EngineNow() - engine->time;
+  unsigned long int window_commits = commits - engine->commits;
+  unsigned long int window_aborts = aborts - engine->aborts;
+  engine->rate[mode] = window_commits * 1000000ul / (elapsed == 0 ? 1 : elapsed);
+  if (mode == ENGINE_FINE)
+  {
+    engine->abort_percent = window_aborts * 100 / (window_commits + window_aborts == 0 ? 1 : window_commits + window_aborts);
+  }
+  else
+  {
+    // The coarse engine never aborts on conflicts,
+    // so the last fine-grained rate slowly fades
+    engine->abort_percent >>= 1;
+  }
+  unsigned long int peak = atomic_exchange(&(engine->peak), atomic_load(&(engine->active)));
+
+  int other = mode == ENGINE_FINE ? ENGINE_COARSE : ENGINE_FINE;
+  int target = mode;
+  if (engine->probing)
+  {
+    // Going back if the switch turned out slower
+    engine->probing = false;
+    if (engine->rate[mode] < engine->rate[other])
+    {
+      target = other;
+      engine->hold = ENGINE_HOLD_WINDOWS;
+    }
+  }
+  else if (engine->hold != 0)
+  {
+    --engine->hold;
+  }
+  else
+  {
+    int preferred = peak <= ENGINE_COARSE_THREADS || engine->abort_percent >= ENGINE_ABORT_PERCENT ? ENGINE_COARSE : ENGINE_FINE;
+    if (preferred != mode)
+    {
+      target = preferred;
+      engine->probing = true;
+    }
+  }
+
+  if (target != mode)
+  {
+    EngineSwitch(region, target);
+  }
+
+  // The next window starts once switched
+  DescriptorStats(region, &stats);
+  engine->commits = stats.commits;
+  engine->aborts = stats.aborts;
+  engine->time = EngineNow();
+  atomic_store(&(engine->evaluating), false);
+}
+
+/**
+ * @brief Ends the transaction of the calling thread for the engine,
+ * evaluating the adaptive engine every ENGINE_WINDOW transactions.
+ * Called once the transaction left the batcher or the region lock.
+ * @param region Region the transaction ran on
+ */
+static inline void EngineLeave(Region *region)
+{
+  Engine *engine = &(region->engine);
+  if (likely(atomic_load(&(engine->policy)) != engine_adaptive))
+  {
+    return;
+  }
+
+  atomic_fetch_sub(&(engine->active), 1);
+  if ((atomic_fetch_add(&(engine->ended), 1) + 1) % ENGINE_WINDOW == 0)
+  {
+    EngineAdapt(region);
+  }
+}
+
+#endif
@@ -23,4 +23,26 @@
 #define unlikely(prop) (prop)
 #endif
 
+/**
+ * @brief Define a variable as unused.
+ * @param variable Variable
+ */
+#undef unused
+#ifdef __GNUC__
+#define unused(variable) variable __attribute__((unused))
+#else
+#define unused(variable) variable
+#endif
+
+/**
+ * @brief Define a function as rarely called,
+ * kept out of line from its callers.
+ */
+#undef cold
+#ifdef __GNUC__
+#define cold __attribute__((cold, noinline))
+#else
+#define cold
+#endif
+
 #endif
\ No newline at end of file
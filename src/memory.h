@@ -2,9 +2,12 @@
 #define _MEMORY_H_
 
 #include <tm.h>
+#include <tm_ext.h>
+#include <pthread.h>
 #include <stdatomic.h>
 
 typedef _Atomic(tx_t) atomic_tx;
+typedef _Atomic(int64_t) atomic_delta;
 
 /// @brief Used for expressing the
 /// status for a given segment in 
@@ -22,6 +25,9 @@ typedef enum _SegmentStatus
   /// @brief Used when segment has
   /// been added after being removed.
   ADDED_AFTER_REMOVE,
+  /// @brief Used when segment has been privatized,
+  /// becoming private once the epoch commits.
+  PRIVATIZED,
 } SegmentStatus;
 
 /// @brief Used for expressing the
@@ -38,6 +44,27 @@ typedef enum _SegmentOwner
   /// @brief Used when the segment
   /// is scheduled to be removed.
   RM_OWNER = UINTPTR_MAX - 2,
+  /// @brief Used when a word is only updated through
+  /// commutative adds, away from the read markers.
+  ADD_OWNER = UINTPTR_MAX / 2,
+  /// @brief Handle of a read only transaction
+  /// that upgrades on its first write.
+  UPGRADABLE_OWNER = UINTPTR_MAX / 2 + 1,
+  /// @brief Handle of a read only transaction reading
+  /// a multi-version snapshot outside of the batcher.
+  SNAPSHOT_OWNER = UINTPTR_MAX / 2 + 2,
+  /// @brief Handle of a write transaction of the coarse
+  /// engine, which writes the committed copy directly.
+  COARSE_OWNER = UINTPTR_MAX / 2 + 3,
+  /// @brief Handle of a transaction spanning several
+  /// shards, running on each of them at once.
+  SHARDS_OWNER = UINTPTR_MAX / 2 + 4,
+  /// @brief Handle of a transaction logging its reads
+  /// for a later retry, standing for another handle.
+  RETRY_OWNER = UINTPTR_MAX / 2 + 5,
+  /// @brief Used when the segment is private, accessed
+  /// directly by its privatizer until it publishes it.
+  PRIVATE_OWNER = UINTPTR_MAX / 2 + 6,
 } SegmentOwner;
 
 /// @brief Used for expressing
@@ -47,8 +74,240 @@ typedef enum _BatcherCounterStatus
   /// @brief Maximum number of threads
   /// the batcher can handle at each epoch
   MAX_WRITE_TX_PER_EPOCH = 16,
+  /// @brief Number of tickets given up at the same time the
+  /// batcher can skip, more than threads ever wait at once.
+  ABANDONED_TICKETS = 1024,
 } BatcherCounterStatus;
 
+/// @brief Used for expressing the capacity
+/// the batcher keeps for high priority.
+typedef enum _PriorityStatus
+{
+  /// @brief Number of write slots of each epoch only
+  /// high-priority transactions may take.
+  PRIORITY_RESERVED_SLOTS = 4,
+  /// @brief Number of epochs the slots stay reserved after
+  /// the last one a high-priority transaction waited for.
+  PRIORITY_RESERVE_EPOCHS = 64,
+} PriorityStatus;
+
+/// @brief Used for expressing the priority
+/// class transactions enter the batcher with.
+typedef enum _PriorityClass
+{
+  /// @brief Transactions entering no epoch while a high-priority
+  /// one waits, and leaving it the reserved write slots.
+  PRIORITY_LOW,
+  /// @brief Transactions leaving the reserved write slots
+  /// to the high-priority ones.
+  PRIORITY_NORMAL,
+  /// @brief Latency critical transactions.
+  PRIORITY_HIGH,
+} PriorityClass;
+
+/// @brief Used for expressing the
+/// tuning of the contention manager.
+typedef enum _ContentionStatus
+{
+  /// @brief Maximum number of times a transaction with
+  /// more karma retries a conflicting access.
+  CM_KARMA_MAX_WAITS = 64,
+  /// @brief Maximum exponent of the backoff
+  /// window after consecutive aborts.
+  CM_BACKOFF_MAX_SHIFT = 10,
+  /// @brief Number of consecutive aborts after which
+  /// a write transaction runs irrevocably.
+  CM_SERIAL_AFTER_ABORTS = 8,
+} ContentionStatus;
+
+/// @brief Used for expressing the
+/// limits of the segment range locks.
+typedef enum _RangeLockStatus
+{
+  /// @brief Writes of at least this many bytes
+  /// are locked as a single range.
+  RANGE_LOCK_THRESHOLD = 1024,
+  /// @brief Maximum number of ranges that can
+  /// be locked in a segment at the same time.
+  MAX_RANGE_LOCKS_PER_SEGMENT = 4,
+  /// @brief Smaller writes lock their words in chunks
+  /// of this many, checking the ranges after each one.
+  LOCK_CHUNK_WORDS = 64,
+} RangeLockStatus;
+
+/// @brief Used for expressing the
+/// limits of the region's segment table.
+typedef enum _RegionStatus
+{
+  /// @brief Maximum number of segments
+  /// a region can hold at the same time.
+  MAX_SEGMENTS = 512,
+  /// @brief Maximum number of shards
+  /// a region can be split into.
+  MAX_SHARDS = 16,
+} RegionStatus;
+
+/// @brief Used for expressing where
+/// the segments are placed in memory.
+typedef enum _NumaPolicy
+{
+  /// @brief Wherever the kernel places them,
+  /// the node of the thread first touching them.
+  NUMA_NONE = 0,
+  /// @brief Pages spread over every node.
+  NUMA_INTERLEAVE = 1,
+  /// @brief Pages on the node of the
+  /// thread allocating the segment.
+  NUMA_LOCAL = 2,
+} NumaPolicy;
+
+/// @brief Used for expressing the
+/// limits of the NUMA placement.
+typedef enum _NumaStatus
+{
+  /// @brief Maximum number of nodes
+  /// with their own epoch counter.
+  MAX_NUMA_NODES = 8,
+  /// @brief Size of a cache line (bytes),
+  /// the epoch counters being that far apart.
+  NUMA_LINE_SIZE = 64,
+  /// @brief Number of times in a row the turn of the batcher
+  /// is passed within a node while others wait for it.
+  COHORT_PASSES = 32,
+} NumaStatus;
+
+/// @brief Used for expressing the
+/// limits of the thread descriptors.
+typedef enum _DescriptorStatus
+{
+  /// @brief Maximum number of freed segment
+  /// buffers a thread keeps for reuse.
+  DESCRIPTOR_MAGAZINE = 8,
+  /// @brief Number of regions a thread keeps
+  /// its descriptor on at hand.
+  DESCRIPTOR_CACHE = 8,
+} DescriptorStatus;
+
+/// @brief Used for expressing the
+/// signatures of the words read by the
+/// transactions waiting for a change.
+typedef enum _RetryStatus
+{
+  /// @brief Number of 64-bit words of a signature.
+  RETRY_SIGNATURE_WORDS = 4,
+  /// @brief Granularity of a signature, words
+  /// sharing a cache line sharing a bit.
+  RETRY_LINE_SHIFT = 6,
+} RetryStatus;
+
+/// @brief Used for expressing the
+/// limits of the savepoints.
+typedef enum _SavepointStatus
+{
+  /// @brief Number of conflicts after which a transaction
+  /// holding savepoints aborts as a whole again, instead
+  /// of being rolled back to one of them.
+  SAVEPOINT_MAX_CONFLICTS = 8,
+} SavepointStatus;
+
+/// @brief Used for expressing the tuning
+/// of the conflict-aware scheduler.
+typedef enum _ScheduleStatus
+{
+  /// @brief Number of slots the hints of
+  /// the transactions are hashed to.
+  SCHEDULE_SLOTS = 256,
+  /// @brief Number of hints of a transaction
+  /// the scheduler takes into account.
+  SCHEDULE_MAX_HINTS = 16,
+  /// @brief Heat from which the transactions
+  /// hinting a slot queue on it.
+  SCHEDULE_HOT_HEAT = 8,
+  /// @brief Heat a slot gains when a transaction
+  /// hinting it aborts on a conflict.
+  SCHEDULE_ABORT_HEAT = 16,
+  /// @brief Highest heat of a slot, each commit
+  /// of a transaction hinting it cooling it by one.
+  SCHEDULE_MAX_HEAT = 256,
+} ScheduleStatus;
+
+/// @brief Used for expressing the
+/// tuning of the epoch watchdog.
+typedef enum _WatchdogStatus
+{
+  /// @brief Time an epoch may keep transactions waiting before
+  /// its writers are doomed, by default (ms), 0 leaving the watchdog
+  /// off unless TM_WATCHDOG_MS or tm_set_watchdog turns it on.
+  WATCHDOG_MS = 0,
+  /// @brief First bit of the epoch in the doomed word,
+  /// below one bit per write transaction identifier.
+  WATCHDOG_EPOCH_SHIFT = MAX_WRITE_TX_PER_EPOCH + 1,
+} WatchdogStatus;
+
+/// @brief Used for expressing the
+/// multi-version storage of the words.
+typedef enum _VersionStatus
+{
+  /// @brief Number of previous versions
+  /// kept for each word.
+  MVCC_DEPTH = 4,
+  /// @brief Number of words compared at once when
+  /// looking for the words an epoch changed.
+  MVCC_SCAN_WORDS = 64,
+  /// @brief Stamp of a version slot
+  /// that holds no version yet.
+  VERSION_EMPTY = UINTPTR_MAX,
+  /// @brief Stamp of a word while the
+  /// epoch commit replaces its value.
+  VERSION_BUSY = UINTPTR_MAX - 1,
+} VersionStatus;
+
+/// @brief Used for expressing the
+/// tuning of the adaptive engine.
+typedef enum _EngineStatus
+{
+  /// @brief Number of ended transactions between
+  /// two evaluations of the engine to run.
+  ENGINE_WINDOW = 4096,
+  /// @brief Largest number of active threads for
+  /// which the coarse engine is preferred.
+  ENGINE_COARSE_THREADS = 2,
+  /// @brief Abort rate (percent) of the fine-grained engine
+  /// above which the coarse engine is preferred.
+  ENGINE_ABORT_PERCENT = 50,
+  /// @brief Number of windows the adaptive engine keeps
+  /// its mode after a switch turned out slower.
+  ENGINE_HOLD_WINDOWS = 16,
+} EngineStatus;
+
+/// @brief Used for expressing the engine
+/// transactions currently run with.
+typedef enum _EngineMode
+{
+  /// @brief Transactions go through the batcher
+  /// and lock words with the control words.
+  ENGINE_FINE,
+  /// @brief Transactions hold the region lock, writers
+  /// running alone in their own epoch.
+  ENGINE_COARSE,
+  /// @brief New transactions wait for the running
+  /// ones to end before the engine changes.
+  ENGINE_SWITCHING,
+} EngineMode;
+
+/// @brief Represents a range of words
+/// [start, end) locked by a transaction.
+typedef struct _RangeLock
+{
+  /// @brief Transaction owning the range,
+  /// NO_OWNER when the slot is free.
+  atomic_tx owner;
+  /// @brief Index of the first locked word.
+  atomic_ulong start;
+  /// @brief Index past the last locked word.
+  atomic_ulong end;
+} RangeLock;
+
 /// @brief Represents a segment of memory in the STM.
 typedef struct _Segment
 {
@@ -64,8 +323,79 @@ typedef struct _Segment
   /// @brief Stores whether this segment 
   /// was added or removed in this epoch. <---
   atomic_int status;
+  /// @brief Number of range locks currently
+  /// being held in this segment.
+  atomic_ulong n_ranges;
+  /// @brief Ranges of words locked by transactions for
+  /// large writes, allocated on the first range lock.
+  _Atomic(RangeLock *) ranges;
+  /// @brief Sum of the negative deltas added to each word in the
+  /// current epoch, followed by the number of deltas of running
+  /// transactions pending on each word, allocated on the first add.
+  _Atomic(atomic_delta *) debits;
+  /// @brief Commit stamps and previous versions of the
+  /// words, only allocated in multi-version mode.
+  _Atomic(atomic_ulong *) versions;
+  /// @brief Words written by the exclusive writer of the
+  /// epoch, from dirty_first to dirty_last excluded.
+  size_t dirty_first, dirty_last;
 } Segment;
 
+/// @brief Memory snapshot readers may still
+/// access, freed once they all ended.
+typedef struct _Retired
+{
+  /// @brief Data of a removed segment.
+  void *data;
+  /// @brief Versions of the removed segment.
+  atomic_ulong *versions;
+  /// @brief Next retired segment.
+  struct _Retired *next;
+} Retired;
+
+/// @brief Epoch based reclamation of the
+/// memory read by snapshot readers.
+typedef struct _Reclaimer
+{
+  /// @brief Phase new snapshot readers pin, flipped
+  /// once the readers of the other phase ended.
+  atomic_ulong phase;
+  /// @brief Number of snapshot readers
+  /// pinning each phase.
+  atomic_ulong active[2];
+  /// @brief Segments retired in each phase,
+  /// only touched by the epoch commit.
+  Retired *retired[2];
+} Reclaimer;
+
+/// @brief Part of the batcher kept by each node, so that
+/// the transactions of a node mostly touch lines of their node.
+typedef struct _BatcherNode
+{
+  /// @brief Last epoch published to the node, polled
+  /// by the transactions waiting on the node.
+  atomic_ulong epoch;
+  /// @brief Keeps the epoch apart from the turn of the node.
+  char epoch_padding[NUMA_LINE_SIZE - sizeof(atomic_ulong)];
+  /// @brief Stores which ticket of the node
+  /// may take the turn of the batcher now.
+  atomic_ulong turn;
+  /// @brief Gives each transaction of the
+  /// node waiting for the turn a ticket.
+  atomic_ulong last_turn;
+  /// @brief Number of transactions that entered
+  /// from the node in the current epoch.
+  atomic_ulong n_entered;
+  /// @brief Number of times in a row the turn of the batcher was
+  /// passed within the node, only touched by its holder.
+  unsigned long int passes;
+  /// @brief Whether the turn of the batcher was passed
+  /// to the next ticket of the node along with its turn.
+  atomic_bool passed;
+  /// @brief Keeps the nodes on different cache lines.
+  char padding[NUMA_LINE_SIZE - 4 * sizeof(atomic_ulong) - sizeof(atomic_bool)];
+} BatcherNode;
+
 /// @brief The goal of the Batcher is to artificially create 
 /// points in time in which no transaction is running. The 
 /// Batcher lets each and every blocked thread enter together 
@@ -81,8 +411,8 @@ typedef struct _Batcher
   atomic_ulong last_turn;
   /// @brief Stores the current batcher epoch.
   atomic_ulong counter;
-  /// @brief Number of transactions that 
-  /// entered in the batcher in the current epoch.
+  /// @brief Number of nodes with transactions that entered
+  /// in the batcher in the current epoch, 0 once it is empty.
   atomic_ulong n_entered;
   /// @brief Number of transactions that still
   /// can enter in the batcher
@@ -90,8 +420,256 @@ typedef struct _Batcher
   /// @brief Number of write transactions that
   /// entered in the batcher in the current epoch.
   atomic_ulong n_write_entered;
+  /// @brief Whether the current epoch is run by
+  /// a single irrevocable transaction.
+  atomic_bool serial;
+  /// @brief Whether the current epoch has a single write
+  /// transaction, which neither locks nor marks words.
+  atomic_bool exclusive;
+  /// @brief Whether the last committed epoch had a single write
+  /// transaction, the next one then being granted exclusively.
+  atomic_bool solo;
+  /// @brief Number of irrevocable transactions waiting
+  /// for the batcher to drain, new transactions
+  /// are kept out while it is not zero.
+  atomic_ulong n_serial_waiting;
+  /// @brief Number of high-priority transactions
+  /// waiting to enter the batcher.
+  atomic_ulong n_high_waiting;
+  /// @brief Tickets whose holders gave up waiting for their turn,
+  /// plus one, indexed by ticket, 0 for the slots of none.
+  atomic_ulong abandoned[ABANDONED_TICKETS];
+  /// @brief Number of transactions waiting for the next epoch
+  /// without a ticket, the epoch then not being granted exclusively.
+  atomic_ulong n_epoch_waiting;
+  /// @brief Last epoch a high-priority transaction waited
+  /// for, 0 if none did, the write slots being reserved
+  /// for some epochs after it.
+  atomic_ulong last_high;
+  /// @brief Per-node copies of the epoch counter, which waiting
+  /// transactions poll instead of the counter itself, and per-node
+  /// turns and counts of entered transactions, so that the turn is
+  /// passed within a node before going to the next one.
+  BatcherNode nodes[MAX_NUMA_NODES];
 } Batcher;
 
+/// @brief Switches the region between the fine-grained
+/// batcher and a coarse reader-writer lock.
+typedef struct _Engine
+{
+  /// @brief Engine requested with tm_set_engine.
+  atomic_int policy;
+  /// @brief Engine new transactions run with.
+  atomic_int mode;
+  /// @brief Lock held by the transactions
+  /// of the coarse engine.
+  pthread_rwlock_t lock;
+  /// @brief Number of transactions running, only
+  /// tracked by the adaptive engine.
+  atomic_ulong active;
+  /// @brief Largest number of transactions running
+  /// at once since the last evaluation.
+  atomic_ulong peak;
+  /// @brief Number of transactions ended, the engine
+  /// being evaluated every ENGINE_WINDOW of them.
+  atomic_ulong ended;
+  /// @brief Whether a thread is evaluating the engine,
+  /// the following fields being only touched by it.
+  atomic_bool evaluating;
+  /// @brief Commits and aborts counted
+  /// at the last evaluation.
+  unsigned long int commits, aborts;
+  /// @brief Time of the last evaluation (ns).
+  unsigned long int time;
+  /// @brief Abort rate (percent) of the fine-grained engine,
+  /// halved at each evaluation under the coarse one.
+  unsigned long int abort_percent;
+  /// @brief Last measured throughput of each
+  /// engine (commits per ms), 0 if unknown.
+  unsigned long int rate[2];
+  /// @brief Whether the window that just ended
+  /// was the first one after a switch.
+  bool probing;
+  /// @brief Number of windows to keep the
+  /// current engine for.
+  unsigned long int hold;
+} Engine;
+
+/// @brief Placement of the region
+/// on the nodes of the machine.
+typedef struct _Numa
+{
+  /// @brief Where the segments are placed.
+  NumaPolicy policy;
+  /// @brief Number of nodes of the machine,
+  /// at most MAX_NUMA_NODES.
+  size_t n_nodes;
+} Numa;
+
+/// @brief Threads sleeping after tm_retry until
+/// a word they read is changed by a commit.
+typedef struct _Retry
+{
+  /// @brief Protects the fields below.
+  pthread_mutex_t lock;
+  /// @brief Signaled when the sleepers are woken.
+  pthread_cond_t cond;
+  /// @brief Number of sleeping threads, commits
+  /// only look for changes when it is not zero.
+  atomic_ulong sleepers;
+  /// @brief Union of the signatures of the sleepers,
+  /// cleared once the last one woke up.
+  uint64_t watched[RETRY_SIGNATURE_WORDS];
+  /// @brief Number of times the sleepers were woken.
+  unsigned long int generation;
+} Retry;
+
+/// @brief Slot of the conflict-aware scheduler, a ticket lock the
+/// transactions predicted to conflict on it queue on.
+typedef struct _ScheduleSlot
+{
+  /// @brief Next turn to hand out.
+  atomic_ulong next;
+  /// @brief Turn of the current holder.
+  atomic_ulong serving;
+  /// @brief Epoch the next holder waits for,
+  /// the one its previous holder ran in.
+  atomic_ulong ticket;
+  /// @brief Recent conflicts of the transactions
+  /// hinting the slot, slots start queuing once hot.
+  atomic_ulong heat;
+} ScheduleSlot;
+
+/// @brief Evicts the write transactions that hold
+/// an epoch open while others wait for it.
+typedef struct _Watchdog
+{
+  /// @brief Time an epoch may keep transactions waiting before
+  /// its writers are doomed (ns), 0 to never doom them.
+  atomic_ulong threshold;
+  /// @brief Write transactions doomed to abort on their next
+  /// access, one bit per identifier, tagged with their epoch.
+  atomic_ulong doomed;
+} Watchdog;
+
+/// @brief Counters of the region,
+/// observable through tm_get_stats.
+typedef struct _Stats
+{
+  /// @brief Number of committed transactions.
+  atomic_ulong commits;
+  /// @brief Number of aborted transactions.
+  atomic_ulong aborts;
+  /// @brief Number of transactions started
+  /// right after an abort of the same thread.
+  atomic_ulong retries;
+  /// @brief Number of backoffs after an abort
+  /// or waits on a conflicting transaction.
+  atomic_ulong waits;
+  /// @brief Number of transactions that
+  /// ran irrevocably.
+  atomic_ulong serials;
+  /// @brief Number of transactions aborted
+  /// after the watchdog doomed them.
+  atomic_ulong dooms;
+} Stats;
+
+/// @brief Delta added to a word by
+/// the current transaction.
+typedef struct _AddEntry
+{
+  /// @brief Segment holding the word.
+  Segment *segment;
+  /// @brief Index of the word in the segment.
+  size_t index;
+  /// @brief Delta added to the word.
+  int64_t delta;
+} AddEntry;
+
+/// @brief Words read by the current transaction
+/// before it upgraded to read-write.
+typedef struct _ReadEntry
+{
+  /// @brief Segment holding the words.
+  Segment *segment;
+  /// @brief Index of the first word.
+  size_t first;
+  /// @brief Index past the last word.
+  size_t last;
+} ReadEntry;
+
+/// @brief Words overwritten by the current writer of
+/// the coarse engine, or by a writer holding savepoints.
+typedef struct _UndoEntry
+{
+  /// @brief Address of the first word.
+  void *target;
+  /// @brief Number of bytes overwritten.
+  size_t size;
+} UndoEntry;
+
+/// @brief Logs of the current transaction of a thread on a
+/// region, their buffers being reused by the next ones.
+typedef struct _DescriptorLogs
+{
+  /// @brief Deltas added by the current transaction
+  /// to words shared with other adders.
+  AddEntry *adds;
+  /// @brief Number of logged deltas.
+  size_t n_adds;
+  /// @brief Number of deltas the log can hold.
+  size_t adds_capacity;
+  /// @brief Words read by the current upgradable
+  /// transaction before it upgraded.
+  ReadEntry *reads;
+  /// @brief Number of logged reads.
+  size_t n_reads;
+  /// @brief Number of reads the log can hold.
+  size_t reads_capacity;
+  /// @brief Whether some read could not be logged,
+  /// so that the transaction cannot upgrade.
+  bool reads_lost;
+  /// @brief Words overwritten by the current writer of the coarse
+  /// engine, or by a writer holding savepoints in the writable copy.
+  UndoEntry *undos;
+  /// @brief Number of logged overwrites.
+  size_t n_undos;
+  /// @brief Number of overwrites the log can hold.
+  size_t undos_capacity;
+  /// @brief Previous values of the overwritten
+  /// words, in the order of the log.
+  char *undo_values;
+  /// @brief Number of bytes of previous values.
+  size_t undo_size;
+  /// @brief Size of the previous values buffer (bytes).
+  size_t undo_capacity;
+} DescriptorLogs;
+
+/// @brief State of a thread registered on a region,
+/// reused across the transactions it runs there.
+typedef struct _Descriptor
+{
+  /// @brief Region the descriptor is registered on.
+  struct _Region *region;
+  /// @brief Thread owning the descriptor,
+  /// NULL once it exited the region.
+  _Atomic(void *) owner;
+  /// @brief Counters of the transactions of the owner,
+  /// only ever updated by the owner.
+  Stats stats;
+  /// @brief Buffers of the segments freed by the epochs the
+  /// owner committed, reused by its next allocations.
+  void *magazine[DESCRIPTOR_MAGAZINE];
+  /// @brief Size of each buffer of the magazine (bytes).
+  size_t magazine_sizes[DESCRIPTOR_MAGAZINE];
+  /// @brief Number of buffers in the magazine.
+  size_t n_magazine;
+  /// @brief Logs of the current transaction of the owner.
+  DescriptorLogs logs;
+  /// @brief Next descriptor registered on the region.
+  struct _Descriptor *next;
+} Descriptor;
+
 /// @brief Represents a region in the
 /// software transactional memory
 typedef struct _Region
@@ -109,6 +687,39 @@ typedef struct _Region
   /// @brief Maximum index of any allocated
   /// memory segment in the region
   atomic_ulong index;
+  /// @brief Contention management policy
+  /// applied on conflicts and aborts.
+  atomic_int cm_policy;
+  /// @brief Work done by each running write
+  /// transaction, indexed by transaction id.
+  atomic_ulong karma[MAX_WRITE_TX_PER_EPOCH + 1];
+  /// @brief Descriptors of the threads
+  /// registered on the region.
+  _Atomic(Descriptor *) descriptors;
+  /// @brief Identifier of the region, unique
+  /// among the regions of the process.
+  unsigned long int id;
+  /// @brief Whether read only transactions read
+  /// multi-version snapshots.
+  atomic_bool mvcc;
+  /// @brief Reclamation of the segments
+  /// removed in multi-version mode.
+  Reclaimer reclaimer;
+  /// @brief Engine transactions run with.
+  Engine engine;
+  /// @brief Watchdog of the epochs.
+  Watchdog watchdog;
+  /// @brief Threads waiting for a change.
+  Retry retry;
+  /// @brief Slots of the conflict-aware scheduler.
+  ScheduleSlot schedule[SCHEDULE_SLOTS];
+  /// @brief Shards of the region, each with its own batcher
+  /// and segments, the region itself being the first one.
+  struct _Region **shards;
+  /// @brief Number of shards, 0 when the region is not split.
+  size_t n_shards;
+  /// @brief Placement of the region.
+  Numa numa;
 } Region;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,165 @@
+#ifndef _NUMA_H_
+#define _NUMA_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "context.h"
+#include "macros.h"
+#include "memory.h"
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+
+/**
+ * @brief Parses the placement policy from the TM_NUMA environment variable.
+ * @return Requested policy, NUMA_NONE by default
+ */
+static inline NumaPolicy NumaFromEnv()
+{
+  const char *name = getenv("TM_NUMA");
+  if (name == NULL)
+  {
+    return NUMA_NONE;
+  }
+
+  if (strcmp(name, "interleave") == 0)
+  {
+    return NUMA_INTERLEAVE;
+  }
+  if (strcmp(name, "local") == 0)
+  {
+    return NUMA_LOCAL;
+  }
+  return NUMA_NONE;
+}
+
+/**
+ * @brief Counts the nodes of the machine.
+ * @return Number of nodes, at most MAX_NUMA_NODES, 1 if unknown
+ */
+static inline size_t NumaNodes()
+{
+  // Listed as a range such as "0-1", or "0" on single-node machines
+  FILE *file = fopen("/sys/devices/system/node/possible", "r");
+  if (file == NULL)
+  {
+    return 1;
+  }
+  unsigned long int first = 0, last = 0;
+  int read = fscanf(file, "%lu-%lu", &first, &last);
+  fclose(file);
+
+  size_t nodes = read == 2 ? last + 1 : 1;
+  return nodes < MAX_NUMA_NODES ? nodes : MAX_NUMA_NODES;
+}
+
+/**
+ * @brief Sets up the placement of a region, before its first segment.
+ * @param region Region to set up
+ */
+static inline void NumaInit(Region *region)
+{
+  region->numa.policy = NumaFromEnv();
+  region->numa.n_nodes = NumaNodes();
+  for (size_t i = 0; i < MAX_NUMA_NODES; ++i)
+  {
+    BatcherNode *node = region->batcher.nodes + i;
+    atomic_store(&(node->epoch), 0);
+    atomic_store(&(node->turn), 0);
+    atomic_store(&(node->last_turn), 0);
+    atomic_store(&(node->n_entered), 0);
+    node->passes = 0;
+    atomic_store(&(node->passed), false);
+  }
+}
+
+/**
+ * @brief Returns the node the calling thread runs on, looked up once.
+ * @param region Region the thread runs on
+ * @return Node of the thread, below the number of nodes of the region
+ */
+static inline size_t NumaNode(const Region *region)
+{
+  if (unlikely(thread_context.numa_node == 0))
+  {
+    unsigned int cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0)
+    {
+      node = 0;
+    }
+    thread_context.numa_node = node + 1;
+  }
+  return (thread_context.numa_node - 1) % region->numa.n_nodes;
+}
+
+/**
+ * @brief Returns the copy of the epoch counter the
+ * calling thread polls while waiting.
+ * @param region Region the thread waits on
+ * @return Epoch counter of the node of the thread
+ */
+static inline atomic_ulong *NumaEpoch(Region *region) { return &(region->batcher.nodes[NumaNode(region)].epoch); }
+
+/**
+ * @brief Publishes a new epoch to every node. Called
+ * while holding the turn, right before the counter moves.
+ * @param region Region whose epoch moved
+ * @param epoch New epoch
+ */
+static inline void NumaPublish(Region *region, unsigned long int epoch)
+{
+  for (size_t i = 0; i < region->numa.n_nodes; ++i)
+  {
+    atomic_store(&(region->batcher.nodes[i].epoch), epoch);
+  }
+}
+
+/**
+ * @brief Allocates the memory of a segment, placed according to the
+ * policy of the region before anything touches it. The placement is
+ * best effort: where the kernel refuses it, the memory stays first-touch.
+ * @param region Region the segment belongs to
+ * @param data Receives the address of the memory
+ * @param size Size of the memory (bytes)
+ * @return Whether the memory could be allocated
+ */
+static inline bool NumaAllocate(Region *region, void **data, size_t size)
+{
+  if (region->numa.policy == NUMA_NONE)
+  {
+    return posix_memalign(data, region->true_align, size) == 0;
+  }
+
+  // Placement applies to whole pages
+  size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  if (posix_memalign(data, region->true_align < page ? page : region->true_align, size) != 0)
+  {
+    return false;
+  }
+
+  unsigned long int mask;
+  int mode;
+  if (region->numa.policy == NUMA_INTERLEAVE)
+  {
+    mask = (1ul << region->numa.n_nodes) - 1;
+    mode = MPOL_INTERLEAVE;
+  }
+  else
+  {
+    mask = 1ul << NumaNode(region);
+    mode = MPOL_PREFERRED;
+  }
+  syscall(SYS_mbind, *data, (size + page - 1) / page * page, mode, &mask, sizeof(mask) * 8, 0);
+  return true;
+}
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef _PRIVATIZE_H_
+#define _PRIVATIZE_H_
+
+#include <pthread.h>
+#include <string.h>
+
+#include "basic_operations.h"
+#include "context.h"
+#include "engine.h"
+#include "macros.h"
+#include "memory.h"
+#include "range_lock.h"
+#include "relinquish_cpu.h"
+#include "retry.h"
+
+/**
+ * @brief Waits until every transaction running on the region has ended,
+ * the epochs they ran in having committed. New transactions are kept out
+ * of the batcher until it drained, as for an irrevocable transaction,
+ * and snapshot readers, which run outside of it, are waited for last.
+ * @param region Region to quiesce
+ */
+static inline void PrivateQuiesce(Region *region)
+{
+  // Under the coarse engine, the running transactions hold the region lock
+  if (EngineEnter(region, no_deadline) == ENGINE_COARSE)
+  {
+    pthread_rwlock_wrlock(&(region->engine.lock));
+    pthread_rwlock_unlock(&(region->engine.lock));
+    EngineCancel(region);
+    return;
+  }
+
+  // Keeping new transactions out of the batcher
+  atomic_fetch_add(&(region->batcher.n_serial_waiting), 1);
+  while (true)
+  {
+    TakeTurn(region, no_deadline);
+    bool drained = !atomic_load(&(region->batcher.serial)) && atomic_load(&(region->batcher.n_entered)) == 0;
+
+    // Giving away turn
+    GiveTurn(region);
+    if (drained)
+    {
+      break;
+    }
+    relinquish_cpu();
+  }
+  atomic_fetch_add(&(region->batcher.n_serial_waiting), -1);
+
+  // Waiting for the snapshot readers of both phases
+  for (size_t phase = 0; phase < 2; ++phase)
+  {
+    while (atomic_load(&(region->reclaimer.active[phase])) != 0)
+    {
+      relinquish_cpu();
+    }
+  }
+  EngineCancel(region);
+}
+
+/**
+ * @brief Looks up the private segment starting at an address.
+ * @param region Region holding the segment
+ * @param address Address of the first byte of the segment
+ * @return Segment found, NULL if no private segment starts there
+ */
+static inline Segment *PrivateLookup(Region *region, void const *address)
+{
+  for (size_t i = region->index - 1; i < region->index; --i)
+  {
+    Segment *segment = region->segments + i;
+    if (segment->data == address)
+    {
+      return atomic_load(&(segment->owner)) == PRIVATE_OWNER ? segment : NULL;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Swaps the committed and writable copies of a segment.
+ * @param segment Segment to swap the copies of
+ */
+static inline void PrivateSwap(Segment *segment)
+{
+  char buffer[256];
+  char *committed = segment->data;
+  char *writable = committed + segment->size;
+  for (size_t done = 0; done < segment->size; done += sizeof(buffer))
+  {
+    size_t size = segment->size - done < sizeof(buffer) ? segment->size - done : sizeof(buffer);
+    memcpy(buffer, committed + done, size);
+    memcpy(committed + done, writable + done, size);
+    memcpy(writable + done, buffer, size);
+  }
+}
+
+/**
+ * @brief Hands a private segment back to the transactions. Its writable
+ * copy still holds the values it had when privatized, so that the values
+ * written directly are committed by an irrevocable epoch over those, the
+ * way a transaction writing each of them would, keeping the versions of
+ * the snapshot readers and waking the threads waiting for a change.
+ * @param region Region holding the segment
+ * @param segment Private segment to publish
+ */
+static inline void PrivatePublish(Region *region, Segment *segment)
+{
+  // Writers of the coarse engine write the committed copy directly
+  if (EngineEnter(region, no_deadline) == ENGINE_COARSE)
+  {
+    pthread_rwlock_wrlock(&(region->engine.lock));
+    memcpy((char *)segment->data + segment->size, segment->data, segment->size);
+    atomic_store(&(segment->owner), NO_OWNER);
+    if (unlikely(atomic_load(&(region->retry.sleepers)) != 0))
+    {
+      uint64_t written[RETRY_SIGNATURE_WORDS] = {0};
+      RetrySign(written, segment->data, segment->size);
+      RetryWake(region, written);
+    }
+    pthread_rwlock_unlock(&(region->engine.lock));
+    EngineLeave(region);
+    return;
+  }
+
+  // The committed copy gets the values it had back until the epoch
+  // commits, which then finds the words that changed
+  tx_t tx = EnterSerial(region, no_deadline);
+  PrivateSwap(segment);
+  RangeDirty(segment, 0, segment->size / region->align);
+  atomic_store(&(segment->owner), NO_OWNER);
+
+  unsigned long int ticket = Leave(region, tx, true);
+  EngineLeave(region);
+  AwaitTicket(region, ticket, no_deadline);
+}
+
+#endif
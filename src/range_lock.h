@@ -0,0 +1,302 @@
+#ifndef _RANGE_LOCK_H_
+#define _RANGE_LOCK_H_
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "macros.h"
+#include "memory.h"
+
+/**
+ * @brief Returns the range slots of the segment,
+ * allocating them on the first range lock.
+ * @param segment Segment holding the ranges
+ * @return Range slots of the segment, NULL if out of memory
+ */
+static inline RangeLock *RangeSlots(Segment *segment)
+{
+  RangeLock *ranges = atomic_load(&(segment->ranges));
+  if (likely(ranges != NULL))
+  {
+    return ranges;
+  }
+
+  RangeLock *allocated = calloc(MAX_RANGE_LOCKS_PER_SEGMENT, sizeof(RangeLock));
+  if (allocated == NULL)
+  {
+    return NULL;
+  }
+
+  // Someone else might have allocated them first
+  if (!atomic_compare_exchange_strong(&(segment->ranges), &ranges, allocated))
+  {
+    free(allocated);
+    return ranges;
+  }
+  return allocated;
+}
+
+/**
+ * @brief Checks whether the words [first, last) of the segment
+ * are covered by a range that is locked by another transaction.
+ * A range that is being claimed or released may be seen with a
+ * zero start, which only makes the check more conservative.
+ * @param segment Segment to inspect
+ * @param tx Transaction performing the check
+ * @param first Index of the first word
+ * @param last Index past the last word
+ * @return Whether some other transaction owns part of the words
+ */
+static inline bool RangeConflict(Segment *segment, tx_t tx, size_t first, size_t last)
+{
+  // Fast path, no ranges are being held
+  if (likely(atomic_load(&(segment->n_ranges)) == 0))
+  {
+    return false;
+  }
+
+  // Ranges are announced once the slots are allocated
+  RangeLock *ranges = atomic_load(&(segment->ranges));
+  for (size_t i = 0; i < MAX_RANGE_LOCKS_PER_SEGMENT; ++i)
+  {
+    RangeLock *range = ranges + i;
+    tx_t owner = atomic_load(&(range->owner));
+    if (owner == NO_OWNER || owner == tx)
+    {
+      continue;
+    }
+
+    // Overlapping with a range of someone else
+    size_t start = atomic_load(&(range->start));
+    size_t end = atomic_load(&(range->end));
+    if (first < end && start < last)
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * @brief Checks whether the given word of the
+ * segment is inside a range locked by tx.
+ * @param segment Segment to inspect
+ * @param tx Transaction performing the check
+ * @param index Index of the word
+ * @return Whether tx owns the word through a range
+ */
+static inline bool RangeOwned(Segment *segment, tx_t tx, size_t index)
+{
+  // Fast path, no ranges are being held
+  if (likely(atomic_load(&(segment->n_ranges)) == 0))
+  {
+    return false;
+  }
+
+  // Ranges are announced once the slots are allocated
+  RangeLock *ranges = atomic_load(&(segment->ranges));
+  for (size_t i = 0; i < MAX_RANGE_LOCKS_PER_SEGMENT; ++i)
+  {
+    RangeLock *range = ranges + i;
+    if (atomic_load(&(range->owner)) == tx && atomic_load(&(range->start)) <= index && index < atomic_load(&(range->end)))
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * @brief Releases a range slot of the segment.
+ * @param segment Segment holding the range
+ * @param range Range to release
+ */
+static inline void RangeRelease(Segment *segment, RangeLock *range)
+{
+  atomic_store(&(range->end), 0);
+  atomic_store(&(range->start), 0);
+  atomic_store(&(range->owner), NO_OWNER);
+  atomic_fetch_add(&(segment->n_ranges), -1);
+}
+
+/** Result of trying to lock a range of words. **/
+typedef enum _RangeLockResult
+{
+  /// @brief The whole range is owned by the transaction.
+  RANGE_LOCKED,
+  /// @brief The range overlaps words owned or added to by others.
+  RANGE_CONFLICT,
+  /// @brief The range overlaps words read by others.
+  RANGE_READ_CONFLICT,
+  /// @brief No free slot, the words must be locked one by one.
+  RANGE_FULL,
+} RangeLockResult;
+
+/**
+ * @brief Locks the words [first, last) of the segment as a single range,
+ * with a constant number of atomic read-modify-writes (the control words
+ * are only loaded, never exchanged). Word-level lockers
+ * publish their control word before checking the ranges, and we publish
+ * the range before checking the control words, so at least one of two
+ * concurrent conflicting transactions always notices the other.
+ * @param segment Segment in which the words live
+ * @param tx Transaction locking the words
+ * @param first Index of the first word
+ * @param last Index past the last word
+ * @return Whether the range was locked, conflicted, or no slot was free
+ */
+static inline RangeLockResult RangeLockAcquire(Segment *segment, tx_t tx, size_t first, size_t last)
+{
+  // Without slots, the words are locked one by one
+  RangeLock *ranges = RangeSlots(segment);
+  if (ranges == NULL)
+  {
+    return RANGE_FULL;
+  }
+
+  // We might already own a range covering the words
+  for (size_t i = 0; i < MAX_RANGE_LOCKS_PER_SEGMENT; ++i)
+  {
+    RangeLock *range = ranges + i;
+    if (atomic_load(&(range->owner)) == tx && atomic_load(&(range->start)) <= first && last <= atomic_load(&(range->end)))
+    {
+      return RANGE_LOCKED;
+    }
+  }
+
+  // Announcing the range before claiming a slot
+  atomic_fetch_add(&(segment->n_ranges), 1);
+
+  // Claiming a free slot
+  RangeLock *range = NULL;
+  for (size_t i = 0; i < MAX_RANGE_LOCKS_PER_SEGMENT && range == NULL; ++i)
+  {
+    tx_t expected = NO_OWNER;
+    if (atomic_compare_exchange_strong(&(ranges[i].owner), &expected, tx))
+    {
+      range = ranges + i;
+    }
+  }
+
+  if (range == NULL)
+  {
+    atomic_fetch_add(&(segment->n_ranges), -1);
+    return RANGE_FULL;
+  }
+
+  // Publishing the range
+  atomic_store(&(range->start), first);
+  atomic_store(&(range->end), last);
+
+  // Checking for overlapping ranges of others
+  if (RangeConflict(segment, tx, first, last))
+  {
+    RangeRelease(segment, range);
+    return RANGE_CONFLICT;
+  }
+
+  // Checking the words are not locked or read by others (plain loads only)
+  atomic_tx *controls = (atomic_tx *)((char *)segment->data + (segment->size << 1));
+  for (size_t i = first; i < last; ++i)
+  {
+    tx_t control = atomic_load(controls + i);
+    if (control != NO_OWNER && control != tx && control != -tx)
+    {
+      RangeRelease(segment, range);
+      return control <= MAX_WRITE_TX_PER_EPOCH || control == ADD_OWNER ? RANGE_CONFLICT : RANGE_READ_CONFLICT;
+    }
+  }
+
+  return RANGE_LOCKED;
+}
+
+/**
+ * @brief Rolls back the ranges of the segment locked by tx,
+ * restoring exactly the words they cover from the committed copy.
+ * @param segment Segment holding the ranges
+ * @param tx Transaction being undone
+ * @param align Size of a word in the segment
+ */
+static inline void RangeUndo(Segment *segment, tx_t tx, size_t align)
+{
+  if (likely(atomic_load(&(segment->n_ranges)) == 0))
+  {
+    return;
+  }
+
+  RangeLock *ranges = atomic_load(&(segment->ranges));
+  for (size_t i = 0; i < MAX_RANGE_LOCKS_PER_SEGMENT; ++i)
+  {
+    RangeLock *range = ranges + i;
+    if (atomic_load(&(range->owner)) == tx)
+    {
+      size_t start = atomic_load(&(range->start)) * align;
+      size_t end = atomic_load(&(range->end)) * align;
+      memcpy((char *)segment->data + segment->size + start, (char *)segment->data + start, end - start);
+      RangeRelease(segment, range);
+    }
+  }
+}
+
+/**
+ * @brief Widens the range of words written by the exclusive
+ * writer of the epoch, which the commit copies alone.
+ * @param segment Segment holding the words
+ * @param first Index of the first word
+ * @param last Index past the last word
+ */
+static inline void RangeDirty(Segment *segment, size_t first, size_t last)
+{
+  if (segment->dirty_first == segment->dirty_last)
+  {
+    segment->dirty_first = first;
+    segment->dirty_last = last;
+    return;
+  }
+  if (first < segment->dirty_first)
+  {
+    segment->dirty_first = first;
+  }
+  if (last > segment->dirty_last)
+  {
+    segment->dirty_last = last;
+  }
+}
+
+/**
+ * @brief Releases all the ranges of the segment,
+ * once the epoch has been committed.
+ * @param segment Segment holding the ranges
+ */
+static inline void RangeReset(Segment *segment)
+{
+  RangeLock *ranges = atomic_load(&(segment->ranges));
+  if (ranges == NULL)
+  {
+    return;
+  }
+
+  for (size_t i = 0; i < MAX_RANGE_LOCKS_PER_SEGMENT; ++i)
+  {
+    atomic_store(&(ranges[i].end), 0);
+    atomic_store(&(ranges[i].start), 0);
+    atomic_store(&(ranges[i].owner), NO_OWNER);
+  }
+  atomic_store(&(segment->n_ranges), 0);
+}
+
+/**
+ * @brief Frees the range slots of a segment being removed.
+ * @param segment Segment holding the ranges
+ */
+static inline void RangeFree(Segment *segment)
+{
+  free(atomic_load(&(segment->ranges)));
+  atomic_store(&(segment->ranges), NULL);
+  atomic_store(&(segment->n_ranges), 0);
+}
+
+#endif
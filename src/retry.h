@@ -0,0 +1,191 @@
+#ifndef _RETRY_H_
+#define _RETRY_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "context.h"
+#include "macros.h"
+#include "memory.h"
+
+/**
+ * @brief Returns the bit of a cache line in a signature.
+ * @param address Address in the committed copy of a segment
+ * @return Index of the bit
+ */
+static inline size_t RetryBit(const void *address)
+{
+  uint64_t line = (uintptr_t)address >> RETRY_LINE_SHIFT;
+  return (size_t)((line * 0x9E3779B97F4A7C15ul) >> (64 - 8)) % (RETRY_SIGNATURE_WORDS * 64);
+}
+
+/**
+ * @brief Adds the cache lines of a range to a signature.
+ * @param signature Signature to extend
+ * @param address First byte of the range, in the committed copy
+ * @param size Size of the range (bytes)
+ */
+static inline void RetrySign(uint64_t *signature, const void *address, size_t size)
+{
+  uintptr_t last = ((uintptr_t)address + size - 1) >> RETRY_LINE_SHIFT;
+  for (uintptr_t line = (uintptr_t)address >> RETRY_LINE_SHIFT; line <= last; ++line)
+  {
+    size_t bit = RetryBit((const void *)(line << RETRY_LINE_SHIFT));
+    signature[bit >> 6] |= 1ul << (bit & 63);
+  }
+}
+
+/**
+ * @brief Forgets the words read by the previous transaction of the
+ * calling thread, the current one logging its reads only if retry-capable.
+ * @param retry_reads Whether the current transaction was begun retry-capable
+ */
+static inline void RetryReset(bool retry_reads)
+{
+  thread_context.retry_reads = retry_reads;
+  if (retry_reads)
+  {
+    memset(thread_context.signature, 0, sizeof(thread_context.signature));
+  }
+}
+
+/**
+ * @brief Hides a retry-capable transaction behind RETRY_OWNER, so that
+ * the reads of the others stay free of accesses to the thread context.
+ * @param tx Identifier of the transaction just begun
+ * @return Identifier to hand to the caller
+ */
+static inline tx_t RetryBegin(tx_t tx)
+{
+  if (thread_context.retry_reads)
+  {
+    thread_context.retry_owner = tx;
+    return RETRY_OWNER;
+  }
+  return tx;
+}
+
+/**
+ * @brief Returns the identifier a transaction hides behind RETRY_OWNER.
+ * @param tx Identifier handed to the caller
+ * @return Identifier the transaction runs as
+ */
+static inline tx_t RetryOwner(tx_t tx) { return unlikely(tx == RETRY_OWNER) ? thread_context.retry_owner : tx; }
+
+/**
+ * @brief Logs the words read by the current retry-capable
+ * transaction, one bit per cache line.
+ * @param source Address of the first word read, in the committed copy
+ * @param size Number of bytes read
+ */
+static inline void RetryLogRead(const void *source, size_t size) { RetrySign(thread_context.signature, source, size); }
+
+/**
+ * @brief Reads in the transaction hidden behind RETRY_OWNER, logging the
+ * words read first. Kept out of line, so that the other transactions do
+ * not look up the thread context on each of their reads.
+ * @param shared Region the transaction runs on
+ * @param source Source start address, in the committed copy
+ * @param size Length to copy (bytes)
+ * @param target Target start address, in a private region
+ * @return Whether the transaction can continue
+ */
+static cold bool RetryRead(shared_t shared, void const *source, size_t size, void *target)
+{
+  RetryLogRead(source, size);
+  return tm_read(shared, thread_context.retry_owner, source, size, target);
+}
+
+/**
+ * @brief Adds to a signature the words a commit changes in a segment,
+ * those whose writable copy differs from the committed one. Called
+ * before the commit, and only while some thread sleeps.
+ * @param region Region of the segment
+ * @param segment Segment being committed
+ * @param first Index of the first word written
+ * @param last Index past the last word written
+ * @param written Signature to extend
+ */
+static inline void RetryScan(Region *region, Segment *segment, size_t first, size_t last, uint64_t *written)
+{
+  for (size_t j = first; j < last; ++j)
+  {
+    char *committed = (char *)segment->data + j * region->align;
+    if (memcmp(committed, committed + segment->size, region->align) != 0)
+    {
+      RetrySign(written, committed, region->align);
+    }
+  }
+}
+
+/**
+ * @brief Wakes the sleepers up if a commit changed
+ * some word that any of them read.
+ * @param region Region committed
+ * @param written Signature of the words changed by the commit
+ */
+static inline void RetryWake(Region *region, const uint64_t *written)
+{
+  pthread_mutex_lock(&(region->retry.lock));
+  for (size_t i = 0; i < RETRY_SIGNATURE_WORDS; ++i)
+  {
+    if ((written[i] & region->retry.watched[i]) != 0)
+    {
+      ++region->retry.generation;
+      pthread_cond_broadcast(&(region->retry.cond));
+      break;
+    }
+  }
+  pthread_mutex_unlock(&(region->retry.lock));
+}
+
+/**
+ * @brief Registers the calling thread as a sleeper, before its transaction
+ * leaves, so that no commit after it read can go unnoticed.
+ * @param region Region the transaction runs on
+ * @return Generation to sleep through
+ */
+static inline unsigned long int RetryRegister(Region *region)
+{
+  // Without any word logged, any change is
+  // one the transaction may wait for
+  bool logged = false;
+  for (size_t i = 0; i < RETRY_SIGNATURE_WORDS; ++i)
+  {
+    logged = logged || (thread_context.retry_reads && thread_context.signature[i] != 0);
+  }
+
+  pthread_mutex_lock(&(region->retry.lock));
+  for (size_t i = 0; i < RETRY_SIGNATURE_WORDS; ++i)
+  {
+    region->retry.watched[i] |= logged ? thread_context.signature[i] : UINT64_MAX;
+  }
+  atomic_fetch_add(&(region->retry.sleepers), 1);
+  unsigned long int generation = region->retry.generation;
+  pthread_mutex_unlock(&(region->retry.lock));
+  return generation;
+}
+
+/**
+ * @brief Sleeps until a commit changed a word some sleeper read. Wake ups
+ * can be spurious, the transaction then retrying and sleeping again.
+ * @param region Region the transaction ran on
+ * @param generation Generation returned by RetryRegister
+ * @param sleep Whether to sleep at all, or only to unregister
+ */
+static inline void RetrySleep(Region *region, unsigned long int generation, bool sleep)
+{
+  pthread_mutex_lock(&(region->retry.lock));
+  while (sleep && region->retry.generation == generation)
+  {
+    pthread_cond_wait(&(region->retry.cond), &(region->retry.lock));
+  }
+  if (atomic_fetch_add(&(region->retry.sleepers), -1) == 1)
+  {
+    memset(region->retry.watched, 0, sizeof(region->retry.watched));
+  }
+  pthread_mutex_unlock(&(region->retry.lock));
+}
+
+#endif
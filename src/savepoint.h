@@ -0,0 +1,221 @@
+#ifndef _SAVEPOINT_H_
+#define _SAVEPOINT_H_
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "coarse.h"
+#include "commutative.h"
+#include "context.h"
+#include "descriptor.h"
+#include "macros.h"
+#include "memory.h"
+
+/**
+ * @brief Forgets the savepoints of the previous
+ * transaction of the calling thread.
+ */
+static inline void SavepointReset()
+{
+  thread_context.n_savepoints = 0;
+  thread_context.savepoint_region = NULL;
+  thread_context.savepoint_conflicts = 0;
+}
+
+/**
+ * @brief Places a savepoint, recording the lengths of the logs of the
+ * transaction. The first one starts logging the values the writes of
+ * a writer of the batcher replace in the writable copy.
+ * @param region Region the transaction runs on
+ * @param tx Transaction placing the savepoint
+ * @return Savepoint placed, no_savepoint if out of memory
+ */
+static inline savepoint_t SavepointPlace(Region *region, tx_t tx)
+{
+  DescriptorLogs *logs = LogsOf(region);
+  if (unlikely(logs == NULL))
+  {
+    return no_savepoint;
+  }
+
+  if (unlikely(thread_context.n_savepoints == thread_context.savepoints_capacity))
+  {
+    size_t capacity = thread_context.savepoints_capacity == 0 ? 8 : thread_context.savepoints_capacity << 1;
+    SavepointMark *savepoints = realloc(thread_context.savepoints, capacity * sizeof(SavepointMark));
+    if (savepoints == NULL)
+    {
+      return no_savepoint;
+    }
+    thread_context.savepoints = savepoints;
+    thread_context.savepoints_capacity = capacity;
+  }
+
+  // The writer of the coarse engine already logs since it began
+  if (thread_context.savepoint_region != region)
+  {
+    thread_context.savepoint_region = region;
+    thread_context.n_savepoint_segments = 0;
+    if (tx != COARSE_OWNER)
+    {
+      logs->n_undos = 0;
+      logs->undo_size = 0;
+    }
+  }
+
+  SavepointMark *mark = thread_context.savepoints + thread_context.n_savepoints++;
+  mark->n_undos = logs->n_undos;
+  mark->n_adds = logs->n_adds;
+  mark->n_segments = thread_context.n_savepoint_segments;
+  return thread_context.n_savepoints;
+}
+
+/**
+ * @brief Logs the values a write of a writer of the batcher is
+ * about to replace, if the transaction holds savepoints.
+ * @param region Region the transaction runs on
+ * @param writable Address of the first word, in the writable copy
+ * @param size Number of bytes to overwrite
+ * @return Whether the values could be logged
+ */
+static inline bool SavepointLogWrite(Region *region, void *writable, size_t size)
+{
+  return likely(thread_context.savepoint_region != region) || CoarseLog(region, writable, size);
+}
+
+/**
+ * @brief Logs the value a delta replaced in the writable copy, if the
+ * transaction holds savepoints and added to a word of its own. The
+ * deltas added to words shared with other adders are in their own log.
+ * @param region Region the transaction runs on
+ * @param segment Segment holding the word
+ * @param tx Transaction that added the delta
+ * @param target Address of the word, in the committed copy
+ * @param delta Delta added
+ * @return Whether the value could be logged
+ */
+static inline bool SavepointLogAdd(Region *region, Segment *segment, tx_t tx, void *target, int64_t delta)
+{
+  if (likely(thread_context.savepoint_region != region))
+  {
+    return true;
+  }
+
+  size_t index = ((char *)target - (char *)segment->data) / region->align;
+  atomic_tx *control = (atomic_tx *)((char *)segment->data + (segment->size << 1)) + index;
+  if (!atomic_load(&(region->batcher.exclusive)) && atomic_load(control) != tx)
+  {
+    return true;
+  }
+
+  char *writable = (char *)target + segment->size;
+  if (!CoarseLog(region, writable, sizeof(int64_t)))
+  {
+    return false;
+  }
+
+  DescriptorLogs *logs = LogsOf(region);
+  int64_t value;
+  memcpy(&value, writable, sizeof(int64_t));
+  value -= delta;
+  memcpy(logs->undo_values + logs->undo_size - sizeof(int64_t), &value, sizeof(int64_t));
+  return true;
+}
+
+/**
+ * @brief Logs the owner and status a segment returns to on a rollback,
+ * before allocating or freeing it, if the transaction holds savepoints.
+ * @param region Region the transaction runs on
+ * @param segment Segment allocated or freed
+ * @param owner Owner to restore
+ * @param status Status to restore
+ * @return Whether the change could be logged
+ */
+static inline bool SavepointLogSegment(Region *region, Segment *segment, tx_t owner, int status)
+{
+  if (likely(thread_context.savepoint_region != region))
+  {
+    return true;
+  }
+
+  if (unlikely(thread_context.n_savepoint_segments == thread_context.savepoint_segments_capacity))
+  {
+    size_t capacity = thread_context.savepoint_segments_capacity == 0 ? 8 : thread_context.savepoint_segments_capacity << 1;
+    SavepointSegment *segments = realloc(thread_context.savepoint_segments, capacity * sizeof(SavepointSegment));
+    if (segments == NULL)
+    {
+      return false;
+    }
+    thread_context.savepoint_segments = segments;
+    thread_context.savepoint_segments_capacity = capacity;
+  }
+
+  SavepointSegment *entry = thread_context.savepoint_segments + thread_context.n_savepoint_segments++;
+  entry->segment = segment;
+  entry->owner = owner;
+  entry->status = status;
+  return true;
+}
+
+/**
+ * @brief Decides whether a conflict only fails the access, leaving
+ * the transaction running for the caller to roll it back to one of
+ * its savepoints, instead of aborting it as a whole.
+ * @param region Region the transaction runs on
+ * @param reason Why the access failed
+ * @return Whether the transaction keeps running
+ */
+static inline bool SavepointKeep(Region *region, abort_reason_t reason)
+{
+  if (thread_context.savepoint_region != region || thread_context.savepoint_conflicts >= SAVEPOINT_MAX_CONFLICTS)
+  {
+    return false;
+  }
+
+  ++thread_context.savepoint_conflicts;
+  thread_context.reason = reason;
+  thread_context.hint = retry_now;
+  return true;
+}
+
+/**
+ * @brief Rolls the transaction back to a savepoint, which stays placed
+ * while the ones placed after it are dropped. The words written since
+ * get back the values they had in the writable copy, and stay locked:
+ * the values of the words the transaction did not own before being
+ * the committed ones, committing them changes nothing.
+ * @param region Region the transaction runs on
+ * @param savepoint Savepoint to roll back to
+ */
+static inline void SavepointRollback(Region *region, savepoint_t savepoint)
+{
+  SavepointMark *mark = thread_context.savepoints + savepoint - 1;
+  DescriptorLogs *logs = LogsOf(region);
+
+  // Restoring the words in reverse order, for the words written twice
+  for (size_t i = logs->n_undos; i-- > mark->n_undos;)
+  {
+    UndoEntry *entry = logs->undos + i;
+    logs->undo_size -= entry->size;
+    memcpy(entry->target, logs->undo_values + logs->undo_size, entry->size);
+  }
+  logs->n_undos = mark->n_undos;
+
+  // Withdrawing the deltas added since
+  AddUndoTo(region, mark->n_adds);
+
+  // Freeing back the segments allocated since, and keeping the ones
+  // freed since, unless they were dropped already
+  for (size_t i = thread_context.n_savepoint_segments; i-- > mark->n_segments;)
+  {
+    SavepointSegment *entry = thread_context.savepoint_segments + i;
+    if (atomic_load(&(entry->segment->owner)) != RM_OWNER)
+    {
+      atomic_store(&(entry->segment->status), entry->status);
+      atomic_store(&(entry->segment->owner), entry->owner);
+    }
+  }
+  thread_context.n_savepoint_segments = mark->n_segments;
+  thread_context.n_savepoints = savepoint;
+}
+
+#endif
@@ -0,0 +1,165 @@
+#ifndef _SCHEDULE_H_
+#define _SCHEDULE_H_
+
+#include <stdint.h>
+
+#include <tm_ext.h>
+
+#include "context.h"
+#include "descriptor.h"
+#include "macros.h"
+#include "memory.h"
+#include "numa.h"
+#include "relinquish_cpu.h"
+
+/**
+ * @brief Returns the schedule slot of the cache line
+ * holding an address, or of a key taken as one.
+ * @param hint Address or key hinted
+ * @return Index of the slot
+ */
+static inline size_t ScheduleIndex(void const *hint)
+{
+  return (size_t)((((uintptr_t)hint >> RETRY_LINE_SHIFT) * 0x9E3779B97F4A7C15ul) >> 56) % SCHEDULE_SLOTS;
+}
+
+/**
+ * @brief Queues the calling thread behind the transactions predicted
+ * to conflict with it, before it begins its own. The slots of the hints
+ * that caused aborts lately are taken in order, each one once the epoch
+ * of its previous holder committed, so that the locks of that holder are
+ * released when the transaction begins. The other slots are only noted,
+ * for the transaction to heat them if it aborts on a conflict.
+ * @param region Region the transaction runs on
+ * @param hints Addresses or keys the transaction will access
+ * @param n Number of hints, only the first SCHEDULE_MAX_HINTS counting
+ */
+static inline void ScheduleEnter(Region *region, void const *const *hints, size_t n)
+{
+  thread_context.schedule_region = region;
+  thread_context.n_schedule_slots = 0;
+  thread_context.schedule_held = 0;
+  thread_context.schedule_ticket = 0;
+
+  // Sorting the slots, so that they are always taken in the same order
+  n = n < SCHEDULE_MAX_HINTS ? n : SCHEDULE_MAX_HINTS;
+  for (size_t i = 0; i < n; ++i)
+  {
+    size_t index = ScheduleIndex(hints[i]);
+    size_t j = thread_context.n_schedule_slots;
+    while (j > 0 && thread_context.schedule_slots[j - 1] > index)
+    {
+      --j;
+    }
+
+    // Hints sharing a slot take it once
+    if (j > 0 && thread_context.schedule_slots[j - 1] == index)
+    {
+      continue;
+    }
+    for (size_t k = thread_context.n_schedule_slots; k > j; --k)
+    {
+      thread_context.schedule_slots[k] = thread_context.schedule_slots[k - 1];
+    }
+    thread_context.schedule_slots[j] = index;
+    ++thread_context.n_schedule_slots;
+  }
+
+  for (size_t i = 0; i < thread_context.n_schedule_slots; ++i)
+  {
+    ScheduleSlot *slot = region->schedule + thread_context.schedule_slots[i];
+    if (atomic_load(&(slot->heat)) < SCHEDULE_HOT_HEAT)
+    {
+      continue;
+    }
+
+    // Waiting for our turn on the slot
+    unsigned long int turn = atomic_fetch_add(&(slot->next), 1);
+    if (turn != atomic_load(&(slot->serving)))
+    {
+      DescriptorCount(region, offsetof(Stats, waits));
+      do
+      {
+        relinquish_cpu();
+      } while (turn != atomic_load(&(slot->serving)));
+    }
+    thread_context.schedule_held |= 1u << i;
+
+    // Waiting for the epoch of the previous holder to commit
+    unsigned long int ticket = atomic_load(&(slot->ticket));
+    while (atomic_load(NumaEpoch(region)) < ticket)
+    {
+      relinquish_cpu();
+    }
+  }
+}
+
+/**
+ * @brief Records the epoch the scheduled transaction runs in, which
+ * the next holders of its slots wait for, once it began.
+ * @param region Region the transaction runs on
+ * @param ticket Epoch from which the writes of the transaction are
+ * visible, 0 if there is nothing to wait for
+ */
+static inline void ScheduleBegun(Region *region, unsigned long int ticket)
+{
+  if (thread_context.schedule_region == region)
+  {
+    thread_context.schedule_ticket = ticket;
+  }
+}
+
+/**
+ * @brief Ends the scheduled transaction of the calling thread, if it
+ * runs on the region. The slots it hinted get hotter when it aborted
+ * on a conflict and cool down when it committed, and the slots it held
+ * go to the next transactions queued on them.
+ * @param region Region the transaction ran on
+ * @param reason Why the transaction aborted, abort_none if it committed
+ */
+static inline void ScheduleLeave(Region *region, abort_reason_t reason)
+{
+  if (likely(thread_context.schedule_region != region))
+  {
+    return;
+  }
+
+  for (size_t i = 0; i < thread_context.n_schedule_slots; ++i)
+  {
+    ScheduleSlot *slot = region->schedule + thread_context.schedule_slots[i];
+
+    // The heat is only a prediction, concurrent updates may get lost
+    unsigned long int heat = atomic_load(&(slot->heat));
+    if (reason == abort_read_write || reason == abort_write_write)
+    {
+      atomic_store(&(slot->heat), heat + SCHEDULE_ABORT_HEAT < SCHEDULE_MAX_HEAT ? heat + SCHEDULE_ABORT_HEAT : SCHEDULE_MAX_HEAT);
+    }
+    else if (reason == abort_none && heat != 0)
+    {
+      atomic_store(&(slot->heat), heat - 1);
+    }
+
+    if ((thread_context.schedule_held & (1u << i)) != 0)
+    {
+      atomic_store(&(slot->ticket), thread_context.schedule_ticket);
+      atomic_fetch_add(&(slot->serving), 1);
+    }
+  }
+
+  thread_context.schedule_region = NULL;
+  thread_context.n_schedule_slots = 0;
+  thread_context.schedule_held = 0;
+}
+
+/**
+ * @brief Gives the slots back when the scheduled
+ * transaction could not begin, predicting nothing.
+ * @param region Region the transaction was to run on
+ */
+static inline void ScheduleCancel(Region *region)
+{
+  ScheduleBegun(region, 0);
+  ScheduleLeave(region, abort_retry);
+}
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef _SHARDS_H_
+#define _SHARDS_H_
+
+#include "basic_operations.h"
+#include "coarse.h"
+#include "context.h"
+#include "engine.h"
+#include "macros.h"
+#include "memory.h"
+
+/**
+ * @brief Begins a transaction on several shards, entering them in
+ * increasing order so that two such transactions never wait for each
+ * other. A writer runs irrevocably on each shard, so that a reader
+ * entering its shards after it commits on the first one cannot see
+ * the others before it commits on them too. A writer on a single shard
+ * has no other shard to stay atomic with, and shares its epoch.
+ * @param region Region split into the shards
+ * @param mask Shards to run on, one bit per shard
+ * @param is_ro Whether the transaction is read only
+ * @return SHARDS_OWNER, invalid_tx if the mask names no or unknown shards
+ */
+static inline tx_t ShardsBegin(Region *region, uint64_t mask, bool is_ro)
+{
+  if (mask == 0 || (mask >> region->n_shards) != 0)
+  {
+    return invalid_tx;
+  }
+
+  thread_context.snapshot_isolation = false;
+  RetryReset(false);
+  bool single = (mask & (mask - 1)) == 0;
+  for (size_t i = 0; i < region->n_shards; ++i)
+  {
+    if ((mask & (1ul << i)) == 0)
+    {
+      continue;
+    }
+
+    // Multi-version snapshots of different shards are taken at
+    // different times, readers read the committed copies instead
+    Region *shard = region->shards[i];
+    ShardEntry *entry = thread_context.shards + i;
+    AwaitOwnWrites(shard, no_deadline);
+    entry->engine = EngineEnter(shard, no_deadline);
+    if (entry->engine == ENGINE_COARSE)
+    {
+      entry->tx = EnterCoarse(shard, is_ro, no_deadline);
+    }
+    else if (is_ro || (single && likely(thread_context.aborts < CM_SERIAL_AFTER_ABORTS)))
+    {
+      entry->tx = Enter(shard, is_ro, PRIORITY_NORMAL, no_deadline);
+    }
+    else
+    {
+      entry->tx = EnterSerial(shard, no_deadline);
+    }
+  }
+
+  thread_context.shard_mask = mask;
+  thread_context.shards_ro = is_ro;
+  return SHARDS_OWNER;
+}
+
+/**
+ * @brief Returns the first shard of the current transaction,
+ * which serves its allocations.
+ * @param region Region split into the shards
+ * @param tx Receives the identifier of the transaction on that shard
+ * @return First shard of the transaction
+ */
+static inline Region *ShardsFirst(Region *region, tx_t *tx)
+{
+  size_t i = (size_t)__builtin_ctzl(thread_context.shard_mask);
+  thread_context.engine = thread_context.shards[i].engine;
+  *tx = thread_context.shards[i].tx;
+  return region->shards[i];
+}
+
+/**
+ * @brief Finds the shard of the current transaction holding an address.
+ * @param region Region split into the shards
+ * @param address Address to look up
+ * @param tx Receives the identifier of the transaction on that shard
+ * @return Shard holding the address, NULL if none of the transaction does
+ */
+static inline Region *ShardsLookup(Region *region, const void *address, tx_t *tx)
+{
+  // On a single shard, the shard itself looks the address up
+  uint64_t mask = thread_context.shard_mask;
+  if (mask != 0 && (mask & (mask - 1)) == 0)
+  {
+    return ShardsFirst(region, tx);
+  }
+
+  for (size_t i = 0; mask != 0; ++i, mask >>= 1)
+  {
+    if ((mask & 1) != 0 && LookupSegment(region->shards[i], address) != NULL)
+    {
+      thread_context.engine = thread_context.shards[i].engine;
+      *tx = thread_context.shards[i].tx;
+      return region->shards[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * @brief Aborts the current transaction on each of its shards.
+ * @param region Region split into the shards
+ * @param aborted Shard the transaction already aborted on, NULL if none
+ * @param reason Why the transaction aborted
+ */
+static inline void ShardsUndo(Region *region, Region *aborted, abort_reason_t reason)
+{
+  uint64_t mask = thread_context.shard_mask;
+  thread_context.shard_mask = 0;
+  for (size_t i = 0; mask != 0; ++i, mask >>= 1)
+  {
+    if ((mask & 1) != 0 && region->shards[i] != aborted)
+    {
+      thread_context.engine = thread_context.shards[i].engine;
+      Undo(region->shards[i], thread_context.shards[i].tx, reason);
+    }
+  }
+  thread_context.reason = reason;
+}
+
+#endif
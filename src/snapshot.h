@@ -0,0 +1,156 @@
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <string.h>
+
+#include "basic_operations.h"
+#include "context.h"
+#include "contention.h"
+#include "macros.h"
+#include "memory.h"
+#include "relinquish_cpu.h"
+#include "versions.h"
+
+/**
+ * @brief Begins a read only transaction on the last committed
+ * epoch, pinning the reclamation phase so that the segments
+ * it may read are not freed under it.
+ * @param region Region to read
+ * @return Handle of the snapshot transaction
+ */
+static inline tx_t SnapshotBegin(Region *region)
+{
+  while (true)
+  {
+    unsigned long int phase = atomic_load(&(region->reclaimer.phase));
+    atomic_fetch_add(&(region->reclaimer.active[phase]), 1);
+    if (phase == atomic_load(&(region->reclaimer.phase)))
+    {
+      thread_context.phase = phase;
+      break;
+    }
+    atomic_fetch_sub(&(region->reclaimer.active[phase]), 1);
+  }
+
+  // Only taken once pinned, so that everything removed
+  // before the snapshot stays unreachable from it
+  thread_context.snapshot = atomic_load(&(region->batcher.counter));
+  thread_context.last_segment = NULL;
+  return SNAPSHOT_OWNER;
+}
+
+/**
+ * @brief Ends the snapshot transaction of the calling thread.
+ * @param region Region that was read
+ */
+static inline void SnapshotEnd(Region *region)
+{
+  atomic_fetch_sub(&(region->reclaimer.active[thread_context.phase]), 1);
+}
+
+/**
+ * @brief Reads a word as it was at the snapshot, from the committed
+ * copy or its history, retrying while the epoch commit changes it.
+ * @param region Region holding the word
+ * @param data Data of the segment holding the word
+ * @param versions Versions of the segment
+ * @param words Number of words in the segment
+ * @param index Index of the word
+ * @param target Where to copy the word
+ * @return Whether the version read at the snapshot was still kept
+ */
+static inline bool SnapshotReadWord(Region *region, char const *data, atomic_ulong *versions, size_t words, size_t index, void *target)
+{
+  size_t align = region->align;
+  atomic_ulong *history = MvccHistoryStamps(versions, words) + index * MVCC_DEPTH;
+  char const *values = MvccHistoryValues(versions, words) + index * MVCC_DEPTH * align;
+
+  while (true)
+  {
+    unsigned long int stamp = atomic_load_explicit(versions + index, memory_order_acquire);
+    if (stamp == VERSION_BUSY)
+    {
+      relinquish_cpu();
+      continue;
+    }
+
+    bool kept = true;
+    if (stamp <= thread_context.snapshot)
+    {
+      // The committed copy is older than the snapshot
+      memcpy(target, data + index * align, align);
+    }
+    else
+    {
+      // Newest previous version committed at or before the snapshot,
+      // empty and busy slots being stamped after any snapshot
+      size_t newest = MVCC_DEPTH;
+      for (size_t j = 0; j < MVCC_DEPTH; ++j)
+      {
+        unsigned long int candidate = atomic_load_explicit(history + j, memory_order_relaxed);
+        if (candidate <= thread_context.snapshot && (newest == MVCC_DEPTH || candidate > atomic_load_explicit(history + newest, memory_order_relaxed)))
+        {
+          newest = j;
+        }
+      }
+      kept = newest != MVCC_DEPTH;
+      if (kept)
+      {
+        memcpy(target, values + newest * align, align);
+      }
+    }
+
+    // The history only changes along with the committed copy
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(versions + index, memory_order_relaxed) == stamp)
+    {
+      return kept;
+    }
+  }
+}
+
+/**
+ * @brief Reads words as they were at the snapshot of the
+ * snapshot transaction of the calling thread.
+ * @param region Region holding the words
+ * @param source Address of the first word
+ * @param size Number of bytes to read
+ * @param target Where to copy the words
+ * @return abort_none on success, or why the transaction must abort
+ */
+static inline abort_reason_t SnapshotRead(Region *region, void const *source, size_t size, void *target)
+{
+  // Consecutive reads usually hit the same segment
+  Segment *segment = thread_context.last_segment;
+  if (segment == NULL || (char const *)source < (char const *)segment->data || (char const *)source >= (char const *)segment->data + segment->size)
+  {
+    segment = LookupSegment(region, source);
+    if (segment == NULL)
+    {
+      return abort_lookup;
+    }
+    thread_context.last_segment = segment;
+  }
+
+  // The segment might be removed meanwhile, its memory
+  // then being retired rather than freed
+  atomic_ulong *versions = atomic_load(&(segment->versions));
+  char const *data = segment->data;
+  size_t words = segment->size / region->align;
+  if (versions == NULL || data == NULL || (char const *)source < data || (char const *)source + size > data + words * region->align)
+  {
+    return abort_lookup;
+  }
+
+  size_t base_index = ((char const *)source - data) / region->align;
+  for (size_t i = 0; i < size / region->align; ++i)
+  {
+    if (!SnapshotReadWord(region, data, versions, words, base_index + i, (char *)target + i * region->align))
+    {
+      return abort_snapshot_too_old;
+    }
+  }
+  return abort_none;
+}
+
+#endif
@@ -4,8 +4,23 @@
 #error Current C11 compiler does not support atomic operations
 #endif
 
+#include <tm_ext.h>
+
 #include "memory.h"
 #include "basic_operations.h"
+#include "coalesce.h"
+#include "coarse.h"
+#include "descriptor.h"
+#include "engine.h"
+#include "numa.h"
+#include "privatize.h"
+#include "retry.h"
+#include "savepoint.h"
+#include "schedule.h"
+#include "shards.h"
+#include "snapshot.h"
+#include "upgrade.h"
+#include "watchdog.h"
 
 /** Create (i.e. allocate + init) a new shared memory region, with one first non-free-able allocated segment of the requested size and alignment.
  * @param size  Size of the first shared segment of memory to allocate (in bytes), must be a positive multiple of the alignment
@@ -35,17 +50,82 @@ shared_t tm_create(size_t size, size_t align)
   atomic_store(&(region->batcher.n_entered), 0);
   atomic_store(&(region->batcher.n_write_entered), 0);
   atomic_store(&(region->batcher.n_write_slots), MAX_WRITE_TX_PER_EPOCH);
+  atomic_store(&(region->batcher.serial), false);
+  atomic_store(&(region->batcher.exclusive), false);
+  atomic_store(&(region->batcher.solo), false);
+  atomic_store(&(region->batcher.n_serial_waiting), 0);
+  atomic_store(&(region->batcher.n_high_waiting), 0);
+  atomic_store(&(region->batcher.n_epoch_waiting), 0);
+  atomic_store(&(region->batcher.last_high), 0);
+  for (size_t i = 0; i < ABANDONED_TICKETS; ++i)
+  {
+    atomic_store(&(region->batcher.abandoned[i]), 0);
+  }
+
+  // Initializing the placement and the epoch counters of the nodes
+  NumaInit(region);
+
+  // Initializing contention management
+  atomic_store(&(region->cm_policy), ContentionPolicyFromEnv());
+  for (size_t i = 0; i <= MAX_WRITE_TX_PER_EPOCH; ++i)
+  {
+    atomic_store(&(region->karma[i]), 0);
+  }
+
+  // Initializing the descriptors of the threads
+  DescriptorInit(region);
+
+  // Initializing the threads waiting for a change
+  pthread_mutex_init(&(region->retry.lock), NULL);
+  pthread_cond_init(&(region->retry.cond), NULL);
+  atomic_store(&(region->retry.sleepers), 0);
+  memset(region->retry.watched, 0, sizeof(region->retry.watched));
+  region->retry.generation = 0;
+
+  // Initializing the scheduler, every slot cold and free
+  for (size_t i = 0; i < SCHEDULE_SLOTS; ++i)
+  {
+    atomic_store(&(region->schedule[i].next), 0);
+    atomic_store(&(region->schedule[i].serving), 0);
+    atomic_store(&(region->schedule[i].ticket), 0);
+    atomic_store(&(region->schedule[i].heat), 0);
+  }
+
+  // Initializing the watchdog
+  atomic_store(&(region->watchdog.threshold), WatchdogFromEnv());
+  atomic_store(&(region->watchdog.doomed), 0);
+
+  // Regions are not split unless created sharded
+  region->shards = NULL;
+  region->n_shards = 0;
+
+  // Initializing multi-version reads
+  atomic_store(&(region->mvcc), MvccFromEnv());
+  atomic_store(&(region->reclaimer.phase), 0);
+  atomic_store(&(region->reclaimer.active[0]), 0);
+  atomic_store(&(region->reclaimer.active[1]), 0);
+  region->reclaimer.retired[0] = NULL;
+  region->reclaimer.retired[1] = NULL;
+
+  // Initializing the engine
+  if (pthread_rwlock_init(&(region->engine.lock), NULL) != 0)
+  {
+    free(region);
+    return invalid_shared;
+  }
+  EngineReset(region, EngineFromEnv());
 
   // Allocating space for region->segments
-  region->segments = malloc(getpagesize());
+  region->segments = malloc(MAX_SEGMENTS * sizeof(Segment));
   if (region->segments == NULL)
   {
+    pthread_rwlock_destroy(&(region->engine.lock));
     free(region);
     return invalid_shared;
   }
 
   // Initializing region->segment
-  memset(region->segments, 0, getpagesize());
+  memset(region->segments, 0, MAX_SEGMENTS * sizeof(Segment));
 
   region->segments->size = size;
   atomic_store(&(region->segments->status), DEFAULT);
@@ -53,9 +133,10 @@ shared_t tm_create(size_t size, size_t align)
 
   // Allocating Space for region->segment->data
   size_t control_size = (size / true_align) * sizeof(tx_t);
-  if (posix_memalign(&(region->segments->data), true_align, (size << 1) + control_size) != 0)
+  if (!NumaAllocate(region, &(region->segments->data), (size << 1) + control_size))
   {
     free(region->segments);
+    pthread_rwlock_destroy(&(region->engine.lock));
     free(region);
     return invalid_shared;
   }
@@ -63,6 +144,16 @@ shared_t tm_create(size_t size, size_t align)
   // Initializing region->segment->data
   memset(region->segments->data, 0, (size << 1) + control_size);
 
+  // Versioning the first segment
+  if (atomic_load(&(region->mvcc)) && !MvccAllocate(region, region->segments))
+  {
+    free(region->segments->data);
+    free(region->segments);
+    pthread_rwlock_destroy(&(region->engine.lock));
+    free(region);
+    return invalid_shared;
+  }
+
   return region;
 }
 
@@ -74,11 +165,27 @@ void tm_destroy(shared_t shared)
   Region *region = shared;
 
   // Deallocating all the segments in the region
-  for (size_t i = region->index; i < region->index; --i)
+  for (size_t i = region->index; i-- > 0;)
   {
     free(region->segments[i].data);
+    free(atomic_load(&(region->segments[i].debits)));
+    free(atomic_load(&(region->segments[i].versions)));
+    free(atomic_load(&(region->segments[i].ranges)));
   }
   free(region->segments);
+  MvccFree(region->reclaimer.retired[0]);
+  MvccFree(region->reclaimer.retired[1]);
+  DescriptorFree(region);
+  pthread_mutex_destroy(&(region->retry.lock));
+  pthread_cond_destroy(&(region->retry.cond));
+  pthread_rwlock_destroy(&(region->engine.lock));
+
+  // Destroying the other shards, the region being the first one
+  for (size_t i = 1; i < region->n_shards; ++i)
+  {
+    tm_destroy(region->shards[i]);
+  }
+  free(region->shards);
 
   // Deallocating region itself
   free(region);
@@ -107,14 +214,273 @@ size_t tm_align(shared_t shared) { return ((Region *)shared)->true_align; }
  * @param is_ro  Whether the transaction is read-only
  * @return Opaque transaction ID, 'invalid_tx' on failure
  **/
-tx_t tm_begin(shared_t shared, bool is_ro) { return Enter((Region *)shared, is_ro); }
+tx_t tm_begin(shared_t shared, bool is_ro) { return tm_begin_deadline(shared, is_ro ? begin_read_only : 0, no_deadline); }
+
+/** [thread-safe] Begin a new transaction on the given shared memory region, with the given mode flags.
+ * @param shared Shared memory region to start a transaction on
+ * @param flags  Bitwise or of 'begin_*' flags
+ * @return Opaque transaction ID, 'invalid_tx' on failure
+ **/
+tx_t tm_begin_mode(shared_t shared, begin_flags_t flags) { return tm_begin_deadline(shared, flags, no_deadline); }
+
+/** [thread-safe] Begin a new transaction on the given shared memory region, with the given mode flags, giving up once the deadline passed.
+ * @param shared   Shared memory region to start a transaction on
+ * @param flags    Bitwise or of 'begin_*' flags
+ * @param deadline Absolute 'CLOCK_MONOTONIC' time (in ns) after which to stop waiting, 'no_deadline' for none
+ * @return Opaque transaction ID, 'invalid_tx' on failure or once the deadline passed
+ **/
+tx_t tm_begin_deadline(shared_t shared, begin_flags_t flags, deadline_t deadline)
+{
+  Region *region = (Region *)shared;
+  bool is_ro = flags & begin_read_only;
+  int priority = (flags & begin_high_priority) ? PRIORITY_HIGH : (flags & begin_low_priority) ? PRIORITY_LOW : PRIORITY_NORMAL;
+
+  // Reading our own writes, even those committed without waiting,
+  // unless the caller keeps their tickets and waited for them itself
+  if (!(flags & begin_caller_tickets) && !AwaitOwnWrites(region, deadline))
+  {
+    return invalid_tx;
+  }
+  thread_context.caller_tickets = flags & begin_caller_tickets;
+
+  // Transactions are serializable unless begun otherwise
+  thread_context.snapshot_isolation = false;
+  RetryReset(flags & begin_retry);
+  SavepointReset();
+
+  // Under the coarse engine, the region lock replaces the batcher
+  // and the multi-version snapshots, and writers already run alone
+  int engine = EngineEnter(region, deadline);
+  if (engine == ENGINE_SWITCHING)
+  {
+    return invalid_tx;
+  }
+  if (engine == ENGINE_COARSE)
+  {
+    tx_t tx = EnterCoarse(region, is_ro, deadline);
+    if (tx == invalid_tx)
+    {
+      EngineCancel(region);
+      return invalid_tx;
+    }
+    return RetryBegin(tx);
+  }
+
+  tx_t tx;
+  if ((flags & begin_irrevocable) && !is_ro)
+  {
+    tx = EnterSerial(region, deadline);
+  }
+  else if ((flags & begin_upgradable) && !is_ro)
+  {
+    // Starting as a reader, unless the writer keeps aborting
+    if (unlikely(thread_context.aborts >= CM_SERIAL_AFTER_ABORTS))
+    {
+      tx = EnterSerial(region, deadline);
+    }
+    else
+    {
+      // An upgraded attempt that aborted on a read or write
+      // left its identifier behind, from an older epoch
+      UpgradeForget(region);
+      tx = Enter(region, true, priority, deadline) == invalid_tx ? invalid_tx : UPGRADABLE_OWNER;
+    }
+  }
+  else if (is_ro && atomic_load(&(region->mvcc)) && likely(thread_context.aborts < CM_SERIAL_AFTER_ABORTS))
+  {
+    // Readers of multi-version snapshots stay out of the batcher,
+    // unless writers keep outrunning the history they need, in
+    // which case they join the epoch and read the committed copy
+    tx = SnapshotBegin(region);
+  }
+  else if (!is_ro && unlikely(thread_context.aborts >= CM_SERIAL_AFTER_ABORTS))
+  {
+    // Writers that keep aborting run alone
+    tx = EnterSerial(region, deadline);
+  }
+  else
+  {
+    tx = Enter(region, is_ro, priority, deadline);
+  }
+
+  if (tx == invalid_tx)
+  {
+    EngineCancel(region);
+    return invalid_tx;
+  }
+
+  // Read only transactions already read the committed copy unmarked
+  thread_context.snapshot_isolation = flags & begin_snapshot_isolation;
+  return RetryBegin(tx);
+}
+
+/** [thread-safe] Begin a new transaction on the given shared memory region, queued behind the running transactions predicted to conflict with it. The prediction hashes the hints by cache line, and learns from the conflicts the transactions giving the same hints aborted on. Read only and upgradable transactions are never queued.
+ * @param shared  Shared memory region to start a transaction on
+ * @param flags   Bitwise or of 'begin_*' flags
+ * @param hints   Addresses (or keys) the transaction will access, only the first 16 counting
+ * @param n_hints Number of hints
+ * @return Opaque transaction ID, 'invalid_tx' on failure
+ **/
+tx_t tm_begin_hinted(shared_t shared, begin_flags_t flags, void const *const *hints, size_t n_hints)
+{
+  Region *region = (Region *)shared;
+
+  // Upgradable transactions enter as readers, which may leave an epoch
+  // without writers that never commits for the next holders to wait on
+  if (flags & (begin_read_only | begin_upgradable))
+  {
+    return tm_begin_deadline(shared, flags, no_deadline);
+  }
+
+  ScheduleEnter(region, hints, n_hints);
+  tx_t tx = tm_begin_deadline(shared, flags, no_deadline);
+  if (tx == invalid_tx)
+  {
+    ScheduleCancel(region);
+    return invalid_tx;
+  }
+
+  // The coarse engine already runs writers one after the other
+  ScheduleBegun(region, thread_context.engine == ENGINE_COARSE ? 0 : atomic_load(&(region->batcher.counter)) + 1);
+  return tx;
+}
 
 /** [thread-safe] End the given transaction.
  * @param shared Shared memory region associated with the transaction
  * @param tx     Transaction to end
  * @return Whether the whole transaction committed
  **/
-bool tm_end(shared_t shared, tx_t tx) { return Leave((Region *)shared, tx); }
+bool tm_end(shared_t shared, tx_t tx) { return tm_end_deadline(shared, tx, no_deadline) != abort_end; }
+
+/** [thread-safe] End the given transaction, waiting for its writes to be visible to the other threads until the deadline passed.
+ * @param shared   Shared memory region associated with the transaction
+ * @param tx       Transaction to end
+ * @param deadline Absolute 'CLOCK_MONOTONIC' time (in ns) after which to stop waiting, 'no_deadline' for none
+ * @return Whether the transaction committed, and whether its writes are visible
+ **/
+end_t tm_end_deadline(shared_t shared, tx_t tx, deadline_t deadline)
+{
+  ticket_t ticket;
+  if (!tm_end_async(shared, tx, &ticket))
+  {
+    return abort_end;
+  }
+
+  // Waiting for our writes to be visible to the other threads
+  return AwaitTicket((Region *)shared, ticket, deadline) ? visible_end : pending_end;
+}
+
+/** [thread-safe] End the given transaction, returning once it is committed but possibly before its writes are visible to the other threads.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to end
+ * @param ticket Ticket receiving when the writes become visible, 'visible_ticket' if they already are
+ * @return Whether the whole transaction committed
+ **/
+bool tm_end_async(shared_t shared, tx_t tx, ticket_t *ticket)
+{
+  *ticket = visible_ticket;
+  tx = RetryOwner(tx);
+
+  // A transaction spanning several shards ends on each of them, where
+  // a writer runs alone and so commits as soon as it leaves
+  if (tx == SHARDS_OWNER)
+  {
+    Region *region = (Region *)shared;
+    uint64_t mask = thread_context.shard_mask;
+    thread_context.shard_mask = 0;
+    for (size_t i = 0; mask != 0; ++i, mask >>= 1)
+    {
+      if ((mask & 1) != 0)
+      {
+        ticket_t shard_ticket;
+        thread_context.engine = thread_context.shards[i].engine;
+        tm_end_async(region->shards[i], thread_context.shards[i].tx, &shard_ticket);
+        AwaitTicket(region->shards[i], shard_ticket, no_deadline);
+      }
+    }
+    return true;
+  }
+
+  // A snapshot reader read committed values only
+  if (tx == SNAPSHOT_OWNER)
+  {
+    SnapshotEnd((Region *)shared);
+    ContentionCommit((Region *)shared);
+    EngineLeave((Region *)shared);
+    return true;
+  }
+
+  // Transactions of the coarse engine only hold the region lock
+  if (tx == COARSE_OWNER || (tx == RO_OWNER && thread_context.engine == ENGINE_COARSE))
+  {
+    ContentionCommit((Region *)shared);
+    LeaveCoarse((Region *)shared, tx);
+    return true;
+  }
+
+  // An upgradable transaction ends as what it became
+  if (tx == UPGRADABLE_OWNER)
+  {
+    tx = thread_context.upgraded != NO_OWNER ? thread_context.upgraded : RO_OWNER;
+    UpgradeForget((Region *)shared);
+  }
+
+  ContentionCommit((Region *)shared);
+  AddForget((Region *)shared);
+  *ticket = Leave((Region *)shared, tx, true);
+  EngineLeave((Region *)shared);
+
+  // Our next transaction waits for the writes to be visible,
+  // unless the caller keeps the ticket
+  if (*ticket != visible_ticket && !thread_context.caller_tickets)
+  {
+    thread_context.pending_region = (Region *)shared;
+    thread_context.pending = *ticket;
+  }
+  return true;
+}
+
+/** [thread-safe] End the given transaction without waiting, neither for the turn of the batcher nor for its writes to be visible, for callers that cannot block their thread. A transaction spanning several shards still waits.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to end
+ * @param ticket Ticket receiving when the writes become visible, 'visible_ticket' if they already are
+ * @return 'busy_end' if the transaction could not leave the batcher without waiting and still runs, to be ended again from the same thread, 'abort_end' if it aborted, else whether its writes are visible
+ **/
+end_t tm_try_end(shared_t shared, tx_t tx, ticket_t *ticket)
+{
+  *ticket = visible_ticket;
+  tx = RetryOwner(tx);
+
+  // Only the transactions of the batcher wait for its turn to leave
+  // it, which then is taken here and held until they left
+  if (tx != SHARDS_OWNER && tx != SNAPSHOT_OWNER && tx != COARSE_OWNER && thread_context.engine != ENGINE_COARSE)
+  {
+    if (!TakeTurn((Region *)shared, 1))
+    {
+      return busy_end;
+    }
+    thread_context.turn_held = true;
+  }
+
+  if (!tm_end_async(shared, tx, ticket))
+  {
+    return abort_end;
+  }
+  return *ticket == visible_ticket ? visible_end : pending_end;
+}
+
+/** [thread-safe] Check whether the writes of a transaction ended with 'tm_end_async' are visible to the other threads.
+ * @param shared Shared memory region associated with the transaction
+ * @param ticket Ticket returned by 'tm_end_async'
+ * @return Whether the writes are visible
+ **/
+bool tm_is_visible(shared_t shared, ticket_t ticket) { return atomic_load(&(((Region *)shared)->batcher.counter)) >= ticket; }
+
+/** [thread-safe] Wait until the writes of a transaction ended with 'tm_end_async' are visible to the other threads.
+ * @param shared Shared memory region associated with the transaction
+ * @param ticket Ticket returned by 'tm_end_async'
+ **/
+void tm_wait_visible(shared_t shared, ticket_t ticket) { AwaitTicket((Region *)shared, ticket, no_deadline); }
 
 /** [thread-safe] Read operation in the given transaction, source in the shared region and target in a private region.
  * @param shared Shared memory region associated with the transaction
@@ -126,50 +492,180 @@ bool tm_end(shared_t shared, tx_t tx) { return Leave((Region *)shared, tx); }
  **/
 bool tm_read(shared_t shared, tx_t tx, void const *source, size_t size, void *target)
 {
-  // If it's a read only transaction we only need to copy the contents of the memory
-  if (tx == RO_OWNER)
+  // If it's a read only transaction, or the writer of the coarse
+  // engine, we only need to copy the contents of the memory
+  if (tx == RO_OWNER || tx == COARSE_OWNER)
   {
     memcpy(target, source, size);
     return true;
   }
 
-  // Looking up segment
+  // Logging the lines read, for a later retry to sleep on them
+  if (unlikely(tx == RETRY_OWNER))
+  {
+    return RetryRead(shared, source, size, target);
+  }
+
+  // Reading from the shard holding the words
   Region *region = (Region *)shared;
+  if (unlikely(tx == SHARDS_OWNER))
+  {
+    if (thread_context.shards_ro)
+    {
+      memcpy(target, source, size);
+      return true;
+    }
+    Region *shard = ShardsLookup(region, source, &tx);
+    if (shard == NULL || !tm_read(shard, tx, source, size, target))
+    {
+      ShardsUndo(region, shard, shard == NULL ? abort_lookup : thread_context.reason);
+      return false;
+    }
+    return true;
+  }
+
+  // Reading the versions at the snapshot
+  if (tx == SNAPSHOT_OWNER)
+  {
+    abort_reason_t reason = SnapshotRead(region, source, size, target);
+    if (reason != abort_none)
+    {
+      SnapshotEnd(region);
+      EngineLeave(region);
+      ContentionAbort(region, reason);
+      return false;
+    }
+    return true;
+  }
+
+  // Until it upgrades, an upgradable transaction reads as a read only one
+  if (tx == UPGRADABLE_OWNER)
+  {
+    if (thread_context.upgraded == NO_OWNER)
+    {
+      if (!thread_context.snapshot_isolation)
+      {
+        UpgradeLogRead(region, source, size);
+      }
+      memcpy(target, source, size);
+      return true;
+    }
+    tx = thread_context.upgraded;
+  }
+
+  // Evicted for holding the epoch open for too long
+  if (unlikely(WatchdogDoomed(region, tx)))
+  {
+    DescriptorCount(region, offsetof(Stats, dooms));
+    Undo(region, tx, abort_doomed);
+    return false;
+  }
+
+  // Looking up segment
   Segment *segment = LookupSegment(region, source);
   if (segment == NULL)
   {
-    Undo(region, tx);
+    Undo(region, tx, abort_lookup);
     return false;
   }
 
+  // Alone in the epoch, the latest values are the writable ones
+  if (unlikely(atomic_load(&(region->batcher.exclusive))))
+  {
+    memcpy(target, (char *)source + segment->size, size);
+    return true;
+  }
+
   // Getting control words
   size_t base_index = ((char *)source - (char *)segment->data) / region->align;
   atomic_tx *controls = ((atomic_tx *)((char *)segment->data + (segment->size << 1))) + base_index;
 
-  // Reading the content of the memory
+  // Under snapshot isolation, words are read unmarked from the committed
+  // copy, which stays the same until the epoch ends, and only the words
+  // we locked are read from the writable copy
   size_t max = size / region->align;
-  for (size_t i = 0; i < max; ++i)
+  if (thread_context.snapshot_isolation)
+  {
+    for (size_t i = 0; i < max; ++i)
+    {
+      size_t offset = i * region->true_align;
+      tx_t control = atomic_load(controls + i);
+      if (tx == control || unlikely(RangeOwned(segment, tx, base_index + i)))
+      {
+        offset += segment->size;
+      }
+      memcpy(((char *)target) + i * region->true_align, ((char *)source) + offset, region->true_align);
+
+      // Adding our own deltas to a word we share with the other adders
+      if (unlikely(control == ADD_OWNER))
+      {
+        size_t count;
+        int64_t value, sum = AddPending(region, segment, base_index + i, &count);
+        memcpy(&value, ((char *)target) + i * region->true_align, sizeof(value));
+        value += sum;
+        memcpy(((char *)target) + i * region->true_align, &value, sizeof(value));
+      }
+    }
+    ContentionWork(region, tx, max);
+    return true;
+  }
+
+  // Reading the content of the memory
+  for (size_t i = 0, attempt = 0; i < max; ++i, attempt = 0)
   {
-    tx_t expected = NO_OWNER;
+  retry:;
+    tx_t expected;
     if (tx == atomic_load(controls + i))
     {
       // We are the owner
       memcpy(((char *)target) + i * region->true_align, ((char *)source) + i * region->true_align + segment->size, region->true_align);
     }
-    else if (atomic_compare_exchange_strong(controls + i, &expected, -tx) || expected == -tx || expected == RO_OWNER || (expected > RO_OWNER && atomic_compare_exchange_strong(controls + i, &expected, RO_OWNER)))
+    else if (MarkRead(controls + i, tx, &expected))
+    {
+      if (unlikely(RangeOwned(segment, tx, base_index + i)))
+      {
+        // We own the word through a range lock
+        memcpy(((char *)target) + i * region->true_align, ((char *)source) + i * region->true_align + segment->size, region->true_align);
+      }
+      else if (unlikely(RangeConflict(segment, tx, base_index + i, base_index + i + 1)))
+      {
+        // Someone else holds the word through a range lock, undo
+        if (!SavepointKeep(region, abort_read_write))
+        {
+          Undo(region, tx, abort_read_write);
+        }
+        return false;
+      }
+      else
+      {
+        // We have previously read it or the word has not owner yet
+        memcpy(((char *)target) + i * region->true_align, ((char *)source) + i * region->true_align, region->true_align);
+      }
+    }
+    else if (expected == ADD_OWNER && AddClaim(region, segment, tx, base_index + i))
+    {
+      // We added to the word, which is now ours
+      goto retry;
+    }
+    else if (ContentionWait(region, tx, expected, attempt++))
     {
-      // We have previously read it or the word has not owner yet
-      memcpy(((char *)target) + i * region->true_align, ((char *)source) + i * region->true_align, region->true_align);
+      // The owner might give up the word
+      goto retry;
     }
     else
     {
       // We were not able to read the word, undo
-      Undo(region, tx);
+      if (!SavepointKeep(region, abort_read_write))
+      {
+        Undo(region, tx, abort_read_write);
+      }
 
       // Read as unsuccessful
       return false;
     }
   }
+
+  ContentionWork(region, tx, max);
   return true;
 }
 
@@ -184,25 +680,91 @@ bool tm_read(shared_t shared, tx_t tx, void const *source, size_t size, void *ta
 bool tm_write(shared_t shared, tx_t tx, void const *source, size_t size, void *target)
 {
   Region *region = (Region *)shared;
+  tx = RetryOwner(tx);
+
+  // Writing to the shard holding the words
+  if (unlikely(tx == SHARDS_OWNER))
+  {
+    Region *shard = ShardsLookup(region, target, &tx);
+    if (shard == NULL || !tm_write(shard, tx, source, size, target))
+    {
+      ShardsUndo(region, shard, shard == NULL ? abort_lookup : thread_context.reason);
+      return false;
+    }
+    return true;
+  }
+
+  // The writer of the coarse engine writes the committed copy,
+  // logging what it overwrites in case it aborts
+  if (tx == COARSE_OWNER)
+  {
+    if (!CoarseLog(region, target, size))
+    {
+      UndoCoarse(region, abort_write_write);
+      return false;
+    }
+    memcpy(target, source, size);
+    return true;
+  }
+
+  // Upgrading on the first write
+  if (tx == UPGRADABLE_OWNER && (tx = Upgrade(region)) == invalid_tx)
+  {
+    return false;
+  }
+
+  // Evicted for holding the epoch open for too long
+  if (unlikely(WatchdogDoomed(region, tx)))
+  {
+    DescriptorCount(region, offsetof(Stats, dooms));
+    Undo(region, tx, abort_doomed);
+    return false;
+  }
 
   // Looking up segment
   Segment *segment = LookupSegment(region, target);
   if (segment == NULL)
   {
-    Undo(region, tx);
+    Undo(region, tx, abort_lookup);
     return false;
   }
 
+  // Alone in the epoch, no word needs to be locked
+  if (unlikely(atomic_load(&(region->batcher.exclusive))))
+  {
+    if (!SavepointLogWrite(region, (char *)target + segment->size, size))
+    {
+      Undo(region, tx, abort_write_write);
+      return false;
+    }
+    size_t first = ((char *)target - (char *)segment->data) / region->align;
+    RangeDirty(segment, first, first + size / region->align);
+    memcpy((char *)target + segment->size, source, size);
+    return true;
+  }
+
   // Trying to locking all the words
-  if (!Lock(region, segment, tx, target, size))
+  abort_reason_t reason = Lock(region, segment, tx, target, size);
+  if (reason != abort_none)
   {
-    Undo(region, tx);
+    if (!SavepointKeep(region, reason))
+    {
+      Undo(region, tx, reason);
+    }
+    return false;
+  }
+
+  // Logging the values replaced, in case of a rollback to a savepoint
+  if (!SavepointLogWrite(region, (char *)target + segment->size, size))
+  {
+    Undo(region, tx, abort_write_write);
     return false;
   }
 
   // Copying the contents to the destination
   memcpy((char *)target + segment->size, source, size);
 
+  ContentionWork(region, tx, size / region->align);
   return true;
 }
 
@@ -216,6 +778,25 @@ bool tm_write(shared_t shared, tx_t tx, void const *source, size_t size, void *t
 alloc_t tm_alloc(shared_t shared, tx_t tx, size_t size, void **target)
 {
   Region *region = (Region *)shared;
+  tx = RetryOwner(tx);
+
+  // Allocating on the first shard of the transaction
+  if (unlikely(tx == SHARDS_OWNER))
+  {
+    Region *shard = ShardsFirst(region, &tx);
+    alloc_t result = tm_alloc(shard, tx, size, target);
+    if (result == abort_alloc)
+    {
+      ShardsUndo(region, shard, thread_context.reason);
+    }
+    return result;
+  }
+
+  // Upgrading on the first allocation
+  if (tx == UPGRADABLE_OWNER && (tx = Upgrade(region)) == invalid_tx)
+  {
+    return abort_alloc;
+  }
 
   // Allocating new segment
   unsigned long int index = atomic_fetch_add(&(region->index), 1);
@@ -223,12 +804,15 @@ alloc_t tm_alloc(shared_t shared, tx_t tx, size_t size, void **target)
 
   // Initializing new segment
   segment->size = size;
+  atomic_store(&(segment->debits), NULL);
+  segment->dirty_first = 0;
+  segment->dirty_last = 0;
   atomic_store(&(segment->owner), tx);
   atomic_store(&(segment->status), ADDED);
 
   // Allocating memory for the segment's data + control
   size_t control_size = segment->size / region->align * sizeof(tx_t);
-  if (posix_memalign(&(segment->data), region->true_align, (size << 1) + control_size) != 0)
+  if (!DescriptorAllocate(region, &(segment->data), (size << 1) + control_size))
   {
     return nomem_alloc;
   }
@@ -236,6 +820,16 @@ alloc_t tm_alloc(shared_t shared, tx_t tx, size_t size, void **target)
   // Initializing data and control
   memset(segment->data, 0, (size << 1) + control_size);
 
+  // Versioning the new segment, which can then only be removed, and
+  // logging it, a rollback to a savepoint freeing it back
+  if (!SavepointLogSegment(region, segment, tx, ADDED_AFTER_REMOVE) || (atomic_load(&(region->mvcc)) && !MvccAllocate(region, segment)))
+  {
+    free(segment->data);
+    segment->data = NULL;
+    atomic_store(&(segment->owner), RM_OWNER);
+    return nomem_alloc;
+  }
+
   *target = segment->data;
   return success_alloc;
 }
@@ -248,11 +842,31 @@ alloc_t tm_alloc(shared_t shared, tx_t tx, size_t size, void **target)
  **/
 bool tm_free(shared_t shared, tx_t tx, void *seg)
 {
+  tx = RetryOwner(tx);
+
+  // Freeing on the shard holding the segment
+  if (unlikely(tx == SHARDS_OWNER))
+  {
+    Region *shard = ShardsLookup((Region *)shared, seg, &tx);
+    if (shard == NULL || !tm_free(shard, tx, seg))
+    {
+      ShardsUndo((Region *)shared, shard, shard == NULL ? abort_lookup : thread_context.reason);
+      return false;
+    }
+    return true;
+  }
+
+  // Upgrading on the first free
+  if (tx == UPGRADABLE_OWNER && (tx = Upgrade((Region *)shared)) == invalid_tx)
+  {
+    return false;
+  }
+
   // Looking up segment
   Segment *segment = LookupSegment((Region *)shared, seg);
   if (segment == NULL)
   {
-    Undo((Region*)shared, tx);
+    Undo((Region*)shared, tx, abort_lookup);
     return false;
   }
 
@@ -260,13 +874,564 @@ bool tm_free(shared_t shared, tx_t tx, void *seg)
   tx_t expected = NO_OWNER;
   if (!(atomic_compare_exchange_strong(&segment->owner, &expected, tx) || expected == tx))
   {
-    Undo((Region *)shared, tx);
+    if (!SavepointKeep((Region *)shared, abort_write_write))
+    {
+      Undo((Region *)shared, tx, abort_write_write);
+    }
+    return false;
+  }
+
+  // Logging the segment, a rollback to a savepoint keeping it back
+  int previous_status = atomic_load(&(segment->status));
+  if (!SavepointLogSegment((Region *)shared, segment, expected, previous_status))
+  {
+    Undo((Region *)shared, tx, abort_write_write);
     return false;
   }
 
   // Signaling on segment status that the segment should be removed
-  int previous_status = atomic_load(&(segment->status));
   atomic_store(&(segment->status), previous_status == ADDED ? ADDED_AFTER_REMOVE : REMOVED);
 
   return true;
 }
+
+/** [thread-safe] Privatize a segment in the given transaction. Once the transaction committed and 'tm_quiesce' returned, the caller accesses the committed data of the segment directly, until it hands the segment back with 'tm_publish'. Transactions of the fine-grained engine that access the segment meanwhile abort, the others, like read-only ones, must not reach it anymore: the privatizing transaction typically unlinks it.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to use
+ * @param seg    Address of the first byte of the previously allocated segment to privatize
+ * @return Whether the whole transaction can continue
+ **/
+bool tm_privatize(shared_t shared, tx_t tx, void *seg)
+{
+  tx = RetryOwner(tx);
+
+  // Privatizing on the shard holding the segment
+  if (unlikely(tx == SHARDS_OWNER))
+  {
+    Region *shard = ShardsLookup((Region *)shared, seg, &tx);
+    if (shard == NULL || !tm_privatize(shard, tx, seg))
+    {
+      ShardsUndo((Region *)shared, shard, shard == NULL ? abort_lookup : thread_context.reason);
+      return false;
+    }
+    return true;
+  }
+
+  // Upgrading on the first privatization
+  if (tx == UPGRADABLE_OWNER && (tx = Upgrade((Region *)shared)) == invalid_tx)
+  {
+    return false;
+  }
+
+  // Looking up segment, only one that committed transactions allocated
+  Segment *segment = LookupSegment((Region *)shared, seg);
+  if (segment == NULL || segment->data != seg)
+  {
+    Undo((Region *)shared, tx, abort_lookup);
+    return false;
+  }
+
+  // Verifying segment has no current owner
+  tx_t expected = NO_OWNER;
+  if (!(atomic_compare_exchange_strong(&segment->owner, &expected, tx) || expected == tx) || atomic_load(&(segment->status)) != DEFAULT)
+  {
+    abort_reason_t reason = expected == tx ? abort_lookup : abort_write_write;
+    if (!SavepointKeep((Region *)shared, reason))
+    {
+      Undo((Region *)shared, tx, reason);
+    }
+    return false;
+  }
+
+  // Logging the segment, a rollback to a savepoint keeping it shared
+  if (!SavepointLogSegment((Region *)shared, segment, expected, DEFAULT))
+  {
+    Undo((Region *)shared, tx, abort_write_write);
+    return false;
+  }
+
+  // Signaling on segment status that the segment becomes private on commit
+  atomic_store(&(segment->status), PRIVATIZED);
+  return true;
+}
+
+/** [thread-safe] Wait until every transaction running on the given shared memory region has ended, so that none of them still accesses a segment privatized by a committed transaction.
+ * @param shared Shared memory region to quiesce
+ **/
+void tm_quiesce(shared_t shared)
+{
+  Region *region = (Region *)shared;
+  if (region->n_shards == 0)
+  {
+    PrivateQuiesce(region);
+    return;
+  }
+
+  for (size_t i = 0; i < region->n_shards; ++i)
+  {
+    PrivateQuiesce(region->shards[i]);
+  }
+}
+
+/** [thread-safe] Hand a privatized segment back to the transactions, committing the values written directly to it as a transaction writing them would. Must not be called within a transaction.
+ * @param shared Shared memory region holding the segment
+ * @param seg    Address of the first byte of the private segment
+ * @return Whether the segment was private
+ **/
+bool tm_publish(shared_t shared, void *seg)
+{
+  Region *region = (Region *)shared;
+  size_t n_shards = region->n_shards == 0 ? 1 : region->n_shards;
+  for (size_t i = 0; i < n_shards; ++i)
+  {
+    Region *shard = region->n_shards == 0 ? region : region->shards[i];
+    Segment *segment = PrivateLookup(shard, seg);
+    if (segment != NULL)
+    {
+      PrivatePublish(shard, segment);
+      return true;
+    }
+  }
+  return false;
+}
+
+/** [thread-safe] Set the contention management policy applied on conflicts and aborts.
+ * @param shared Shared memory region to configure
+ * @param policy Policy to apply from now on
+ * @return Whether the policy is supported
+ **/
+bool tm_set_cm_policy(shared_t shared, cm_policy_t policy)
+{
+  if (policy != cm_wait_epoch && policy != cm_aggressive && policy != cm_backoff && policy != cm_karma)
+  {
+    return false;
+  }
+  atomic_store(&(((Region *)shared)->cm_policy), policy);
+  return true;
+}
+
+/** [thread-safe] Return the contention management policy of the given shared memory region.
+ * @param shared Shared memory region to query
+ * @return Policy currently applied
+ **/
+cm_policy_t tm_get_cm_policy(shared_t shared) { return atomic_load(&(((Region *)shared)->cm_policy)); }
+
+/** [thread-safe] Return the counters of the given shared memory region.
+ * @param shared Shared memory region to query
+ * @param stats  Private structure receiving the counters
+ **/
+void tm_get_stats(shared_t shared, stats_t *stats) { DescriptorStats((Region *)shared, stats); }
+
+/** [thread-safe] Return why the last aborted transaction of the calling thread aborted, and when to retry it.
+ * @param shared Shared memory region the transaction ran on
+ * @param info   Private structure receiving the reason and hint
+ **/
+void tm_last_abort(shared_t unused(shared), abort_info_t *info)
+{
+  info->reason = thread_context.reason;
+  info->hint = thread_context.hint;
+}
+
+/** [thread-safe] Wait, outside of any transaction, for the current epoch of the shared memory region to commit.
+ * @param shared Shared memory region to wait on
+ **/
+void tm_wait_epoch(shared_t shared)
+{
+  Region *region = (Region *)shared;
+
+  // An epoch without running transactions never moves on
+  unsigned long int epoch = atomic_load(&(region->batcher.counter));
+  while (atomic_load(NumaEpoch(region)) <= epoch && atomic_load(&(region->batcher.n_entered)) != 0)
+  {
+    relinquish_cpu();
+  }
+}
+
+/** [thread-safe] Add a delta to a 64-bit integer word in the given transaction, without conflicting with concurrent adds to the same word.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to use
+ * @param target Address of the word (in the shared region), the alignment must be at least 8 bytes
+ * @param delta  Delta to add
+ * @return Whether the whole transaction can continue
+ **/
+bool tm_add(shared_t shared, tx_t tx, void *target, int64_t delta)
+{
+  return tm_add_guarded(shared, tx, target, delta, INT64_MIN) == success_add;
+}
+
+/** [thread-safe] Add a delta to a 64-bit integer word in the given transaction, unless the word could end up below the given floor.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to use
+ * @param target Address of the word (in the shared region), the alignment must be at least 8 bytes
+ * @param delta  Delta to add
+ * @param floor  Lowest value the word may reach, accounting for the pending negative deltas of other transactions
+ * @return Whether the delta was added (success_add), refused by the guard (refused_add), or the transaction aborted (abort_add)
+ **/
+add_t tm_add_guarded(shared_t shared, tx_t tx, void *target, int64_t delta, int64_t floor)
+{
+  Region *region = (Region *)shared;
+  tx = RetryOwner(tx);
+
+  // Upgrading on the first add
+  if (tx == UPGRADABLE_OWNER && (tx = Upgrade(region)) == invalid_tx)
+  {
+    return abort_add;
+  }
+
+  // The writer of the coarse engine adds to the committed copy
+  if (tx == COARSE_OWNER && region->align >= sizeof(int64_t))
+  {
+    int64_t value;
+    memcpy(&value, target, sizeof(int64_t));
+    if (floor != INT64_MIN && value + delta < floor)
+    {
+      return refused_add;
+    }
+    if (!CoarseLog(region, target, sizeof(int64_t)))
+    {
+      UndoCoarse(region, abort_write_write);
+      return abort_add;
+    }
+    value += delta;
+    memcpy(target, &value, sizeof(int64_t));
+    return success_add;
+  }
+
+  // Looking up segment
+  Segment *segment = LookupSegment(region, target);
+  if (segment == NULL || region->align < sizeof(int64_t))
+  {
+    Undo(region, tx, abort_lookup);
+    return abort_add;
+  }
+
+  bool refused = false;
+  abort_reason_t reason = Add(region, segment, tx, target, delta, floor != INT64_MIN, floor, &refused);
+  if (reason != abort_none)
+  {
+    if (!SavepointKeep(region, reason))
+    {
+      Undo(region, tx, reason);
+    }
+    return abort_add;
+  }
+
+  // Logging the value replaced, in case of a rollback to a savepoint
+  if (!refused && !SavepointLogAdd(region, segment, tx, target, delta))
+  {
+    Undo(region, tx, abort_write_write);
+    return abort_add;
+  }
+
+  ContentionWork(region, tx, 1);
+  return refused ? refused_add : success_add;
+}
+
+/** [thread-safe] Return the memory held by the given shared memory region, with no running transaction.
+ * @param shared    Shared memory region to query
+ * @param footprint Private structure receiving the byte counts
+ **/
+void tm_get_footprint(shared_t shared, footprint_t *footprint)
+{
+  Region *region = (Region *)shared;
+  footprint->data = 0;
+  footprint->metadata = sizeof(Region) + MAX_SEGMENTS * sizeof(Segment);
+
+  for (size_t i = 0; i < atomic_load(&(region->index)); ++i)
+  {
+    Segment *segment = region->segments + i;
+    if (segment->data == NULL)
+    {
+      continue;
+    }
+
+    // Each word has a writable copy and a control word, the removed
+    // segments kept below live ones only count as metadata
+    size_t held = (segment->size << 1) + segment->size / region->align * sizeof(tx_t);
+    if (atomic_load(&(segment->owner)) != RM_OWNER)
+    {
+      footprint->data += segment->size;
+      held -= segment->size;
+    }
+    footprint->metadata += held;
+    if (atomic_load(&(segment->debits)) != NULL)
+    {
+      footprint->metadata += (segment->size / region->align << 1) * sizeof(atomic_delta);
+    }
+    if (atomic_load(&(segment->ranges)) != NULL)
+    {
+      footprint->metadata += MAX_RANGE_LOCKS_PER_SEGMENT * sizeof(RangeLock);
+    }
+    if (atomic_load(&(segment->versions)) != NULL)
+    {
+      footprint->metadata += segment->size / region->align * ((1 + MVCC_DEPTH) * sizeof(atomic_ulong) + MVCC_DEPTH * region->align);
+    }
+  }
+}
+
+/** Enable or disable multi-version snapshots for the read only transactions of the given shared memory region, with no running transaction.
+ * @param shared Shared memory region to configure
+ * @param enable Whether read only transactions read snapshots, without waiting for nor delaying the epochs
+ * @return Whether the mode could be set
+ **/
+bool tm_set_mvcc(shared_t shared, bool enable)
+{
+  Region *region = (Region *)shared;
+
+  for (size_t i = 0; i < atomic_load(&(region->index)); ++i)
+  {
+    Segment *segment = region->segments + i;
+    if (segment->data == NULL)
+    {
+      continue;
+    }
+
+    // Starting from the current values, without history
+    free(atomic_load(&(segment->versions)));
+    atomic_store(&(segment->versions), NULL);
+    if (enable && !MvccAllocate(region, segment))
+    {
+      tm_set_mvcc(shared, false);
+      return false;
+    }
+  }
+
+  // Without snapshot readers, nothing needs to stay retired
+  if (!enable)
+  {
+    MvccFree(region->reclaimer.retired[0]);
+    MvccFree(region->reclaimer.retired[1]);
+    region->reclaimer.retired[0] = NULL;
+    region->reclaimer.retired[1] = NULL;
+  }
+
+  atomic_store(&(region->mvcc), enable);
+  return true;
+}
+
+/** Set the engine transactions of the given shared memory region run with, with no running transaction.
+ * @param shared Shared memory region to configure
+ * @param engine Engine to run with from now on
+ * @return Whether the engine is supported
+ **/
+bool tm_set_engine(shared_t shared, engine_t engine)
+{
+  if (engine != engine_fine && engine != engine_coarse && engine != engine_adaptive)
+  {
+    return false;
+  }
+
+  // Writers of the coarse engine left the writable copies behind
+  Region *region = (Region *)shared;
+  if (atomic_load(&(region->engine.mode)) == ENGINE_COARSE)
+  {
+    EngineSync(region);
+  }
+  EngineReset(region, engine);
+  return true;
+}
+
+/** [thread-safe] Return the engine requested for the given shared memory region.
+ * @param shared Shared memory region to query
+ * @return Engine requested, the adaptive one switching between the others on its own
+ **/
+engine_t tm_get_engine(shared_t shared) { return atomic_load(&(((Region *)shared)->engine.policy)); }
+
+/** [thread-safe] Set after how long an epoch keeping transactions waiting gets its read-write transactions evicted.
+ * @param shared Shared memory region to configure
+ * @param ms     Time an epoch may keep transactions waiting (in milliseconds), 0 to never evict them
+ * @return Whether the watchdog is supported
+ **/
+bool tm_set_watchdog(shared_t shared, uint64_t ms)
+{
+  atomic_store(&(((Region *)shared)->watchdog.threshold), ms * 1000000ul);
+  return true;
+}
+
+/** Create a new shared memory region split into shards, each with its own batcher, segments and first segment of the requested size and alignment.
+ * @param size   Size of the first shared segment of each shard (in bytes), must be a positive multiple of the alignment
+ * @param align  Alignment (in bytes, must be a power of 2) that the shared memory region must support
+ * @param shards Number of shards, at most 16
+ * @return Opaque shared memory region handle, also the one of the first shard, 'invalid_shared' on failure
+ **/
+shared_t tm_create_sharded(size_t size, size_t align, size_t shards)
+{
+  if (shards == 0 || shards > MAX_SHARDS)
+  {
+    return invalid_shared;
+  }
+
+  // The region is its own first shard
+  Region *region = tm_create(size, align);
+  if (region == invalid_shared)
+  {
+    return invalid_shared;
+  }
+  region->shards = malloc(shards * sizeof(Region *));
+  if (region->shards == NULL)
+  {
+    tm_destroy(region);
+    return invalid_shared;
+  }
+  region->shards[0] = region;
+
+  // Creating the other shards
+  for (region->n_shards = 1; region->n_shards < shards; ++region->n_shards)
+  {
+    region->shards[region->n_shards] = tm_create(size, align);
+    if (region->shards[region->n_shards] == invalid_shared)
+    {
+      tm_destroy(region);
+      return invalid_shared;
+    }
+  }
+  return region;
+}
+
+/** [thread-safe] Return a shard of the given sharded region, on which transactions touching that shard only run as on any region.
+ * @param shared Sharded memory region to query
+ * @param shard  Index of the shard
+ * @return Opaque shared memory region handle of the shard, 'invalid_shared' if there is no such shard
+ **/
+shared_t tm_shard(shared_t shared, size_t shard)
+{
+  Region *region = (Region *)shared;
+  return shard < region->n_shards ? region->shards[shard] : invalid_shared;
+}
+
+/** [thread-safe] Begin a new transaction spanning several shards of the given sharded region, on which it then reads, writes, allocates and frees.
+ * @param shared Sharded memory region to start a transaction on
+ * @param mask   Shards the transaction accesses, bit i standing for shard i
+ * @param is_ro  Whether the transaction is read-only
+ * @return Opaque transaction ID, 'invalid_tx' on failure
+ **/
+tx_t tm_begin_shards(shared_t shared, uint64_t mask, bool is_ro) { return ShardsBegin((Region *)shared, mask, is_ro); }
+
+/** [thread-safe] Register the calling thread on the given shared memory region, setting up the descriptor its transactions keep their counters and buffers in. Threads that do not register are registered by their first transaction.
+ * @param shared Shared memory region to register on
+ * @return Whether the descriptor could be set up
+ **/
+bool tm_thread_enter(shared_t shared) { return DescriptorOf((Region *)shared) != NULL; }
+
+/** [thread-safe] Unregister the calling thread from the given shared memory region, outside of any transaction, handing its descriptor over to the next registering thread.
+ * @param shared Shared memory region to unregister from
+ **/
+void tm_thread_exit(shared_t shared) { DescriptorRelease((Region *)shared); }
+
+/** [thread-safe] Abort the given transaction, waiting for a condition it read to hold, and sleep until another transaction commits a change to a word it read. Transactions begun with 'begin_retry' log the cache lines they read, the others and those that read nothing waking up on any commit. The caller then begins the transaction again, which may find the condition still false and retry again.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to abort
+ **/
+void tm_retry(shared_t shared, tx_t tx)
+{
+  Region *region = (Region *)shared;
+  tx = RetryOwner(tx);
+
+  // Transactions spanning several shards abort without sleeping
+  if (tx == SHARDS_OWNER)
+  {
+    ShardsUndo(region, NULL, abort_retry);
+    return;
+  }
+
+  // Registering while still in the epoch, whose commit could change the words
+  unsigned long int generation = RetryRegister(region);
+  bool sleep = true;
+
+  if (tx == SNAPSHOT_OWNER)
+  {
+    // The snapshot may be older than the last commit already
+    sleep = thread_context.snapshot == atomic_load(&(region->batcher.counter));
+    SnapshotEnd(region);
+    EngineLeave(region);
+    ContentionAbort(region, abort_retry);
+  }
+  else if (tx == COARSE_OWNER)
+  {
+    UndoCoarse(region, abort_retry);
+  }
+  else if (tx == RO_OWNER && thread_context.engine == ENGINE_COARSE)
+  {
+    LeaveCoarse(region, RO_OWNER);
+    ContentionAbort(region, abort_retry);
+  }
+  else
+  {
+    // An upgradable transaction aborts as what it became
+    if (tx == UPGRADABLE_OWNER)
+    {
+      tx = thread_context.upgraded != NO_OWNER ? thread_context.upgraded : RO_OWNER;
+      UpgradeForget(region);
+    }
+
+    if (tx == RO_OWNER)
+    {
+      Leave(region, RO_OWNER, false);
+      EngineLeave(region);
+      ContentionAbort(region, abort_retry);
+    }
+    else
+    {
+      Undo(region, tx, abort_retry);
+    }
+  }
+
+  RetrySleep(region, generation, sleep);
+}
+
+/** [thread-safe] Place a savepoint in the given transaction, which can later be rolled back to it without aborting as a whole. Savepoints nest, and once one is placed, a conflict on a read, write, add or free fails the access but leaves the transaction running for the caller to roll back, a few times per transaction before aborting it as a whole again.
+ * @param shared Shared memory region associated with the transaction
+ * @param tx     Transaction to place the savepoint in
+ * @return Savepoint placed, 'no_savepoint' if out of memory or the transaction spans several shards
+ **/
+savepoint_t tm_savepoint(shared_t shared, tx_t tx)
+{
+  tx = RetryOwner(tx);
+  if (tx == SHARDS_OWNER)
+  {
+    return no_savepoint;
+  }
+  return SavepointPlace((Region *)shared, tx);
+}
+
+/** [thread-safe] Roll the given transaction back to one of its savepoints, undoing its writes, adds, allocations and frees since. The savepoint stays placed, the ones placed after it are dropped.
+ * @param shared    Shared memory region associated with the transaction
+ * @param tx        Transaction to roll back
+ * @param savepoint Savepoint to roll back to
+ * @return Whether the transaction can continue, false if it already aborted as a whole
+ **/
+bool tm_rollback_to(shared_t shared, tx_t unused(tx), savepoint_t savepoint)
+{
+  Region *region = (Region *)shared;
+  if (savepoint == no_savepoint || savepoint > thread_context.n_savepoints || thread_context.savepoint_region != region)
+  {
+    return false;
+  }
+
+  SavepointRollback(region, savepoint);
+  return true;
+}
+
+/** [thread-safe] Run a batch of small independent transactions under as few transactions as possible, committing each closure exactly once. A closure conflicting with another transaction is retried in a later transaction while the rest of the batch commits, and a batch that aborts as a whole is split in two.
+ * @param shared   Shared memory region to run on
+ * @param closures Body of each small transaction, returning false once one of its accesses failed, and only then
+ * @param args     Argument passed to each closure
+ * @param n        Number of closures in the batch
+ * @return Whether the batch ran, false if out of memory
+ **/
+bool tm_coalesce(shared_t shared, tx_closure_t const *closures, void *const *args, size_t n)
+{
+  size_t *order = malloc(2 * n * sizeof(size_t));
+  if (order == NULL)
+  {
+    return n == 0;
+  }
+
+  for (size_t i = 0; i < n; ++i)
+  {
+    order[i] = i;
+  }
+  CoalesceRun(shared, closures, args, order, n, order + n);
+  free(order);
+  return true;
+}
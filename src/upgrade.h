@@ -0,0 +1,151 @@
+#ifndef _UPGRADE_H_
+#define _UPGRADE_H_
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "basic_operations.h"
+#include "context.h"
+#include "contention.h"
+#include "descriptor.h"
+#include "macros.h"
+#include "memory.h"
+#include "range_lock.h"
+#include "relinquish_cpu.h"
+
+/**
+ * @brief Logs the words read by an upgradable transaction
+ * before it upgraded, so that the upgrade can mark them.
+ * @param region Region the transaction runs on
+ * @param source Address of the first word read
+ * @param size Number of bytes read
+ */
+static inline void UpgradeLogRead(Region *region, void const *source, size_t size)
+{
+  // Without logs, the upgrade finds no logs either and aborts
+  DescriptorLogs *logs = LogsOf(region);
+  if (unlikely(logs == NULL))
+  {
+    return;
+  }
+
+  Segment *segment = LookupSegment(region, source);
+  if (unlikely(segment == NULL))
+  {
+    logs->reads_lost = true;
+    return;
+  }
+
+  if (unlikely(logs->n_reads == logs->reads_capacity))
+  {
+    size_t capacity = logs->reads_capacity == 0 ? 16 : logs->reads_capacity << 1;
+    ReadEntry *reads = realloc(logs->reads, capacity * sizeof(ReadEntry));
+    if (reads == NULL)
+    {
+      logs->reads_lost = true;
+      return;
+    }
+    logs->reads = reads;
+    logs->reads_capacity = capacity;
+  }
+
+  ReadEntry *entry = logs->reads + logs->n_reads++;
+  entry->segment = segment;
+  entry->first = ((char *)source - (char *)segment->data) / region->align;
+  entry->last = entry->first + size / region->align;
+}
+
+/**
+ * @brief Forgets the state of the upgradable transaction
+ * of the calling thread, once it ended.
+ * @param region Region the transaction ran on
+ */
+static inline void UpgradeForget(Region *region)
+{
+  thread_context.upgraded = NO_OWNER;
+  DescriptorLogs *logs = LogsOf(region);
+  if (likely(logs != NULL))
+  {
+    logs->n_reads = 0;
+    logs->reads_lost = false;
+  }
+}
+
+/**
+ * @brief Upgrades the upgradable transaction of the calling thread to a
+ * write transaction of the current epoch. The words it read so far are
+ * the committed ones, which stay valid as long as no writer of the epoch
+ * owns them, so the upgrade only marks them as read by the new writer.
+ * @param region Region the transaction runs on
+ * @return Identifier of the writer, invalid_tx if the transaction aborted
+ */
+static inline tx_t Upgrade(Region *region)
+{
+  if (likely(thread_context.upgraded != NO_OWNER))
+  {
+    return thread_context.upgraded;
+  }
+
+  // Waiting for our turn
+  TakeTurn(region, no_deadline);
+
+  // Taking a write slot, we are already counted in n_entered
+  tx_t tx = invalid_tx;
+  if (atomic_load(&(region->batcher.n_write_slots)) != 0)
+  {
+    atomic_fetch_add(&(region->batcher.n_write_slots), -1);
+    tx = atomic_fetch_add(&(region->batcher.n_write_entered), 1) + 1;
+  }
+
+  // Giving away our turn
+  GiveTurn(region);
+
+  if (tx == invalid_tx)
+  {
+    // Leaving as the reader we still are
+    UpgradeForget(region);
+    Leave(region, RO_OWNER, false);
+    EngineLeave(region);
+    ContentionAbort(region, abort_epoch_full);
+    return invalid_tx;
+  }
+
+  thread_context.upgraded = tx;
+  ContentionBegin(region, tx);
+
+  // Under snapshot isolation, the words read so far stay unmarked
+  if (thread_context.snapshot_isolation)
+  {
+    return tx;
+  }
+
+  // Marking the words read so far
+  DescriptorLogs *logs = LogsOf(region);
+  for (size_t i = 0; logs != NULL && i < logs->n_reads && !logs->reads_lost; ++i)
+  {
+    ReadEntry *entry = logs->reads + i;
+    atomic_tx *controls = (atomic_tx *)((char *)entry->segment->data + (entry->segment->size << 1));
+    for (size_t j = entry->first; j < entry->last; ++j)
+    {
+      tx_t found;
+      if (!MarkRead(controls + j, tx, &found) || RangeConflict(entry->segment, tx, j, j + 1))
+      {
+        UpgradeForget(region);
+        Undo(region, tx, abort_read_write);
+        return invalid_tx;
+      }
+    }
+  }
+
+  if (unlikely(logs == NULL || logs->reads_lost))
+  {
+    UpgradeForget(region);
+    Undo(region, tx, abort_read_write);
+    return invalid_tx;
+  }
+
+  logs->n_reads = 0;
+  return tx;
+}
+
+#endif
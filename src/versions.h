@@ -0,0 +1,223 @@
+#ifndef _VERSIONS_H_
+#define _VERSIONS_H_
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "descriptor.h"
+#include "macros.h"
+#include "memory.h"
+
+/**
+ * @brief Reads whether read only transactions read multi-version
+ * snapshots from the TM_MVCC environment variable.
+ * @return Whether TM_MVCC is set to 1
+ */
+static inline bool MvccFromEnv()
+{
+  const char *value = getenv("TM_MVCC");
+  return value != NULL && strcmp(value, "1") == 0;
+}
+
+/**
+ * @brief Returns the commit stamps of the words of a segment,
+ * followed by the stamps of their previous versions.
+ * @param versions Versions of the segment
+ * @param words Number of words in the segment
+ * @return Stamps of the previous versions, MVCC_DEPTH per word
+ */
+static inline atomic_ulong *MvccHistoryStamps(atomic_ulong *versions, size_t words)
+{
+  return versions + words;
+}
+
+/**
+ * @brief Returns the values of the previous versions of the words of a segment.
+ * @param versions Versions of the segment
+ * @param words Number of words in the segment
+ * @return Values of the previous versions, MVCC_DEPTH per word
+ */
+static inline char *MvccHistoryValues(atomic_ulong *versions, size_t words)
+{
+  return (char *)(versions + words + words * MVCC_DEPTH);
+}
+
+/**
+ * @brief Allocates the versions of a segment, its words
+ * committed before any snapshot and without history.
+ * @param region Region holding the segment
+ * @param segment Segment to version
+ * @return Whether the versions could be allocated
+ */
+static inline bool MvccAllocate(Region *region, Segment *segment)
+{
+  size_t words = segment->size / region->align;
+  atomic_ulong *versions = malloc(words * (1 + MVCC_DEPTH) * sizeof(atomic_ulong) + words * MVCC_DEPTH * region->align);
+  if (versions == NULL)
+  {
+    return false;
+  }
+
+  atomic_ulong *history = MvccHistoryStamps(versions, words);
+  for (size_t i = 0; i < words; ++i)
+  {
+    atomic_init(versions + i, 0);
+  }
+  for (size_t i = 0; i < words * MVCC_DEPTH; ++i)
+  {
+    atomic_init(history + i, VERSION_EMPTY);
+  }
+
+  atomic_store(&(segment->versions), versions);
+  return true;
+}
+
+/**
+ * @brief Compares the two copies of a word.
+ * @param v1 Committed copy
+ * @param v2 Writable copy
+ * @param align Size of the word
+ * @return Whether both copies hold the same value
+ */
+static inline bool MvccSame(char const *v1, char const *v2, size_t align)
+{
+  // Most words are 64-bit integers or pointers
+  if (likely(align == sizeof(uint64_t)))
+  {
+    uint64_t word1, word2;
+    memcpy(&word1, v1, sizeof(uint64_t));
+    memcpy(&word2, v2, sizeof(uint64_t));
+    return word1 == word2;
+  }
+  return memcmp(v1, v2, align) == 0;
+}
+
+/**
+ * @brief Commits the writable copy of a versioned segment, pushing
+ * the replaced value of each changed word to its history. Snapshot
+ * readers see the word busy while it changes.
+ * @param region Region holding the segment
+ * @param segment Segment to commit
+ * @param versions Versions of the segment
+ * @param epoch Stamp of the committed values
+ * @param first Index of the first word that may have changed
+ * @param last Index past the last word that may have changed
+ */
+static inline void MvccCommit(Region *region, Segment *segment, atomic_ulong *versions, unsigned long int epoch, size_t first, size_t last)
+{
+  size_t align = region->align;
+  size_t words = segment->size / align;
+  atomic_ulong *history = MvccHistoryStamps(versions, words);
+  char *values = MvccHistoryValues(versions, words);
+  char *v1 = segment->data;
+  char *v2 = v1 + segment->size;
+
+  for (size_t i = first; i < last; ++i)
+  {
+    // Skipping unchanged blocks in one comparison
+    if (i % MVCC_SCAN_WORDS == 0)
+    {
+      size_t block = last - i < MVCC_SCAN_WORDS ? last - i : MVCC_SCAN_WORDS;
+      if (memcmp(v1 + i * align, v2 + i * align, block * align) == 0)
+      {
+        i += block - 1;
+        continue;
+      }
+    }
+    if (MvccSame(v1 + i * align, v2 + i * align, align))
+    {
+      continue;
+    }
+
+    unsigned long int stamp = atomic_load_explicit(versions + i, memory_order_relaxed);
+    atomic_store_explicit(versions + i, VERSION_BUSY, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    // Evicting the oldest previous version
+    size_t oldest = i * MVCC_DEPTH;
+    for (size_t j = oldest; j < (i + 1) * MVCC_DEPTH; ++j)
+    {
+      unsigned long int candidate = atomic_load_explicit(history + j, memory_order_relaxed);
+      if (candidate == VERSION_EMPTY)
+      {
+        oldest = j;
+        break;
+      }
+      if (candidate < atomic_load_explicit(history + oldest, memory_order_relaxed))
+      {
+        oldest = j;
+      }
+    }
+    atomic_store_explicit(history + oldest, stamp, memory_order_relaxed);
+    memcpy(values + oldest * align, v1 + i * align, align);
+
+    memcpy(v1 + i * align, v2 + i * align, align);
+    atomic_store_explicit(versions + i, epoch, memory_order_release);
+  }
+}
+
+/**
+ * @brief Releases the data and versions of a removed segment, or
+ * retires them until the snapshot readers that may access them ended.
+ * @param region Region holding the segment
+ * @param segment Removed segment
+ */
+static inline void MvccRelease(Region *region, Segment *segment)
+{
+  atomic_ulong *versions = atomic_load(&(segment->versions));
+  Retired *retired = versions != NULL ? malloc(sizeof(Retired)) : NULL;
+  if (retired != NULL)
+  {
+    unsigned long int phase = atomic_load(&(region->reclaimer.phase));
+    retired->data = segment->data;
+    retired->versions = versions;
+    retired->next = region->reclaimer.retired[phase];
+    region->reclaimer.retired[phase] = retired;
+  }
+  else if (versions == NULL)
+  {
+    DescriptorRecycle(region, segment->data, (segment->size << 1) + segment->size / region->align * sizeof(tx_t));
+  }
+  // Without memory to retire them, the data and versions are leaked
+  // rather than freed under a reader
+
+  segment->data = NULL;
+  atomic_store(&(segment->versions), NULL);
+}
+
+/**
+ * @brief Frees a list of retired segments.
+ * @param retired First retired segment
+ */
+static inline void MvccFree(Retired *retired)
+{
+  while (retired != NULL)
+  {
+    Retired *next = retired->next;
+    free(retired->data);
+    free(retired->versions);
+    free(retired);
+    retired = next;
+  }
+}
+
+/**
+ * @brief Frees the segments retired before the last phase flip once
+ * no snapshot reader pins that phase anymore, and flips the phase.
+ * Called by the epoch commit after moving to the next epoch.
+ * @param region Region to reclaim
+ */
+static inline void MvccReclaim(Region *region)
+{
+  unsigned long int other = 1 - atomic_load(&(region->reclaimer.phase));
+  if (atomic_load(&(region->reclaimer.active[other])) != 0)
+  {
+    return;
+  }
+
+  MvccFree(region->reclaimer.retired[other]);
+  region->reclaimer.retired[other] = NULL;
+  atomic_store(&(region->reclaimer.phase), other);
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef _WATCHDOG_H_
+#define _WATCHDOG_H_
+
+#include <stdlib.h>
+
+#include "engine.h"
+#include "macros.h"
+#include "memory.h"
+
+/**
+ * @brief Parses the watchdog threshold from the
+ * TM_WATCHDOG_MS environment variable.
+ * @return Requested threshold (ns), WATCHDOG_MS (off) by default
+ */
+static inline unsigned long int WatchdogFromEnv()
+{
+  const char *value = getenv("TM_WATCHDOG_MS");
+  unsigned long int ms = value == NULL ? WATCHDOG_MS : strtoul(value, NULL, 10);
+  return ms * 1000000ul;
+}
+
+/**
+ * @brief Returns the tag of an epoch in the doomed word.
+ * @param epoch Epoch to tag
+ * @return Bits of the epoch in the doomed word
+ */
+static inline unsigned long int WatchdogTag(unsigned long int epoch) { return epoch << WATCHDOG_EPOCH_SHIFT; }
+
+/**
+ * @brief Watches, from a waiting thread, the epoch it waits for. Once
+ * it kept the thread waiting longer than the threshold, dooms every
+ * write transaction that entered it, unless an irrevocable or exclusive
+ * one runs, which was granted the epoch alone on purpose.
+ * @param region Region the thread waits on
+ * @param epoch Epoch the thread waits the end of
+ * @param since When the thread started waiting (ns), 0 before the first call
+ */
+static inline void WatchdogCheck(Region *region, unsigned long int epoch, unsigned long int *since)
+{
+  unsigned long int threshold = atomic_load(&(region->watchdog.threshold));
+  if (threshold == 0)
+  {
+    return;
+  }
+
+  unsigned long int now = EngineNow();
+  if (*since == 0)
+  {
+    *since = now;
+    return;
+  }
+  if (now - *since < threshold || atomic_load(&(region->batcher.serial)) || atomic_load(&(region->batcher.exclusive)))
+  {
+    return;
+  }
+
+  // Identifiers 1 to n_write_entered, the ones that already left being harmless
+  unsigned long int writers = atomic_load(&(region->batcher.n_write_entered));
+  unsigned long int doomed = WatchdogTag(epoch) | ((1ul << (writers + 1)) - 2);
+  if (atomic_load(&(region->watchdog.doomed)) != doomed)
+  {
+    atomic_store(&(region->watchdog.doomed), doomed);
+  }
+}
+
+/**
+ * @brief Checks whether the watchdog doomed a write transaction.
+ * @param region Region the transaction runs on
+ * @param tx Transaction to check
+ * @return Whether the transaction must abort
+ */
+static inline bool WatchdogDoomed(Region *region, tx_t tx)
+{
+  unsigned long int doomed = atomic_load_explicit(&(region->watchdog.doomed), memory_order_relaxed);
+  if (likely((doomed & (1ul << tx)) == 0))
+  {
+    return false;
+  }
+
+  // Only the epoch it was doomed in, the identifiers being reused
+  return doomed >> WATCHDOG_EPOCH_SHIFT == WatchdogTag(atomic_load(&(region->batcher.counter))) >> WATCHDOG_EPOCH_SHIFT;
+}
+
+#endif
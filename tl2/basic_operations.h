@@ -0,0 +1,185 @@
+#ifndef _BASIC_OPERATIONS_H_
+#define _BASIC_OPERATIONS_H_
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "context.h"
+#include "logs.h"
+#include "memory.h"
+
+/**
+ * @brief Finds the versioned lock covering a word.
+ * @param region Region holding the word
+ * @param word   Address of the word
+ * @return Lock covering the word
+ */
+static inline atomic_ulong *LockOf(Region *region, void const *word)
+{
+  return region->locks + (((uintptr_t)word >> region->shift) & (LOCK_TABLE_SIZE - 1));
+}
+
+/**
+ * @brief Value stored in a versioned lock
+ * held by the calling thread.
+ * @return Locked value of the calling thread
+ */
+static inline unsigned long int LockedByUs()
+{
+  return (uintptr_t)&thread_context | LOCKED_BIT;
+}
+
+/**
+ * @brief Logs the lock covering a read word,
+ * to be validated on commit.
+ * @param lock Lock covering the word
+ * @return Whether the lock could be logged
+ */
+static inline bool LogRead(atomic_ulong *lock)
+{
+  if (!Reserve((void **)&(thread_context.reads), &(thread_context.reads_capacity), thread_context.n_reads + 1, sizeof(atomic_ulong *)))
+  {
+    return false;
+  }
+  thread_context.reads[thread_context.n_reads++] = lock;
+  return true;
+}
+
+/**
+ * @brief Reads a word consistently with the snapshot of the transaction.
+ * @param region Region holding the word
+ * @param source Address of the word
+ * @param target Where to copy the word
+ * @param lock   Lock covering the word
+ * @return Whether the word was not written since the transaction began
+ */
+static inline bool ReadWord(Region *region, void const *source, void *target, atomic_ulong *lock)
+{
+  unsigned long int before = atomic_load_explicit(lock, memory_order_acquire);
+  memcpy(target, source, region->align);
+  atomic_thread_fence(memory_order_acquire);
+  unsigned long int after = atomic_load_explicit(lock, memory_order_relaxed);
+
+  return !(before & LOCKED_BIT) && before == after && (before >> 1) <= thread_context.rv;
+}
+
+/**
+ * @brief Clears the logs of the transaction.
+ */
+static inline void Reset()
+{
+  ClearWrites(&(thread_context.writes), thread_context.region->shift);
+  thread_context.n_reads = 0;
+  thread_context.n_locks = 0;
+
+  // The transaction no longer holds back the freed segments
+  atomic_store_explicit(&(thread_context.reader->since), ULONG_MAX, memory_order_release);
+}
+
+/**
+ * @brief Aborts the transaction, releasing the locks it
+ * acquired and the segments it allocated.
+ */
+static inline void Rollback()
+{
+  for (size_t i = 0; i < thread_context.n_locks; ++i)
+  {
+    if (thread_context.locks[i].acquired)
+    {
+      atomic_store_explicit(thread_context.locks[i].lock, thread_context.locks[i].prior, memory_order_release);
+    }
+  }
+  DiscardSegments(&(thread_context.region->segments), &(thread_context.segments));
+  Reset();
+}
+
+/**
+ * @brief Commits the transaction: locks the written words,
+ * validates the read ones and writes the redo log back.
+ * @param region Region the transaction runs on
+ * @return Whether the transaction committed
+ */
+static inline bool Commit(Region *region)
+{
+  // Reads were validated against the snapshot as they happened
+  bool reclaim;
+  size_t n_writes = thread_context.writes.n_writes;
+  if (n_writes == 0)
+  {
+    reclaim = PublishSegments(&(region->segments), &(thread_context.segments), atomic_load(&(region->clock)));
+    Reset();
+    if (unlikely(reclaim))
+    {
+      Reclaim(&(region->segments));
+    }
+    return true;
+  }
+
+  // Locking the written words, a word written since the snapshot
+  // is a conflict even if not read, so that held locks need no
+  // further validation
+  if (!Reserve((void **)&(thread_context.locks), &(thread_context.locks_capacity), n_writes, sizeof(WriteLock)))
+  {
+    Rollback();
+    return false;
+  }
+  unsigned long int locked = LockedByUs();
+  for (size_t i = 0; i < n_writes; ++i)
+  {
+    WriteLock *entry = thread_context.locks + i;
+    entry->lock = LockOf(region, thread_context.writes.targets[i]);
+    entry->acquired = false;
+    thread_context.n_locks = i + 1;
+    unsigned long int value = atomic_load(entry->lock);
+    if (value == locked)
+    {
+      continue;
+    }
+    if ((value & LOCKED_BIT) || (value >> 1) > thread_context.rv || !atomic_compare_exchange_strong(entry->lock, &value, locked))
+    {
+      Rollback();
+      return false;
+    }
+    entry->prior = value;
+    entry->acquired = true;
+  }
+
+  // Validating the reads, unless no one committed since the snapshot
+  unsigned long int wv = atomic_fetch_add(&(region->clock), 1) + 1;
+  if (wv != thread_context.rv + 1)
+  {
+    for (size_t i = 0; i < thread_context.n_reads; ++i)
+    {
+      unsigned long int value = atomic_load(thread_context.reads[i]);
+      if (value != locked && ((value & LOCKED_BIT) || (value >> 1) > thread_context.rv))
+      {
+        Rollback();
+        return false;
+      }
+    }
+  }
+
+  // Writing back and releasing the locks with the new version
+  for (size_t i = 0; i < n_writes; ++i)
+  {
+    memcpy(thread_context.writes.targets[i], thread_context.writes.values + i * region->align, region->align);
+  }
+  for (size_t i = 0; i < n_writes; ++i)
+  {
+    if (thread_context.locks[i].acquired)
+    {
+      atomic_store_explicit(thread_context.locks[i].lock, wv << 1, memory_order_release);
+    }
+  }
+
+  reclaim = PublishSegments(&(region->segments), &(thread_context.segments), wv);
+  Reset();
+  if (unlikely(reclaim))
+  {
+    Reclaim(&(region->segments));
+  }
+  return true;
+}
+
+#endif
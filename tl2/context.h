@@ -0,0 +1,61 @@
+#ifndef _CONTEXT_H_
+#define _CONTEXT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "memory.h"
+
+/// @brief Versioned lock covering a word written by the
+/// current transaction, filled in when it commits.
+typedef struct _WriteLock
+{
+  /// @brief Versioned lock covering the word.
+  atomic_ulong *lock;
+  /// @brief Value of the lock before the
+  /// commit acquired it.
+  unsigned long int prior;
+  /// @brief Whether this entry acquired the lock,
+  /// entries sharing a lock only acquire it once.
+  bool acquired;
+} WriteLock;
+
+/// @brief Descriptor of the transaction
+/// run by the calling thread.
+typedef struct _ThreadContext
+{
+  /// @brief Region the transaction runs on.
+  Region *region;
+  /// @brief Reader of the thread on the region with
+  /// the identifier below, 0 before the first one.
+  Reader *reader;
+  /// @brief Identifier of the region of the reader.
+  unsigned long int reader_id;
+  /// @brief Whether the transaction is read-only.
+  bool is_ro;
+  /// @brief Value of the global clock when
+  /// the transaction began.
+  unsigned long int rv;
+  /// @brief Locks covering the words read.
+  atomic_ulong **reads;
+  /// @brief Number of logged reads.
+  size_t n_reads;
+  /// @brief Number of reads the log can hold.
+  size_t reads_capacity;
+  /// @brief Redo log of the words written.
+  WriteLog writes;
+  /// @brief Locks covering the written words,
+  /// in the order of the redo log.
+  WriteLock *locks;
+  /// @brief Number of locks the commit filled in.
+  size_t n_locks;
+  /// @brief Number of locks the array can hold.
+  size_t locks_capacity;
+  /// @brief Segments allocated and freed.
+  SegmentLog segments;
+} ThreadContext;
+
+/// @brief Context of the calling thread.
+static _Thread_local ThreadContext thread_context;
+
+#endif
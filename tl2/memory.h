@@ -0,0 +1,47 @@
+#ifndef _MEMORY_H_
+#define _MEMORY_H_
+
+#include <tm.h>
+#include <stdatomic.h>
+
+#include "logs.h"
+
+/// @brief Used for expressing the
+/// encoding of the versioned locks.
+typedef enum _VersionLockStatus
+{
+  /// @brief Bit set in a versioned lock while a committing
+  /// transaction holds it, the other bits then identify
+  /// the holder instead of the version.
+  LOCKED_BIT = 1,
+  /// @brief Number of versioned locks the words
+  /// of a region are striped over.
+  LOCK_TABLE_SIZE = 1 << 20,
+} VersionLockStatus;
+
+/// @brief Represents a region in the
+/// software transactional memory
+typedef struct _Region
+{
+  /// @brief Global version clock, incremented
+  /// by each committing write transaction.
+  atomic_ulong clock;
+  /// @brief Versioned locks covering the words
+  /// of the region, indexed by address.
+  atomic_ulong *locks;
+  /// @brief Start of the first, non-free-able
+  /// segment of the region.
+  void *start;
+  /// @brief Size of the first segment (bytes).
+  size_t size;
+  /// @brief User requested alignment
+  /// of the memory segments (bytes)
+  size_t align;
+  /// @brief Log2 of the alignment, used
+  /// for indexing the versioned locks.
+  unsigned int shift;
+  /// @brief Segments allocated in transactions.
+  Segments segments;
+} Region;
+
+#endif